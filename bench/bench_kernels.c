@@ -0,0 +1,836 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "myPreCompiler.h"
+
+// Microbenchmark dei kernel del precompilatore su input casuali e avversari.
+// Ogni kernel viene prima confrontato byte per byte con l'implementazione di riferimento
+// (quando nell'albero ne esiste una variante ottimizzata), poi ripetuto finché non supera
+// il tempo minimo di misura; il risultato è riportato in ns per byte e ns per chiamata.
+
+// Dimensione predefinita di ciascun input generato
+#define BENCH_DEFAULT_SIZE (1024 * 1024)
+// Tempo minimo di misura predefinito per kernel e input (millisecondi)
+#define BENCH_DEFAULT_MIN_MS 200
+// Numero di parole e di direttive generate per i kernel che lavorano su stringhe singole
+#define BENCH_WORD_COUNT 65536
+// Nome del file attribuito agli input nelle diagnostiche dell'analisi
+#define BENCH_FILENAME "bench.c"
+
+// Input generato: buffer di testo con il suo nome
+typedef struct {
+    const char* name;
+    SourceBuffer buf;
+} BenchInput;
+
+// Stringhe terminate da '\0' per is_valid_c_identifier ed extract_include_filename
+typedef struct {
+    const char* name;
+    char** items;
+    int count;
+    size_t bytes;
+} BenchWords;
+
+// Finestre di token di un input, copiate una volta prima della misura dell'analisi
+typedef struct {
+    TokenStream* windows;
+    int count;
+} LexedInput;
+
+// Opzioni della riga di comando
+typedef struct {
+    uint64_t seed;
+    size_t size;
+    uint64_t min_ns;
+    const char* filter;
+    bool check_only;
+} BenchOptions;
+
+static BenchOptions options;
+static int failures = 0;
+
+// Stato del generatore (xorshift64*): gli input dipendono solo dal seme
+static uint64_t rng_state;
+
+// =====================
+// Generazione degli input
+// =====================
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+static unsigned rng_below(unsigned n) {
+    return (unsigned)(rng_next() % n);
+}
+
+// Testo in costruzione, cresce per raddoppio
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} TextBuilder;
+
+static void text_append(TextBuilder* t, const char* s, size_t len) {
+    if (t->size + len + 1 > t->capacity) {
+        size_t new_capacity = t->capacity ? t->capacity : 4096;
+        while (t->size + len + 1 > new_capacity) new_capacity *= 2;
+        char* new_data = realloc(t->data, new_capacity);
+        if (!new_data) {
+            perror("Errore: Impossibile allocare memoria per l'input del benchmark");
+            exit(1);
+        }
+        t->data = new_data;
+        t->capacity = new_capacity;
+    }
+    memcpy(t->data + t->size, s, len);
+    t->size += len;
+    t->data[t->size] = '\0';
+}
+
+static void text_puts(TextBuilder* t, const char* s) {
+    text_append(t, s, strlen(s));
+}
+
+/**
+ * Accoda un identificatore casuale; con invalid a true può iniziare con una cifra o
+ * contenere un carattere non ammesso.
+ */
+static void append_identifier(TextBuilder* t, bool invalid) {
+    static const char first[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+    static const char rest[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    char name[64];
+    int len = 1 + (int)rng_below(24);
+    name[0] = first[rng_below(sizeof(first) - 1)];
+    for (int i = 1; i < len; ++i) name[i] = rest[rng_below(sizeof(rest) - 1)];
+    if (invalid) {
+        if (rng_below(2) == 0) name[0] = (char)('0' + rng_below(10));
+        else name[rng_below((unsigned)len)] = "$@`"[rng_below(3)];
+    }
+    text_append(t, name, (size_t)len);
+}
+
+/**
+ * Righe di codice realistiche: dichiarazioni, istruzioni, commenti su riga singola e
+ * multi-riga, righe vuote e stringhe.
+ */
+static void generate_mixed(TextBuilder* t, size_t size) {
+    static const char* types[] = { "int", "char*", "unsigned long", "struct node", "const double", "static float" };
+    while (t->size < size) {
+        switch (rng_below(10)) {
+            case 0:
+            case 1:
+            case 2:
+                text_puts(t, types[rng_below(6)]);
+                text_puts(t, " ");
+                append_identifier(t, rng_below(20) == 0);
+                text_puts(t, rng_below(3) == 0 ? " = 42;" : ";");
+                break;
+            case 3:
+                text_puts(t, "    x = y / z + w * 2; // commento a fine riga");
+                break;
+            case 4:
+                text_puts(t, "/* commento\n   su più\n   righe */");
+                break;
+            case 5:
+                text_puts(t, "void f(int a, char* b) {\n    int a; return;\n}");
+                break;
+            case 6:
+                text_puts(t, "const char* s = \"http://esempio/*non*/un commento\";");
+                break;
+            case 7:
+                text_puts(t, "");
+                break;
+            case 8:
+                text_puts(t, "    if (a /* in linea */ < b) { a++; }");
+                break;
+            default:
+                text_puts(t, "#define MACRO(x) ((x) / 2)");
+                break;
+        }
+        text_puts(t, "\n");
+    }
+}
+
+/**
+ * Sequenze avversarie per la macchina dei commenti: aperture annidate, stelle e barre
+ * ripetute, commenti chiusi a cavallo delle righe e '/' sospesi a fine riga.
+ */
+static void generate_nested_comments(TextBuilder* t, size_t size) {
+    static const char* pieces[] = {
+        "/*", "*/", "/**/", "/*/", "*/*", "//", "/", "*", "**", "***/", "/*/**/*/", "a", " ", "x/y", "\n", "\n", "/\n", "*\n",
+    };
+    const int count = (int)(sizeof(pieces) / sizeof(pieces[0]));
+    while (t->size < size) {
+        int depth = 1 + (int)rng_below(32);
+        for (int i = 0; i < depth; ++i) text_puts(t, "/*");
+        for (int i = 0; i < 16; ++i) text_puts(t, pieces[rng_below((unsigned)count)]);
+        for (int i = 0; i < depth; ++i) text_puts(t, "*/");
+        text_puts(t, rng_below(4) == 0 ? "\n" : " ");
+    }
+    text_puts(t, "*/\n");
+}
+
+/**
+ * Righe molto più lunghe di MAX_LINE_LEN, che vengono spezzate con la semantica di fgets,
+ * con commenti e '/' che cadono anche sul punto di taglio.
+ */
+static void generate_long_lines(TextBuilder* t, size_t size) {
+    while (t->size < size) {
+        size_t len = MAX_LINE_LEN / 2 + rng_below(MAX_LINE_LEN * 8);
+        size_t start = t->size;
+        while (t->size - start < len) {
+            switch (rng_below(8)) {
+                case 0: text_puts(t, "/* c */"); break;
+                case 1: text_puts(t, " / "); break;
+                case 2: text_puts(t, " "); break;
+                case 3: append_identifier(t, false); break;
+                default: text_puts(t, "a = b + c; "); break;
+            }
+        }
+        text_puts(t, rng_below(6) == 0 ? "// coda\n" : "\n");
+    }
+}
+
+/**
+ * Dichiarazioni dense di identificatori, con nomi non validi, duplicati, scope annidati
+ * e parametri che nascondono variabili esterne.
+ */
+static void generate_declarations(TextBuilder* t, size_t size) {
+    while (t->size < size) {
+        if (rng_below(8) == 0) {
+            text_puts(t, "void g(int shared, long ");
+            append_identifier(t, false);
+            text_puts(t, ") {\n    int shared;\n    { int inner, inner; }\n}\n");
+            continue;
+        }
+        text_puts(t, rng_below(2) ? "int " : "unsigned long ");
+        int names = 1 + (int)rng_below(12);
+        for (int i = 0; i < names; ++i) {
+            if (i > 0) text_puts(t, ", ");
+            if (rng_below(4) == 0) text_puts(t, "*");
+            if (rng_below(10) == 0) text_puts(t, "shared");
+            else append_identifier(t, rng_below(10) == 0);
+            if (rng_below(5) == 0) text_puts(t, "[16]");
+            if (rng_below(4) == 0) text_puts(t, " = 0");
+        }
+        text_puts(t, ";\n");
+    }
+}
+
+/**
+ * Byte casuali da un alfabeto ristretto ai caratteri che guidano i kernel (commenti,
+ * newline, apici, direttive e qualche '\0').
+ */
+static void generate_random_bytes(TextBuilder* t, size_t size) {
+    static const char alphabet[] = "//**\n\n  ab_1;{}\"#";
+    while (t->size < size) {
+        char c = (rng_below(4096) == 0) ? '\0' : alphabet[rng_below(sizeof(alphabet) - 1)];
+        text_append(t, &c, 1);
+    }
+}
+
+/**
+ * Identificatori validi e non validi (alla pari), per is_valid_c_identifier.
+ */
+static void generate_identifier_words(BenchWords* w) {
+    w->name = "identificatori";
+    w->items = malloc(sizeof(char*) * BENCH_WORD_COUNT);
+    w->count = 0;
+    w->bytes = 0;
+    if (!w->items) return;
+    for (int i = 0; i < BENCH_WORD_COUNT; ++i) {
+        TextBuilder t = { NULL, 0, 0 };
+        append_identifier(&t, rng_below(2) == 0);
+        w->items[w->count++] = t.data;
+        w->bytes += t.size;
+    }
+}
+
+/**
+ * Direttive #include valide e malformate (apice mancante, nome vuoto, nessun apice),
+ * per extract_include_filename.
+ */
+static void generate_include_lines(BenchWords* w) {
+    w->name = "direttive";
+    w->items = malloc(sizeof(char*) * BENCH_WORD_COUNT);
+    w->count = 0;
+    w->bytes = 0;
+    if (!w->items) return;
+    for (int i = 0; i < BENCH_WORD_COUNT; ++i) {
+        TextBuilder t = { NULL, 0, 0 };
+        text_puts(&t, rng_below(4) == 0 ? "  #include " : "#include ");
+        switch (rng_below(8)) {
+            case 0: text_puts(&t, "\"senza_chiusura.h"); break;
+            case 1: text_puts(&t, "\"\""); break;
+            case 2: text_puts(&t, "<stdio.h>"); break;
+            default:
+                text_puts(&t, "\"");
+                append_identifier(&t, false);
+                text_puts(&t, rng_below(3) == 0 ? "/dir/file.h\"" : ".h\"");
+                break;
+        }
+        text_puts(&t, rng_below(3) == 0 ? " // commento\n" : "\n");
+        w->items[w->count++] = t.data;
+        w->bytes += t.size;
+    }
+}
+
+static void free_words(BenchWords* w) {
+    for (int i = 0; i < w->count; ++i) free(w->items[i]);
+    free(w->items);
+}
+
+// =====================
+// Kernel: rimozione dei commenti
+// =====================
+
+/**
+ * Indica se una riga è una direttiva #include valida, che non attraversa la macchina
+ * dei commenti (stessa regola del lexer e di extract_include_filename).
+ */
+static bool is_valid_include_line(const char* line) {
+    while (isspace((unsigned char)*line)) line++;
+    if (strncmp(line, "#include", 8) != 0) return false;
+    const char* q1 = strchr(line, '"');
+    const char* q2 = q1 ? strchr(q1 + 1, '"') : NULL;
+    return q2 != NULL && q2 > q1 + 1;
+}
+
+/**
+ * Riferimento: rimozione dei commenti per righe con strip_comments_line, come nel
+ * percorso per righe di process_c_file. Le righe mantenute sono concatenate in out.
+ * @return Byte scritti in out.
+ */
+static size_t strip_reference(const SourceBuffer* buf, char* out, int* comments, long* calls) {
+    char line[MAX_LINE_LEN];
+    char processed[MAX_LINE_LEN * 2];
+    CommentState state = CODE;
+    size_t pos = 0;
+    size_t written = 0;
+    *comments = 0;
+    *calls = 0;
+    while (read_buffer_line(buf, &pos, line, sizeof(line)) != NULL) {
+        (*calls)++;
+        if (is_valid_include_line(line)) continue;
+        bool had_comment;
+        int len = strip_comments_line(line, processed, &state, &had_comment);
+        bool blank = is_blank_line(processed);
+        if (counts_as_comment_line(had_comment, blank, state)) (*comments)++;
+        if (!blank) {
+            memcpy(out + written, processed, (size_t)len);
+            written += (size_t)len;
+        }
+    }
+    return written;
+}
+
+/**
+ * Variante ottimizzata: il lexer a finestre, con il livello di dettaglio indicato.
+ * @return Byte scritti in out.
+ */
+static size_t strip_lexer(const SourceBuffer* buf, LexMode mode, char* out, int* comments, long* calls) {
+    Lexer lexer;
+    init_lexer(&lexer, buf->data, buf->size, CODE);
+    TokenStream tokens;
+    init_token_stream(&tokens);
+    size_t written = 0;
+    *comments = 0;
+    *calls = 0;
+    while (lex_window_as(&lexer, &tokens, mode)) {
+        int line_first = 0;
+        for (int t = 0; t < tokens.count; ++t) {
+            unsigned char kind = tokens.kinds[t];
+            if (TOKEN_KIND(kind) != TOK_EOL) continue;
+            unsigned flags = TOKEN_FLAGS(kind);
+            (*calls)++;
+            if (TOKEN_KIND(tokens.kinds[line_first]) != TOK_INCLUDE) {
+                if (flags & LINE_COUNT_COMMENT) (*comments)++;
+                if (!(flags & LINE_BLANK)) written += copy_kept_tokens(&tokens, line_first, t, out, written, NULL);
+            }
+            line_first = t + 1;
+        }
+    }
+    free_token_stream(&tokens);
+    return written;
+}
+
+/**
+ * Confronta l'output di una variante con quello di riferimento, indicando il primo byte diverso.
+ */
+static bool same_output(const char* kernel, const char* input, const char* ref, size_t ref_len, int ref_comments,
+                        const char* out, size_t out_len, int out_comments) {
+    if (ref_len == out_len && ref_comments == out_comments && memcmp(ref, out, ref_len) == 0) return true;
+    size_t i = 0;
+    while (i < ref_len && i < out_len && ref[i] == out[i]) i++;
+    fprintf(stderr, "Errore: %s su '%s' differisce dal riferimento: %zu/%zu byte, %d/%d righe di commento, primo byte diverso all'offset %zu.\n",
+            kernel, input, out_len, ref_len, out_comments, ref_comments, i);
+    return false;
+}
+
+// =====================
+// Kernel: analisi delle dichiarazioni
+// =====================
+
+/**
+ * Suddivide un input in finestre di token (LEX_TOKENS), copiate in stream indipendenti
+ * così che la misura dell'analisi non includa il lexer.
+ */
+static bool lex_input(const SourceBuffer* buf, LexedInput* lexed) {
+    lexed->windows = NULL;
+    lexed->count = 0;
+    int capacity = 0;
+    Lexer lexer;
+    init_lexer(&lexer, buf->data, buf->size, CODE);
+    TokenStream tokens;
+    init_token_stream(&tokens);
+    bool ok = true;
+    while (ok && lex_window_as(&lexer, &tokens, LEX_TOKENS)) {
+        if (lexed->count >= capacity) {
+            int new_capacity = capacity ? capacity * 2 : 64;
+            TokenStream* new_windows = realloc(lexed->windows, sizeof(TokenStream) * (size_t)new_capacity);
+            if (!new_windows) {
+                ok = false;
+                break;
+            }
+            lexed->windows = new_windows;
+            capacity = new_capacity;
+        }
+        TokenStream* copy = &lexed->windows[lexed->count++];
+        init_token_stream(copy);
+        if (!reserve_token_stream(copy, tokens.count)) {
+            ok = false;
+            break;
+        }
+        memcpy(copy->kinds, tokens.kinds, (size_t)tokens.count);
+        memcpy(copy->offsets, tokens.offsets, sizeof(uint32_t) * (size_t)tokens.count);
+        memcpy(copy->lengths, tokens.lengths, sizeof(uint32_t) * (size_t)tokens.count);
+        copy->count = tokens.count;
+        copy->base = tokens.base;
+    }
+    free_token_stream(&tokens);
+    return ok;
+}
+
+static void free_lexed_input(LexedInput* lexed) {
+    for (int i = 0; i < lexed->count; ++i) free_token_stream(&lexed->windows[i]);
+    free(lexed->windows);
+    lexed->windows = NULL;
+    lexed->count = 0;
+}
+
+/**
+ * Passa all'analizzatore le righe mantenute di una finestra, come process_c_file.
+ * @return Righe analizzate.
+ */
+static long analyze_window(const TokenStream* tokens, int* line_num, ProcessingStats* stats) {
+    long calls = 0;
+    int line_first = 0;
+    for (int t = 0; t < tokens->count; ++t) {
+        unsigned char kind = tokens->kinds[t];
+        if (TOKEN_KIND(kind) != TOK_EOL) continue;
+        (*line_num)++;
+        if (TOKEN_KIND(tokens->kinds[line_first]) != TOK_INCLUDE && !(TOKEN_FLAGS(kind) & LINE_BLANK)) {
+            analyze_declaration_tokens(tokens, line_first, t, *line_num, BENCH_FILENAME, stats);
+            calls++;
+        }
+        line_first = t + 1;
+    }
+    return calls;
+}
+
+/**
+ * Prepara statistiche che mantengono ogni occorrenza degli errori, nell'ordine di rilevamento.
+ */
+static void init_bench_stats(ProcessingStats* stats) {
+    init_stats(stats, false);
+    configure_error_sink(stats, NULL, NULL, false, -1);
+}
+
+/**
+ * Verifica differenziale dell'analisi: i token delle finestre del lexer e quelli prodotti
+ * riga per riga (un lexer per riga, con lo stato dei commenti riportato da una riga
+ * all'altra) devono dare gli stessi errori, nello stesso ordine.
+ */
+static bool check_declarations(const BenchInput* input, const LexedInput* lexed) {
+    ProcessingStats windowed, per_line;
+    init_bench_stats(&windowed);
+    init_bench_stats(&per_line);
+    int line_num = 0;
+    for (int w = 0; w < lexed->count; ++w) analyze_window(&lexed->windows[w], &line_num, &windowed);
+
+    // I confini delle righe vengono dai token EOL: ogni riga è riletta da un lexer dedicato
+    TokenStream line_tokens;
+    init_token_stream(&line_tokens);
+    CommentState state = CODE;
+    line_num = 0;
+    bool lexed_ok = true;
+    for (int w = 0; lexed_ok && w < lexed->count; ++w) {
+        const TokenStream* window = &lexed->windows[w];
+        for (int t = 0; t < window->count; ++t) {
+            if (TOKEN_KIND(window->kinds[t]) != TOK_EOL) continue;
+            Lexer single;
+            init_lexer(&single, window->base + window->offsets[t], window->lengths[t], state);
+            if (!lex_window_as(&single, &line_tokens, LEX_TOKENS) || single.pos != single.size) {
+                lexed_ok = false;
+                break;
+            }
+            state = single.state;
+            line_num++;
+            int end = line_tokens.count - 1;
+            if (TOKEN_KIND(line_tokens.kinds[0]) != TOK_INCLUDE && !(TOKEN_FLAGS(line_tokens.kinds[end]) & LINE_BLANK)) {
+                analyze_declaration_tokens(&line_tokens, 0, end, line_num, BENCH_FILENAME, &per_line);
+            }
+        }
+    }
+    free_token_stream(&line_tokens);
+
+    bool same = lexed_ok && windowed.errors_found == per_line.errors_found && windowed.vars_checked == per_line.vars_checked &&
+                windowed.errors_retained == per_line.errors_retained;
+    for (int i = 0; same && i < windowed.errors_retained; ++i) {
+        const IdentifierError* a = &windowed.errors[i];
+        const IdentifierError* b = &per_line.errors[i];
+        same = a->line_number == b->line_number && a->kind == b->kind && strcmp(a->identifier_name, b->identifier_name) == 0;
+    }
+    if (!same) {
+        fprintf(stderr, "Errore: analisi delle dichiarazioni su '%s': %d/%d errori e %d/%d variabili tra finestre e righe singole.\n",
+                input->name, windowed.errors_found, per_line.errors_found, windowed.vars_checked, per_line.vars_checked);
+    }
+    free_stats(&windowed);
+    free_stats(&per_line);
+    return same;
+}
+
+// =====================
+// Kernel: parole e direttive
+// =====================
+
+/**
+ * Riferimento per le direttive: la riga è un #include valido per il lexer se e solo se
+ * extract_include_filename ne estrae un nome.
+ */
+static bool check_include_lines(const BenchWords* w) {
+    TokenStream tokens;
+    init_token_stream(&tokens);
+    bool same = true;
+    int i;
+    for (i = 0; same && i < w->count; ++i) {
+        Lexer lexer;
+        init_lexer(&lexer, w->items[i], strlen(w->items[i]), CODE);
+        if (!lex_window_as(&lexer, &tokens, LEX_LINES)) {
+            same = false;
+            break;
+        }
+        char* filename = extract_include_filename(w->items[i]);
+        same = (TOKEN_KIND(tokens.kinds[0]) == TOK_INCLUDE) == (filename != NULL);
+        free(filename);
+    }
+    free_token_stream(&tokens);
+    if (!same) return false;
+    return true;
+}
+
+// =====================
+// Misura
+// =====================
+
+// Kernel misurato: esegue una ripetizione e restituisce il numero di chiamate
+typedef long (*KernelFn)(void* context);
+
+typedef struct {
+    const SourceBuffer* buf;
+    LexMode mode;
+    bool reference;
+    char* out;
+    size_t written;
+    int comments;
+} StripContext;
+
+typedef struct {
+    const LexedInput* lexed;
+} DeclContext;
+
+typedef struct {
+    const BenchWords* words;
+    long sink;
+} WordsContext;
+
+typedef struct {
+    const SourceBuffer* buf;
+    long size;
+    int lines;
+} PreStatsContext;
+
+static long run_strip(void* context) {
+    StripContext* c = context;
+    long calls;
+    if (c->reference) c->written = strip_reference(c->buf, c->out, &c->comments, &calls);
+    else c->written = strip_lexer(c->buf, c->mode, c->out, &c->comments, &calls);
+    return calls;
+}
+
+static long run_declarations(void* context) {
+    DeclContext* c = context;
+    ProcessingStats stats;
+    init_bench_stats(&stats);
+    int line_num = 0;
+    long calls = 0;
+    for (int w = 0; w < c->lexed->count; ++w) calls += analyze_window(&c->lexed->windows[w], &line_num, &stats);
+    free_stats(&stats);
+    return calls;
+}
+
+static long run_identifiers(void* context) {
+    WordsContext* c = context;
+    for (int i = 0; i < c->words->count; ++i) c->sink += is_valid_c_identifier(c->words->items[i]);
+    return c->words->count;
+}
+
+static long run_includes(void* context) {
+    WordsContext* c = context;
+    for (int i = 0; i < c->words->count; ++i) {
+        char* filename = extract_include_filename(c->words->items[i]);
+        if (filename) c->sink += (long)strlen(filename);
+        free(filename);
+    }
+    return c->words->count;
+}
+
+static long run_pre_stats(void* context) {
+    PreStatsContext* c = context;
+    get_file_pre_stats(c->buf, &c->size, &c->lines);
+    return 1;
+}
+
+/**
+ * Indica se un kernel è selezionato dal filtro --filter.
+ */
+static bool selected(const char* kernel) {
+    return !options.filter || strstr(kernel, options.filter) != NULL;
+}
+
+/**
+ * Misura un kernel ripetendolo finché non supera il tempo minimo (dopo una ripetizione
+ * di riscaldamento) e stampa una riga della tabella.
+ * @param verdict Esito della verifica differenziale ("ok", "FAIL" o "-" se non c'è un riferimento).
+ */
+static void measure(const char* kernel, const char* input, size_t bytes, KernelFn fn, void* context, const char* verdict) {
+    long calls = fn(context);
+    if (options.check_only) {
+        printf("%-14s %-18s %10zu %10ld %10s %10s  %s\n", kernel, input, bytes, calls, "-", "-", verdict);
+        return;
+    }
+    long reps = 0;
+    calls = 0;
+    uint64_t start = monotonic_ns();
+    uint64_t elapsed;
+    do {
+        calls += fn(context);
+        reps++;
+        elapsed = monotonic_ns() - start;
+    } while (elapsed < options.min_ns);
+    double ns = (double)elapsed;
+    printf("%-14s %-18s %10zu %10ld %10.3f %10.1f  %s\n", kernel, input, bytes, calls / reps,
+           ns / ((double)bytes * (double)reps), calls > 0 ? ns / (double)calls : 0.0, verdict);
+    fflush(stdout);
+}
+
+// =====================
+// Esecuzione dei kernel
+// =====================
+
+/**
+ * Rimozione dei commenti: riferimento per righe, lexer a porzioni e lexer completo.
+ */
+static void bench_strip(const BenchInput* input) {
+    size_t capacity = input->buf.size * 2 + MAX_LINE_LEN;
+    char* ref_out = malloc(capacity);
+    char* out = malloc(capacity);
+    if (!ref_out || !out) {
+        perror("Errore: Impossibile allocare memoria per l'output del benchmark");
+        exit(1);
+    }
+    StripContext ref = { &input->buf, LEX_TOKENS, true, ref_out, 0, 0 };
+    run_strip(&ref);
+    if (selected("strip-ref")) measure("strip-ref", input->name, input->buf.size, run_strip, &ref, "rif.");
+
+    static const struct { const char* name; LexMode mode; } variants[] = {
+        { "strip-spans", LEX_SPANS },
+        { "strip-tokens", LEX_TOKENS },
+    };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v) {
+        if (!selected(variants[v].name)) continue;
+        StripContext c = { &input->buf, variants[v].mode, false, out, 0, 0 };
+        run_strip(&c);
+        bool ok = same_output(variants[v].name, input->name, ref.out, ref.written, ref.comments, c.out, c.written, c.comments);
+        if (!ok) failures++;
+        measure(variants[v].name, input->name, input->buf.size, run_strip, &c, ok ? "ok" : "FAIL");
+    }
+    free(ref_out);
+    free(out);
+}
+
+/**
+ * Analisi delle dichiarazioni sui token già prodotti dal lexer.
+ */
+static void bench_declarations(const BenchInput* input) {
+    if (!selected("decl")) return;
+    LexedInput lexed;
+    if (!lex_input(&input->buf, &lexed)) {
+        perror("Errore: Impossibile allocare memoria per i token del benchmark");
+        exit(1);
+    }
+    bool ok = check_declarations(input, &lexed);
+    if (!ok) failures++;
+    DeclContext c = { &lexed };
+    measure("decl", input->name, input->buf.size, run_declarations, &c, ok ? "ok" : "FAIL");
+    free_lexed_input(&lexed);
+}
+
+/**
+ * Conteggio preliminare di byte e righe, confrontato con le righe lette da read_buffer_line.
+ */
+static void bench_pre_stats(const BenchInput* input) {
+    if (!selected("pre-stats")) return;
+    char* line = malloc(input->buf.size + 2);
+    if (!line) {
+        perror("Errore: Impossibile allocare memoria per la riga del benchmark");
+        exit(1);
+    }
+    size_t pos = 0;
+    int ref_lines = 0;
+    while (read_buffer_line(&input->buf, &pos, line, input->buf.size + 2) != NULL) ref_lines++;
+    free(line);
+
+    PreStatsContext c = { &input->buf, 0, 0 };
+    run_pre_stats(&c);
+    bool ok = c.size == (long)input->buf.size && c.lines == ref_lines;
+    if (!ok) {
+        fprintf(stderr, "Errore: pre-stats su '%s': %d righe contro %d del riferimento.\n", input->name, c.lines, ref_lines);
+        failures++;
+    }
+    measure("pre-stats", input->name, input->buf.size, run_pre_stats, &c, ok ? "ok" : "FAIL");
+}
+
+/**
+ * Identificatori (nessuna variante ottimizzata da verificare) e direttive #include.
+ * Durante le direttive stderr è rediretto su /dev/null: le righe malformate producono
+ * un avviso per ogni chiamata.
+ */
+static void bench_words(const BenchWords* identifiers, const BenchWords* includes) {
+    if (selected("identifier")) {
+        WordsContext c = { identifiers, 0 };
+        measure("identifier", identifiers->name, identifiers->bytes, run_identifiers, &c, "-");
+    }
+    if (selected("include")) {
+        fflush(stderr);
+        int saved = dup(STDERR_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (saved >= 0 && null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+        bool ok = check_include_lines(includes);
+        WordsContext c = { includes, 0 };
+        measure("include", includes->name, includes->bytes, run_includes, &c, ok ? "ok" : "FAIL");
+        fflush(stderr);
+        if (saved >= 0) {
+            dup2(saved, STDERR_FILENO);
+            close(saved);
+        }
+        if (null_fd >= 0) close(null_fd);
+        if (!ok) {
+            fprintf(stderr, "Errore: extract_include_filename e il lexer non concordano sulle direttive valide.\n");
+            failures++;
+        }
+    }
+}
+
+static void print_usage(const char* prog_name) {
+    fprintf(stderr, "Uso: %s [--seed=N] [--size=BYTE] [--min-time=MS] [--filter=KERNEL] [--check-only]\n", prog_name);
+    fprintf(stderr, "  --seed=N         Seme del generatore degli input (default: 1)\n");
+    fprintf(stderr, "  --size=BYTE      Dimensione di ciascun input generato (default: %d)\n", BENCH_DEFAULT_SIZE);
+    fprintf(stderr, "  --min-time=MS    Tempo minimo di misura per kernel e input (default: %d)\n", BENCH_DEFAULT_MIN_MS);
+    fprintf(stderr, "  --filter=KERNEL  Esegue solo i kernel il cui nome contiene KERNEL\n");
+    fprintf(stderr, "  --check-only     Esegue solo le verifiche differenziali, senza misure\n");
+    fprintf(stderr, "Kernel: strip-ref, strip-spans, strip-tokens, decl, identifier, include, pre-stats.\n");
+}
+
+int main(int argc, char* argv[]) {
+    options.seed = 1;
+    options.size = BENCH_DEFAULT_SIZE;
+    options.min_ns = (uint64_t)BENCH_DEFAULT_MIN_MS * 1000000ull;
+
+    for (int i = 1; i < argc; ++i) {
+        char* end = NULL;
+        if (strncmp(argv[i], "--seed=", 7) == 0) {
+            options.seed = strtoull(argv[i] + 7, &end, 10);
+        } else if (strncmp(argv[i], "--size=", 7) == 0) {
+            options.size = (size_t)strtoull(argv[i] + 7, &end, 10);
+            if (options.size == 0) end = NULL;
+        } else if (strncmp(argv[i], "--min-time=", 11) == 0) {
+            options.min_ns = strtoull(argv[i] + 11, &end, 10) * 1000000ull;
+        } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+            options.filter = argv[i] + 9;
+            continue;
+        } else if (strcmp(argv[i], "--check-only") == 0) {
+            options.check_only = true;
+            continue;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (!end || *end != '\0') {
+            fprintf(stderr, "Errore: Argomento non valido '%s'.\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Lo stato del generatore non può essere nullo
+    rng_state = options.seed ? options.seed : 0x9E3779B97F4A7C15ULL;
+
+    static const struct { const char* name; void (*generate)(TextBuilder*, size_t); } generators[] = {
+        { "misto", generate_mixed },
+        { "commenti-annidati", generate_nested_comments },
+        { "righe-lunghe", generate_long_lines },
+        { "dichiarazioni", generate_declarations },
+        { "byte-casuali", generate_random_bytes },
+    };
+    const int input_count = (int)(sizeof(generators) / sizeof(generators[0]));
+    BenchInput inputs[sizeof(generators) / sizeof(generators[0])];
+    for (int i = 0; i < input_count; ++i) {
+        TextBuilder t = { NULL, 0, 0 };
+        generators[i].generate(&t, options.size);
+        inputs[i].name = generators[i].name;
+        inputs[i].buf = (SourceBuffer){ t.data, t.size, 0, true, NULL };
+    }
+    BenchWords identifiers, includes;
+    generate_identifier_words(&identifiers);
+    generate_include_lines(&includes);
+    if (!identifiers.items || !includes.items) {
+        perror("Errore: Impossibile allocare memoria per le parole del benchmark");
+        return 1;
+    }
+
+    printf("%-14s %-18s %10s %10s %10s %10s  %s\n", "Kernel", "Input", "Byte", "Chiamate", "ns/byte", "ns/chiam.", "Verifica");
+    for (int i = 0; i < input_count; ++i) bench_strip(&inputs[i]);
+    for (int i = 0; i < input_count; ++i) bench_declarations(&inputs[i]);
+    for (int i = 0; i < input_count; ++i) bench_pre_stats(&inputs[i]);
+    bench_words(&identifiers, &includes);
+
+    for (int i = 0; i < input_count; ++i) free(inputs[i].buf.data);
+    free_words(&identifiers);
+    free_words(&includes);
+
+    if (failures > 0) {
+        fprintf(stderr, "Errore: %d verifiche differenziali non superate.\n", failures);
+        return 1;
+    }
+    return 0;
+}
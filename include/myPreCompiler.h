@@ -3,13 +3,121 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =======================
+// Costanti e Stati di Elaborazione
+// =======================
+
+// Dimensione massima di una riga letta dal file sorgente
+#define MAX_LINE_LEN 4096
+// Profondità massima consentita per l'inclusione ricorsiva di file (#include)
+#define MAX_INCLUDE_DEPTH 10
+
+// Rimozione dei commenti dal codice sorgente
+typedef enum {
+    CODE,           // Analisi normale del codice (non in commento)
+    SLASH,          // Trovato '/' in attesa di capire se è l'inizio di un commento
+    BLOCK_COMMENT,  // All'interno di un commento multi-linea /* ... */
+    LINE_COMMENT,   // All'interno di un commento su singola riga //
+    STAR_IN_BLOCK   // Trovato '*' all'interno di un commento multi-linea
+} CommentState;
+
+// Numero massimo di parametri che nascondono nomi esterni segnalati per una funzione
+#define MAX_DEFERRED_SHADOWS 64
+// Posizioni dell'indice hash delle parole chiave dell'analizzatore (potenza di 2)
+#define KEYWORD_SLOTS 128
+
+// Tipo di errore rilevato dall'analisi delle dichiarazioni
+typedef enum {
+    ERR_INVALID_IDENTIFIER,     // Nome dichiarato non valido come identificatore C
+    ERR_DUPLICATE_DECLARATION,  // Nome già dichiarato (o definito) nello stesso scope
+    ERR_SHADOWED_DECLARATION    // Nome che nasconde una dichiarazione di uno scope esterno
+} IdentifierErrorKind;
+
+// Tipo di un simbolo nella tabella di uno scope
+typedef enum {
+    SYM_VARIABLE,   // Variabile, parametro o membro
+    SYM_FUNCTION,   // Funzione (prototipo o definizione)
+    SYM_TYPEDEF,    // Nome di tipo definito con typedef
+    SYM_CONSTANT    // Costante di enumerazione
+} SymbolKind;
+
+// Tipo di scope, delimitato dalle parentesi graffe
+typedef enum {
+    SCOPE_FILE,     // Scope del file (unità di traduzione)
+    SCOPE_FUNCTION, // Parametri e corpo di una funzione
+    SCOPE_BLOCK,    // Blocco { ... } all'interno di una funzione
+    SCOPE_MEMBERS   // Corpo di struct/union (i membri non nascondono altri nomi)
+} ScopeKind;
+
+// Tipi di token prodotti dal lexer (campo kind dello stream di token)
+typedef enum {
+    TOK_WORD,       // Caratteri di codice diversi da spazi e delimitatori
+    TOK_SEP,        // Spazi, '\n' e delimitatori , ; * ( ) [ ] = { } mantenuti
+    TOK_SLASH,      // '/' rimasto in sospeso alla fine della riga precedente (nessun riferimento al sorgente)
+    TOK_INCLUDE,    // Riga con direttiva #include valida (non attraversa la macchina dei commenti)
+    TOK_EOL         // Fine riga: offset e lunghezza della riga originale, flag LINE_* nei bit alti
+} TokenKind;
+
+// Il campo kind contiene il tipo nei 4 bit bassi e, per TOK_EOL, i flag della riga nei 4 bit alti
+#define TOKEN_FLAGS_SHIFT 4
+#define TOKEN_KIND(k) ((k) & 0x0F)
+#define TOKEN_FLAGS(k) ((k) >> TOKEN_FLAGS_SHIFT)
+
+// Flag di riga associati al token TOK_EOL
+#define LINE_HAD_COMMENT   0x1  // La riga conteneva almeno un carattere di commento
+#define LINE_BLANK         0x2  // La riga processata contiene solo spazi
+#define LINE_COUNT_COMMENT 0x4  // La riga va conteggiata tra le righe di commento eliminate
+#define LINE_BAD_INCLUDE   0x8  // La riga inizia con #include ma la direttiva non è valida
+
+// Livello di dettaglio dei token prodotti dal lexer, secondo gli stadi attivi
+typedef enum {
+    LEX_TOKENS,     // Parole e separatori (analisi delle dichiarazioni)
+    LEX_SPANS,      // Un token per porzione di codice (sola rimozione dei commenti)
+    LEX_LINES       // Solo direttive #include e token EOL (commenti mantenuti)
+} LexMode;
+
+// Stadi di elaborazione selezionabili con --only (maschera di bit)
+#define STAGE_STRIP    0x1  // Rimozione dei commenti
+#define STAGE_INCLUDES 0x2  // Espansione delle direttive #include
+#define STAGE_CHECK    0x4  // Analisi delle dichiarazioni
+#define STAGE_ALL      (STAGE_STRIP | STAGE_INCLUDES | STAGE_CHECK)
+
+// Formato di compressione di un file di input o di output
+typedef enum {
+    CODEC_NONE,     // File non compresso
+    CODEC_GZIP,     // gzip (zlib)
+    CODEC_ZSTD      // zstd (disponibile se compilato con -DHAVE_ZSTD)
+} Codec;
+
+// Formato del profilo delle inclusioni (--profile-format)
+typedef enum {
+    PROFILE_TEXT,           // Tabella ordinata per byte cumulativi
+    PROFILE_JSON,           // Un oggetto per header
+    PROFILE_COLLAPSED,      // Stack compressi per i flamegraph, pesati per byte propri
+    PROFILE_COLLAPSED_TIME  // Stack compressi pesati per tempo proprio (microsecondi)
+} ProfileFormat;
+
+// Adattamenti applicati per restare entro il budget di memoria (--max-memory)
+typedef enum {
+    MEMORY_EVICTED_FILE,     // File rimosso dalla cache
+    MEMORY_SKIPPED_PREFETCH, // File letto in anticipo ma non tenuto in cache
+    MEMORY_REDUCED_BUFFERS,  // Ondata della rimozione parallela eseguita con meno chunk
+    MEMORY_ERRORS_STREAMED   // Raccolta degli errori passata allo streaming
+} MemoryFallback;
+
+// Forza l'espansione delle funzioni da cui sono generate le varianti specializzate
+#define ALWAYS_INLINE inline __attribute__((always_inline))
 
 // =======================
 // Strutture Dati Principali
 // =======================
 
 /**
- * Rappresenta un errore relativo a un identificatore non valido.
+ * Rappresenta un errore rilevato dall'analisi delle dichiarazioni (identificatore non
+ * valido, dichiarazione duplicata o che ne nasconde una esterna).
  * Contiene il nome del file, il numero di riga e il nome dell'identificatore incriminato.
  * Tutti i campi stringa sono allocati dinamicamente e vanno liberati.
  */
@@ -17,8 +125,44 @@ typedef struct {
     char* filename;         // Nome del file dove si trova l'errore
     int line_number;        // Numero di riga dell'errore
     char* identifier_name;  // Nome dell'identificatore errato
+    IdentifierErrorKind kind; // Tipo di errore
+    int occurrences;        // Occorrenze della coppia (file, identificatore) accorpate
+    long sequence;          // Ordine di rilevamento della prima occorrenza
+    uint64_t key;           // Hash di (file, identificatore, tipo) usato per l'accorpamento
 } IdentifierError;
 
+// Funzione che riceve le diagnostiche in streaming, al momento del rilevamento
+typedef void (*ErrorSinkWriter)(void* context, const IdentifierError* error);
+
+/**
+ * Posizione dell'insieme delle coppie già segnalate (indirizzamento aperto).
+ */
+typedef struct {
+    uint64_t key;           // Hash della coppia (0 = posizione libera)
+    int occurrences;        // Occorrenze rilevate
+    int retained;           // Posizione nell'array errors (-1 se non mantenuta in memoria)
+    int first_line;         // Riga della prima occorrenza
+    long first_sequence;    // Ordine di rilevamento della prima occorrenza
+} ErrorSeenSlot;
+
+/**
+ * Destinazione degli errori sugli identificatori: streaming opzionale verso un writer,
+ * accorpamento delle coppie (file, identificatore) ripetute e mantenimento in memoria
+ * delle sole max_retained coppie più frequenti. I totali contano ogni occorrenza.
+ */
+typedef struct {
+    ErrorSinkWriter write;  // Writer delle diagnostiche (NULL = nessuno streaming)
+    void* context;          // Argomento del writer (ad esempio un FILE*)
+    bool dedup;             // Accorpa le occorrenze ripetute della stessa coppia
+    int max_retained;       // Errori mantenuti in memoria (-1 = tutti)
+    bool spilled;           // Passato allo streaming per restare entro il budget di memoria
+    ErrorSeenSlot* seen;    // Insieme delle coppie già segnalate
+    int seen_capacity;      // Dimensione dell'insieme (potenza di 2)
+    int seen_count;         // Coppie distinte
+    int kind_totals[3];     // Occorrenze per tipo di errore
+    long next_sequence;     // Numero d'ordine della prossima coppia
+} ErrorSink;
+
 /**
  * Raccoglie statistiche su un singolo file processato.
  * Utile sia per il file principale che per i file inclusi.
@@ -26,18 +170,365 @@ typedef struct {
 typedef struct {
     char* filename;         // Nome del file (allocato dinamicamente)
     long size_bytes;        // Dimensione del file in byte
+    long compressed_bytes;  // Dimensione compressa su disco (0 se il file non è compresso)
     int lines;              // Numero di righe del file
 } FileStats;
 
+/**
+ * Contenuto di un file sorgente caricato interamente in memoria.
+ * Il buffer è sempre terminato da '\0' (non conteggiato in size).
+ */
+typedef struct {
+    char* data;             // Contenuto del file
+    size_t size;            // Dimensione del contenuto in byte
+    size_t compressed_size; // Byte letti dal disco se il file è compresso (0 altrimenti)
+    bool owned;             // true se il buffer va liberato dal chiamante (lettura sincrona)
+    int* pins;              // Contatore d'uso della voce di cache (NULL se il buffer non viene dalla cache)
+} SourceBuffer;
+
+/**
+ * Voce della cache dei file letti in anticipo (prefetch dell'albero degli include).
+ */
+typedef struct {
+    char* filename;         // Nome del file (allocato dinamicamente)
+    char* data;             // Contenuto del file terminato da '\0'
+    size_t size;            // Dimensione del contenuto in byte
+    size_t compressed_size; // Byte letti dal disco se il file è compresso (0 altrimenti)
+    int pins;               // Buffer ottenuti da read_source_file e non ancora rilasciati
+    long last_use;          // Ultimo accesso (per la rimozione dei file meno usati di recente)
+} CachedFile;
+
+/**
+ * Cache dei file sorgente già letti, popolata dal prefetch batch via io_uring.
+ * I file non presenti vengono letti in modo sincrono al momento dell'uso.
+ * Con un budget di memoria il contenuto dei file non in uso può essere rimosso
+ * (data = NULL): il file viene allora riletto dal disco.
+ */
+typedef struct {
+    CachedFile* entries;    // Array dinamico dei file in cache
+    int count;              // Numero di file in cache
+    int capacity;           // Capacità attuale dell'array entries
+    long clock;             // Contatore degli accessi
+} FileCache;
+
+/**
+ * Segmento di memoria condivisa POSIX con gli header già elaborati, comune a tutti i
+ * processi che lo aprono con lo stesso nome (formato interno a shm_cache.c).
+ */
+typedef struct {
+    char* base;             // Mappatura del segmento (NULL = cache non aperta)
+    size_t size;            // Dimensione della mappatura in byte
+    uint64_t cwd_dev;       // Directory di lavoro: i nomi degli include sono relativi a essa
+    uint64_t cwd_ino;
+    uint64_t owner;         // Identità del processo nelle voci che riserva (interna a shm_cache.c)
+} SharedHeaderCache;
+
+/**
+ * Occorrenza di un file nell'albero delle inclusioni.
+ * Gli offset si riferiscono ai byte scritti in output e comprendono le espansioni annidate.
+ */
+typedef struct {
+    char* filename;         // Nome del file (allocato dinamicamente)
+    int depth;              // Profondità di inclusione
+    int parent;             // Indice del nodo che lo include (-1 per il file principale)
+    int include_line;       // Riga della direttiva #include nel file padre (0 per il file principale)
+    long output_start;      // Offset del primo byte prodotto in output
+    long output_end;        // Offset successivo all'ultimo byte prodotto in output
+    int lines_start;        // Righe scritte in output prima del file
+    int lines_end;          // Righe scritte in output alla fine del file
+    uint64_t time_start_ns; // Istante di inizio dell'elaborazione (CLOCK_MONOTONIC)
+    uint64_t time_end_ns;   // Istante di fine dell'elaborazione
+} IncludeNode;
+
+/**
+ * Grafo delle inclusioni registrato durante l'elaborazione.
+ * I nodi sono memorizzati in ordine di visita (pre-ordine): il sottoalbero di un nodo
+ * occupa posizioni contigue subito dopo il nodo stesso.
+ */
+typedef struct {
+    IncludeNode* nodes;     // Array dinamico dei nodi
+    int count;              // Numero di nodi
+    int capacity;           // Capacità attuale dell'array nodes
+    int current;            // Nodo in elaborazione (-1 se nessuno)
+    int next_include_line;  // Riga della direttiva che sta per essere espansa
+} IncludeGraph;
+
+/**
+ * Opzioni di elaborazione condivise da tutti i livelli di inclusione.
+ */
+typedef struct {
+    FileCache* file_cache;  // Cache dei file letti in anticipo (NULL = solo lettura sincrona)
+    int strip_threads;      // Thread per la rimozione parallela dei commenti nei file grandi (1 = sequenziale)
+    IncludeGraph* include_graph; // Grafo delle inclusioni da registrare (NULL = disabilitato)
+    bool use_pch;           // Usa i file .pch aggiornati accanto agli header inclusi
+    SharedHeaderCache* shm_cache; // Header elaborati condivisi tra processi (NULL = disabilitata)
+    unsigned stages;        // Stadi attivi (maschera STAGE_*)
+    bool minify;            // Compatta gli spazi fuori dai letterali ed elimina le righe vuote
+    bool line_markers;      // Con minify: marcatori #line dove la numerazione si interrompe
+} ProcessingOptions;
+
+/**
+ * Opzioni del rapporto di avanzamento. Il rapporto viene sempre scritto alla ricezione
+ * di SIGUSR1; periodicamente solo se interval > 0.
+ */
+typedef struct {
+    int interval;           // Secondi tra due rapporti periodici (0 = solo su SIGUSR1)
+    int timeout;            // Secondi senza avanzamento dopo cui interrompere (0 = nessun watchdog)
+    const char* status_file;// File riscritto a ogni rapporto (NULL = stderr)
+} ProgressOptions;
+
+/**
+ * Memoria allocata dalle strutture del precompilatore (buffer dei file, cache, token,
+ * analizzatore, errori, statistiche, grafo delle inclusioni, codec) e adattamenti
+ * applicati per rispettare il budget.
+ */
+typedef struct {
+    long live_bytes;        // Byte allocati al momento della lettura
+    long peak_bytes;        // Massimo di live_bytes
+    long budget_bytes;      // Budget impostato con --max-memory (0 = nessuno)
+    int evicted_files;      // File rimossi dalla cache
+    long evicted_bytes;     // Byte liberati rimuovendo file dalla cache
+    int skipped_prefetch;   // File letti in anticipo ma non tenuti in cache
+    int reduced_buffers;    // Ondate della rimozione parallela eseguite con meno chunk
+    bool errors_streamed;   // Raccolta degli errori passata allo streaming
+} MemoryStats;
+
+// =======================
+// Formato dei Header Precompilati (.pch)
+// =======================
+
+// I file sono scritti nell'ordine dei byte della macchina: byte_order permette di
+// riconoscere un file prodotto su un'architettura diversa, version un formato diverso.
+#define PCH_MAGIC "MYPCH\x1a\n"   // 7 caratteri più '\0' (campo magic di 8 byte)
+#define PCH_VERSION 2
+#define PCH_BYTE_ORDER 0x01020304u
+#define PCH_SUFFIX ".pch"           // Suffisso aggiunto al nome dell'header
+
+/**
+ * Sezione di un file .pch: posizione (allineata a 8 byte) e numero di elementi
+ * (byte per output e stringhe, record per le altre sezioni).
+ */
+typedef struct {
+    uint64_t offset;
+    uint64_t count;
+} PchSection;
+
+/**
+ * Intestazione di un file .pch. I nomi nei record sono offset nella sezione strings
+ * (stringhe terminate da '\0').
+ */
+typedef struct {
+    char magic[8];          // PCH_MAGIC
+    uint32_t version;       // PCH_VERSION
+    uint32_t byte_order;    // PCH_BYTE_ORDER
+    uint32_t header_size;   // sizeof(PchHeader)
+    uint32_t max_depth;     // Profondità massima delle inclusioni annidate (relativa all'header)
+    PchSection output;      // Byte processati (include annidati già espansi)
+    PchSection strings;     // Pool delle stringhe
+    PchSection deps;        // PchDependency: l'header e tutti i file inclusi
+    PchSection files;       // PchFileStats, nell'ordine di registrazione
+    PchSection errors;      // PchError, nell'ordine di rilevamento
+    PchSection symbols;     // PchSymbol: simboli dello scope del file dichiarati dall'header
+    int64_t vars_checked;   // Contatori delle statistiche
+    int64_t comments_removed;
+    int64_t output_lines;
+} PchHeader;
+
+// Dipendenza: file letto durante la generazione, con i dati per verificarne l'attualità
+typedef struct {
+    uint32_t name;          // Nome del file (come nella direttiva #include)
+    uint32_t reserved;
+    int64_t size;           // Dimensione in byte
+    int64_t mtime_sec;      // Data di modifica (secondi)
+    int64_t mtime_nsec;     // Data di modifica (nanosecondi)
+    uint64_t hash;          // Hash FNV-1a a 64 bit del contenuto
+} PchDependency;
+
+// Record FileStats serializzato
+typedef struct {
+    uint32_t name;
+    int32_t lines;
+    int64_t size_bytes;
+    int64_t compressed_bytes;
+} PchFileStats;
+
+// Record IdentifierError serializzato
+typedef struct {
+    uint32_t filename;
+    uint32_t identifier;
+    int32_t line;
+    int32_t kind;           // IdentifierErrorKind
+} PchError;
+
+// Simbolo dello scope del file esportato dall'header
+typedef struct {
+    uint32_t name;
+    uint32_t filename;      // File in cui il simbolo è dichiarato
+    int32_t line;
+    uint8_t kind;           // SymbolKind
+    uint8_t defined;
+    uint8_t reserved[2];
+} PchSymbol;
+
+/**
+ * Stream di token in formato structure-of-arrays: tipo, offset e lunghezza sono
+ * memorizzati in array separati, così i consumatori scorrono solo i campi che usano.
+ * Gli offset sono relativi a base; ogni riga termina con un token TOK_EOL. I commenti
+ * non producono token: due token adiacenti ma non contigui erano separati da un commento.
+ */
+typedef struct {
+    const char* base;       // Inizio del testo a cui si riferiscono gli offset (non posseduto)
+    unsigned char* kinds;   // Tipo del token (TokenKind) ed eventuali flag di riga
+    uint32_t* offsets;      // Offset del token rispetto a base
+    uint32_t* lengths;      // Lunghezza del token in byte
+    int count;              // Numero di token presenti
+    int capacity;           // Capacità attuale degli array
+} TokenStream;
+
+/**
+ * Lexer incrementale: scandisce un buffer una sola volta producendo finestre di token
+ * per righe intere, mantenendo lo stato della macchina dei commenti tra le finestre.
+ */
+typedef struct {
+    const char* data;       // Buffer sorgente (non posseduto)
+    size_t size;            // Dimensione del buffer
+    size_t pos;             // Inizio della prossima riga da analizzare
+    CommentState state;     // Stato della macchina dei commenti
+    bool includes;          // Riconosce le direttive #include (false = righe di codice ordinarie)
+} Lexer;
+
+/**
+ * Simbolo dichiarato in uno scope. Nome e simbolo sono allocati nell'arena dell'analizzatore.
+ */
+typedef struct Symbol {
+    const char* name;       // Nome (terminato da '\0')
+    uint32_t length;        // Lunghezza del nome
+    uint32_t hash;          // Hash del nome
+    int line;               // Riga della prima dichiarazione
+    int origin;             // Nodo del grafo delle inclusioni del file dichiarante (-1 se non registrato)
+    int scope;              // Indice dello scope nella pila
+    unsigned char kind;     // SymbolKind
+    bool defined;           // Definizione (inizializzatore o corpo di funzione)
+    struct Symbol* shadowed;   // Dichiarazione dello stesso nome in uno scope esterno (NULL se nessuna)
+    struct Symbol* scope_next; // Simbolo dichiarato prima nello stesso scope
+} Symbol;
+
+/**
+ * Posizione della tabella dei nomi: l'hash è copiato accanto al puntatore, così una
+ * ricerca legge il simbolo solo quando l'hash coincide. Una posizione resta occupata
+ * anche quando il nome non è più visibile, per non interrompere le sequenze di scansione.
+ */
+typedef struct {
+    uint32_t hash;          // Hash del nome (valido se used)
+    bool used;              // Posizione assegnata a un nome
+    Symbol* binding;        // Dichiarazione visibile più interna (NULL se nessuna)
+} NameSlot;
+
+/**
+ * Scope aperto: elenco dei simboli dichiarati e posizione dell'arena all'apertura,
+ * a cui viene riportata alla chiusura.
+ */
+typedef struct {
+    Symbol* symbols;        // Ultimo simbolo dichiarato (elenco collegato da scope_next)
+    int count;              // Simboli dichiarati
+    unsigned char kind;     // ScopeKind
+    unsigned char resume_state; // Stato del parser da riprendere alla chiusura
+    bool resume_typedef;    // Flag typedef dell'istruzione che ha aperto lo scope
+    unsigned char loop;     // Scope di un ciclo for: intestazione o corpo (interno ad analyzer.c)
+    int mark_block;         // Blocco corrente dell'arena all'apertura
+    size_t mark_used;       // Byte usati nel blocco all'apertura
+} Scope;
+
+/**
+ * Arena a blocchi per i simboli: allocazione lineare e rilascio in blocco
+ * alla chiusura di ogni scope.
+ */
+typedef struct {
+    char** blocks;          // Blocchi di memoria
+    size_t* sizes;          // Dimensione di ogni blocco
+    int count;              // Blocchi allocati
+    int capacity;           // Capacità degli array blocks e sizes
+    int current;            // Blocco in uso (-1 se nessuno)
+    size_t used;            // Byte usati nel blocco in uso
+} SymbolArena;
+
+/**
+ * Analizzatore delle dichiarazioni dell'unità di traduzione: parser delle istruzioni
+ * a singola passata guidato dai token, pila degli scope e tabella dei nomi visibili.
+ */
+typedef struct {
+    SymbolArena arena;      // Memoria dei simboli
+    Scope* scopes;          // Pila degli scope (il primo è lo scope del file)
+    int scope_count;        // Scope aperti
+    int scope_capacity;     // Capacità attuale dell'array scopes
+    NameSlot* names;        // Tabella dei nomi a indirizzamento aperto (NULL finché vuota)
+    int name_capacity;      // Dimensione della tabella (potenza di 2)
+    int name_used;          // Posizioni assegnate
+    int name_live;          // Posizioni con una dichiarazione visibile
+    int lost_scopes;        // Scope non aperti per errore di allocazione
+
+    int state;              // Stato del parser delle istruzioni (interno ad analyzer.c)
+    int return_state;       // Stato da riprendere dopo le parentesi saltate
+    int nest;               // Profondità delle parentesi nello stato corrente
+    bool stmt_typedef;      // L'istruzione corrente è un typedef
+    bool stmt_extern;       // L'istruzione corrente è extern
+    bool has_type;          // Specificatore di tipo già letto
+    bool grouped;           // Dichiaratore aperto tra parentesi: "(*nome"
+    bool pointer_group;     // Dichiaratore tra parentesi chiuso: "(*nome)"
+    bool extra_words;       // Parole (attributi, macro) dopo il nome del dichiaratore
+    bool tag_enum;          // Il tag corrente è un enum
+    bool tag_named;         // Il tag corrente ha un nome
+    bool expect_name;       // Nel corpo di un enum: attesa del nome della costante
+    bool in_directive;      // Riga di continuazione di una direttiva
+    bool prev_star;         // L'ultimo delimitatore letto è '*'
+    char quote;             // Delimitatore del letterale aperto ('\0' se nessuno)
+
+    char pending[MAX_LINE_LEN]; // Nome del dichiaratore in sospeso
+    size_t pending_len;     // Lunghezza del nome in sospeso
+    int pending_line;       // Riga del nome in sospeso
+    bool has_pending;       // C'è un dichiaratore valido in sospeso
+
+    char param[MAX_LINE_LEN]; // Candidato nome del parametro corrente
+    size_t param_len;       // Lunghezza del candidato
+    int param_line;         // Riga del candidato
+    bool has_param;         // C'è un candidato
+    bool after_tag;         // La parola precedente era struct/union/enum
+    int param_words;        // Parole del parametro corrente
+    int param_names;        // Parole non chiave del parametro corrente
+    Symbol* function;       // Funzione di cui si stanno leggendo i parametri
+    Symbol* deferred[MAX_DEFERRED_SHADOWS]; // Parametri che nascondono nomi esterni
+    int deferred_count;     // Elementi di deferred
+
+    const char* filename;   // File della riga in analisi
+    int line;               // Riga in analisi
+    unsigned char keyword_slots[KEYWORD_SLOTS]; // Indice hash delle parole chiave
+} DeclarationAnalyzer;
+
+/**
+ * Stato della minificazione dell'output, condiviso tra righe consecutive: la prosecuzione
+ * di una riga spezzata (più lunga di MAX_LINE_LEN o continuata con una barra rovesciata)
+ * conserva lo spazio separatore iniziale e lo stato dei letterali e non riceve marcatori #line.
+ */
+typedef struct {
+    long bytes_saved;       // Byte eliminati (spazi e righe vuote)
+    int markers;            // Marcatori #line scritti
+    bool mid_line;          // L'ultima riga scritta non termina con '\n' o termina con una continuazione
+    char quote;             // Letterale aperto alla fine dell'ultima riga ('\0' se nessuno)
+    char* marker_filename;  // File dell'ultima riga scritta (allocato dinamicamente)
+    int next_line;          // Riga che segue l'ultima scritta nel file marker_filename
+} MinifyState;
+
 /**
  * Struttura principale che raccoglie tutte le statistiche di elaborazione.
  * Tiene traccia di errori, commenti rimossi, file inclusi, output generato e modalità verbosa.
  */
 typedef struct {
     int vars_checked;               // Numero di variabili analizzate
-    int errors_found;               // Numero totale di errori trovati
-    IdentifierError* errors;        // Array dinamico di errori sugli identificatori
+    int errors_found;               // Numero totale di errori trovati (ogni occorrenza)
+    IdentifierError* errors;        // Array dinamico degli errori mantenuti in memoria
+    int errors_retained;            // Elementi dell'array errors
     int error_capacity;             // Capacità attuale dell'array errors
+    ErrorSink error_sink;           // Streaming, accorpamento e limite degli errori
 
     int comments_removed;           // Numero di righe contenenti commenti rimossi
     int includes_processed;         // Numero di direttive #include processate
@@ -48,8 +539,15 @@ typedef struct {
 
     int output_lines;               // Numero di righe scritte in output
     long output_size_bytes;         // Numero di byte scritti in output
+    long output_compressed_bytes;   // Byte scritti su disco se l'output è compresso (0 altrimenti)
+    int pch_loaded;                 // Header inclusi tramite file .pch
+    int shm_loaded;                 // Header inclusi dalla cache in memoria condivisa
+    int shm_published;              // Header elaborati e aggiunti alla cache in memoria condivisa
+    MinifyState minify;             // Stato della minificazione dell'output
 
     bool verbose;                   // Flag per abilitare la stampa delle statistiche
+    const ProcessingOptions* options; // Opzioni di elaborazione (NULL = valori di default)
+    DeclarationAnalyzer analyzer;   // Scope e simboli dell'unità di traduzione
 } ProcessingStats;
 
 // =======================
@@ -59,11 +557,17 @@ typedef struct {
 // Inizializza la struttura delle statistiche
 void init_stats(ProcessingStats* stats, bool verbose_mode);
 
-// Aggiunge un errore relativo a un identificatore non valido
-void add_identifier_error(ProcessingStats* stats, const char* filename, int line, const char* identifier);
+// Aggiunge un errore rilevato dall'analisi delle dichiarazioni
+void add_identifier_error(ProcessingStats* stats, const char* filename, int line, const char* identifier, IdentifierErrorKind kind);
+
+// Configura la destinazione degli errori (writer in streaming, accorpamento, limite in memoria)
+void configure_error_sink(ProcessingStats* stats, ErrorSinkWriter write, void* context, bool dedup, int max_retained);
+
+// Writer che stampa una diagnostica sullo stream (FILE*) passato come contesto
+void write_error_to_stream(void* context, const IdentifierError* error);
 
 // Aggiunge le statistiche di un file incluso
-void add_included_file_stats(ProcessingStats* stats, const char* filename, long size, int lines);
+void add_included_file_stats(ProcessingStats* stats, const char* filename, long size, long compressed_size, int lines);
 
 // Stampa le statistiche di elaborazione su uno stream (stdout o stderr)
 void print_stats(const ProcessingStats* stats, FILE* stream);
@@ -71,18 +575,244 @@ void print_stats(const ProcessingStats* stats, FILE* stream);
 // Libera tutta la memoria allocata nella struttura delle statistiche
 void free_stats(ProcessingStats* stats);
 
+// Inizializza un grafo delle inclusioni vuoto
+void init_include_graph(IncludeGraph* graph);
+
+// Libera tutta la memoria associata al grafo delle inclusioni
+void free_include_graph(IncludeGraph* graph);
+
+// Istante corrente in nanosecondi (CLOCK_MONOTONIC)
+uint64_t monotonic_ns(void);
+
+// Registra l'inizio dell'elaborazione di un file; restituisce l'indice del nodo o -1
+int include_graph_enter(IncludeGraph* graph, const char* filename, int depth, long output_offset, int output_lines);
+
+// Registra la fine dell'elaborazione del nodo indicato
+void include_graph_leave(IncludeGraph* graph, int node, long output_offset, int output_lines);
+
 // Verifica se una stringa è un identificatore C valido
 bool is_valid_c_identifier(const char* str);
 
 // Estrae il nome del file da una direttiva #include "..."
 char* extract_include_filename(const char* line);
 
+// =======================
+// Dichiarazioni Funzioni di Lettura File
+// =======================
+
+// Inizializza una cache di file vuota
+void init_file_cache(FileCache* cache);
+
+// Libera tutta la memoria associata alla cache
+void free_file_cache(FileCache* cache);
+
+// Legge in anticipo, in batch via io_uring, il file indicato e tutti i file raggiungibili
+// tramite #include. Restituisce il numero di file messi in cache, oppure -1 se io_uring
+// non è disponibile (in tal caso si usa il percorso di lettura sincrono).
+int prefetch_include_tree(FileCache* cache, const char* root_filename);
+
+// Carica un file in memoria: dalla cache se presente, altrimenti con lettura sincrona.
+// Restituisce 0 in caso di successo oppure il codice errno dell'errore.
+int read_source_file(FileCache* cache, const char* filename, SourceBuffer* buf);
+
+// Rilascia un buffer ottenuto da read_source_file
+void release_source_buffer(SourceBuffer* buf);
+
+// =======================
+// Dichiarazioni Funzioni di Avanzamento
+// =======================
+
+// Avvia il thread del rapporto di avanzamento (SIGUSR1, rapporti periodici, watchdog).
+// Va chiamata prima di creare altri thread. Restituisce 0 in caso di successo, -1 altrimenti.
+int start_progress_reporter(const ProgressOptions* options);
+
+// Ferma il thread del rapporto di avanzamento
+void stop_progress_reporter(void);
+
+// Registra l'inizio dell'elaborazione di un file alla profondità indicata
+void progress_file_begin(const char* filename, int depth);
+
+// Registra la fine dell'elaborazione del file alla profondità indicata
+void progress_file_end(int depth);
+
+// Aggiunge byte e righe sorgente elaborati (da un solo thread di elaborazione alla volta)
+void progress_advance(size_t bytes, int lines);
+
+// =======================
+// Dichiarazioni Funzioni di Contabilità della Memoria
+// =======================
+
+// Allocazioni contabilizzate: i blocchi vanno liberati con mem_free
+void* mem_alloc(size_t size);
+void* mem_calloc(size_t count, size_t size);
+void* mem_aligned_alloc(size_t alignment, size_t size);
+void* mem_realloc(void* ptr, size_t size);
+void mem_free(void* ptr);
+
+// Imposta il budget di memoria in byte (0 = nessun budget)
+void set_memory_budget(long bytes);
+
+// true se, allocando altri extra byte, la memoria supererebbe la soglia di adattamento del budget
+bool memory_pressure(size_t extra);
+
+// Registra un adattamento applicato per restare entro il budget
+void note_memory_fallback(MemoryFallback kind, long bytes);
+
+// Legge i contatori della memoria
+void get_memory_stats(MemoryStats* out);
+
+// =======================
+// Dichiarazioni Funzioni del Profilo delle Inclusioni
+// =======================
+
+// Scrive il profilo delle inclusioni (un record per header distinto) nel formato indicato.
+// Restituisce 0 in caso di successo, -1 in caso di errore.
+int write_include_profile(const IncludeGraph* graph, FILE* stream, ProfileFormat format);
+
+// =======================
+// Dichiarazioni Funzioni di Compressione
+// =======================
+
+// Riconosce il formato di compressione dai primi byte di un file
+Codec detect_codec(const char* data, size_t size);
+
+// Formato di compressione indicato dall'estensione del nome (.gz, .zst)
+Codec codec_from_filename(const char* filename);
+
+// Decomprime in memoria un file compresso (byte già letti in head, il resto da fp a blocchi).
+// Restituisce 0 in caso di successo oppure il codice errno dell'errore.
+int decompress_source(Codec codec, const char* head, size_t head_size, FILE* fp, SourceBuffer* buf);
+
+// Apre il file di output; con estensione .gz o .zst lo stream comprime a blocchi e alla
+// chiusura scrive in *compressed_bytes i byte compressi. NULL (con errno) in caso di errore.
+FILE* open_output_stream(const char* filename, long* compressed_bytes);
+
+// =======================
+// Dichiarazioni Funzioni del Lexer
+// =======================
+
+// Inizializza uno stream di token vuoto
+void init_token_stream(TokenStream* stream);
+
+// Libera gli array dello stream di token
+void free_token_stream(TokenStream* stream);
+
+// Garantisce che lo stream possa contenere almeno capacity token
+bool reserve_token_stream(TokenStream* stream, int capacity);
+
+// Inizializza il lexer su un buffer con lo stato iniziale indicato
+void init_lexer(Lexer* lexer, const char* data, size_t size, CommentState start_state);
+
+// Produce la prossima finestra di token (righe intere); false a fine buffer
+bool lex_window(Lexer* lexer, TokenStream* stream);
+
+// Come lex_window, con il livello di dettaglio indicato
+bool lex_window_as(Lexer* lexer, TokenStream* stream, LexMode mode);
+
+// Copia i token mantenuti di [first, end) in un testo contiguo (e in uno stream compatto)
+size_t copy_kept_tokens(const TokenStream* src, int first, int end, char* text, size_t text_offset, TokenStream* dest);
+
+// Scrive sull'output i token mantenuti di [first, end)
+bool write_kept_tokens(const TokenStream* stream, int first, int end, FILE* out_stream, size_t* written);
+
+// =======================
+// Dichiarazioni Funzioni di Analisi delle Dichiarazioni
+// =======================
+
+// Inizializza l'analizzatore con il solo scope del file
+void init_declaration_analyzer(DeclarationAnalyzer* analyzer);
+
+// Libera la memoria dell'analizzatore
+void free_declaration_analyzer(DeclarationAnalyzer* analyzer);
+
+// Analizza i token di una riga: scope, tabelle dei simboli, nomi non validi, duplicati e occultati
+void analyze_declaration_tokens(const TokenStream* stream, int first, int end, int line_num, const char* current_filename, ProcessingStats* stats);
+
+// Verifica che l'analizzatore sia nello scope del file, all'inizio di un'istruzione
+bool declaration_analyzer_at_top_level(const DeclarationAnalyzer* a);
+
+// Dichiara nello scope corrente un simbolo proveniente da un header precompilato
+void import_declaration_symbol(ProcessingStats* stats, const char* filename, const char* name, int line, SymbolKind kind, bool defined);
+
+// =======================
+// Dichiarazioni Funzioni degli Header Precompilati
+// =======================
+
+// Elabora un header e ne costruisce in memoria la versione precompilata. Restituisce 0 in
+// caso di successo, 1 se l'header non è precompilabile, -1 in caso di errore.
+int build_precompiled_image(const char* input_filename, const ProcessingOptions* base_options, bool verbose, char** image, size_t* image_size);
+
+// Elabora un header e ne scrive la versione precompilata in pch_filename
+int emit_precompiled_header(const char* input_filename, const char* pch_filename, const ProcessingOptions* base_options, bool verbose);
+
+// Se accanto al file incluso esiste un .pch aggiornato, ne scrive l'output e ne applica
+// le statistiche. Restituisce 1 se usato, 0 se assente o non aggiornato, -1 in caso di errore.
+int use_precompiled_header(const char* filename, FILE* out_stream, ProcessingStats* stats, int depth);
+
+// Indica se l'output di un header può essere sostituito da un'immagine precompilata
+bool precompiled_replay_allowed(const ProcessingStats* stats);
+
+// Applica un'immagine precompilata valida e aggiornata. Restituisce 1 se applicata,
+// 0 se non valida o non aggiornata, -1 in caso di errore di scrittura.
+int apply_precompiled_image(const char* base, size_t size, const char* filename, FILE* out_stream, ProcessingStats* stats, int depth);
+
+// =======================
+// Dichiarazioni Funzioni della Cache Condivisa degli Header
+// =======================
+
+// Apre il segmento condiviso indicato, creandolo se non esiste (size = 0: dimensione di default).
+// Restituisce 0 in caso di successo, -1 in caso di errore.
+int open_shared_header_cache(SharedHeaderCache* cache, const char* name, long size);
+
+// Chiude la mappatura del segmento condiviso (il segmento resta disponibile agli altri processi)
+void close_shared_header_cache(SharedHeaderCache* cache);
+
+// Usa la versione elaborata dell'header presente nel segmento condiviso, oppure la costruisce
+// e la pubblica. Restituisce 1 se usata, 0 se l'header va elaborato, -1 in caso di errore.
+int use_shared_header(const char* filename, FILE* out_stream, ProcessingStats* stats, int depth);
+
 // =======================
 // Dichiarazioni Funzioni di Preprocessing
 // =======================
 
+// Calcola dimensione e numero di righe di un file caricato in memoria
+bool get_file_pre_stats(const SourceBuffer* buf, long* size, int* lines);
+
+// Estrae la prossima riga da un buffer in memoria con la semantica di fgets
+char* read_buffer_line(const SourceBuffer* buf, size_t* pos, char* line, size_t capacity);
+
+// Registra le statistiche pre-processamento del file principale o di un file incluso
+void register_file_stats(ProcessingStats* stats, const char* filename, const SourceBuffer* buf, int depth);
+
+// Kernel per riga di riferimento: equivalenti al lexer (usati per le verifiche differenziali)
+
+// Rimuove i commenti da una riga aggiornando lo stato della macchina a stati
+int strip_comments_line(const char* line, char* processed_line, CommentState* comment_state, bool* had_comment);
+
+// Verifica se una riga processata contiene solo spazi
+bool is_blank_line(const char* processed_line);
+
+// Indica se una riga va conteggiata tra le righe di commento eliminate
+bool counts_as_comment_line(bool had_comment, bool fully_commented, CommentState state_after);
+
+// Scrive una riga di output (minificata e preceduta da #line se richiesto) e aggiorna le statistiche
+bool write_output_line(ProcessingStats* stats, FILE* out_stream, const char* text, size_t len, const char* filename, int line_num);
+
 // Processa ricorsivamente un file C, rimuove commenti, gestisce #include e aggiorna le statistiche.
 // Il parametro depth serve a evitare inclusioni ricorsive infinite.
 int process_c_file(const char* input_filename, FILE* out_stream, ProcessingStats* stats, int depth);
 
+// Processa un file C con una pipeline multi-thread (lettura, rimozione commenti,
+// analisi e scrittura su thread distinti collegati da ring buffer SPSC).
+// Output e statistiche coincidono con process_c_file.
+int process_c_file_pipelined(const char* input_filename, FILE* out_stream, ProcessingStats* stats);
+
+// Processa un file già caricato rimuovendo i commenti in parallelo su più thread.
+// Output e statistiche coincidono byte per byte con process_c_file.
+int process_buffer_parallel(const char* input_filename, const SourceBuffer* in_buf, FILE* out_stream, ProcessingStats* stats, int depth, int threads);
+
+// Modalità watch: elabora il file, poi resta in ascolto (inotify) delle modifiche ai file
+// coinvolti e rigenera solo i segmenti di output interessati.
+int run_watch_mode(const char* input_filename, const char* output_filename, const ProcessingOptions* base_options, bool verbose);
+
 #endif // MYPRECOMPILER_H
\ No newline at end of file
@@ -0,0 +1,1199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "myPreCompiler.h"
+
+// Dimensione minima di un blocco dell'arena dei simboli
+#define ARENA_BLOCK_SIZE (64 * 1024)
+// Capacità iniziale della tabella dei nomi (potenza di 2)
+#define NAME_TABLE_INITIAL 64
+// Capacità iniziale della pila degli scope
+#define SCOPE_STACK_INITIAL 16
+
+// Stati del parser delle istruzioni
+enum {
+    DP_START,        // Inizio di un'istruzione o di una dichiarazione
+    DP_MAYBE_TYPE,   // Letto un identificatore sconosciuto: può essere un nome di tipo
+    DP_SPECIFIERS,   // Specificatori di tipo, in attesa del dichiaratore
+    DP_TAG,          // Dopo struct/union/enum
+    DP_DECLARATOR,   // Letto il nome del dichiaratore
+    DP_INITIALIZER,  // Dopo '=' fino alla ',' o al ';' di livello 0
+    DP_PARAMS,       // Elenco dei parametri di una funzione
+    DP_AFTER_PARAMS, // Dopo la ')' dei parametri: '{' (definizione), ';' o ','
+    DP_ENUM_BODY,    // Corpo di un enum
+    DP_PARENS,       // Parentesi tonde saltate (attributi, parametri di puntatori a funzione)
+    DP_BRACKETS,     // Dimensioni di un array
+    DP_LINKAGE,      // Dopo extern "C": la '{' non apre uno scope
+    DP_FOR,          // Dopo for, in attesa della '(' che apre lo scope del ciclo
+    DP_FOR_CLAUSES,  // Condizione e incremento del for, fino alla ')' corrispondente
+    DP_SKIP          // Istruzione che non è una dichiarazione, fino a ';', '{' o '}'
+};
+
+// Fase di uno scope aperto da un ciclo for (campo loop di Scope)
+enum {
+    LOOP_NONE,       // Scope che non appartiene a un ciclo
+    LOOP_HEADER,     // Clausola iniziale: può dichiarare variabili
+    LOOP_BODY        // Corpo del ciclo: lo scope si chiude con l'istruzione del corpo
+};
+
+// Classi delle parole chiave rilevanti per le dichiarazioni
+enum {
+    KW_NONE,         // Non è una parola chiave
+    KW_TYPE,         // Tipo base
+    KW_QUALIFIER,    // Qualificatore o classe di memorizzazione
+    KW_EXTERN,       // extern (non nasconde né duplica dichiarazioni esterne)
+    KW_TYPEDEF,      // typedef
+    KW_TAG,          // struct, union, enum
+    KW_ATTRIBUTE,    // Attributi seguiti da parentesi
+    KW_FOR,          // for (la clausola iniziale può dichiarare variabili)
+    KW_STATEMENT     // Parola chiave che inizia un'istruzione
+};
+
+// Modalità di controllo dell'occultamento per una nuova dichiarazione
+enum {
+    SHADOW_NONE,     // Nessun controllo
+    SHADOW_REPORT,   // Segnala subito
+    SHADOW_DEFER     // Parametri: segnala solo se la funzione viene definita
+};
+
+typedef struct {
+    const char* name;
+    unsigned char length;
+    unsigned char kw_class;
+} Keyword;
+
+static const Keyword keywords[] = {
+    { "void", 4, KW_TYPE }, { "char", 4, KW_TYPE }, { "short", 5, KW_TYPE }, { "int", 3, KW_TYPE },
+    { "long", 4, KW_TYPE }, { "float", 5, KW_TYPE }, { "double", 6, KW_TYPE }, { "signed", 6, KW_TYPE },
+    { "unsigned", 8, KW_TYPE }, { "_Bool", 5, KW_TYPE }, { "bool", 4, KW_TYPE }, { "_Complex", 8, KW_TYPE },
+    { "const", 5, KW_QUALIFIER }, { "volatile", 8, KW_QUALIFIER }, { "restrict", 8, KW_QUALIFIER },
+    { "static", 6, KW_QUALIFIER }, { "register", 8, KW_QUALIFIER }, { "auto", 4, KW_QUALIFIER },
+    { "inline", 6, KW_QUALIFIER }, { "_Thread_local", 13, KW_QUALIFIER }, { "_Noreturn", 9, KW_QUALIFIER },
+    { "_Atomic", 7, KW_QUALIFIER }, { "__inline", 8, KW_QUALIFIER }, { "__inline__", 10, KW_QUALIFIER },
+    { "__restrict", 10, KW_QUALIFIER }, { "__restrict__", 12, KW_QUALIFIER }, { "__extension__", 13, KW_QUALIFIER },
+    { "extern", 6, KW_EXTERN }, { "typedef", 7, KW_TYPEDEF },
+    { "struct", 6, KW_TAG }, { "union", 5, KW_TAG }, { "enum", 4, KW_TAG },
+    { "__attribute__", 13, KW_ATTRIBUTE }, { "__attribute", 11, KW_ATTRIBUTE }, { "__declspec", 10, KW_ATTRIBUTE },
+    { "_Alignas", 8, KW_ATTRIBUTE }, { "__asm__", 7, KW_ATTRIBUTE }, { "__asm", 5, KW_ATTRIBUTE }, { "asm", 3, KW_ATTRIBUTE },
+    { "return", 6, KW_STATEMENT }, { "if", 2, KW_STATEMENT }, { "else", 4, KW_STATEMENT }, { "while", 5, KW_STATEMENT },
+    { "for", 3, KW_FOR }, { "do", 2, KW_STATEMENT }, { "switch", 6, KW_STATEMENT }, { "case", 4, KW_STATEMENT },
+    { "default", 7, KW_STATEMENT }, { "break", 5, KW_STATEMENT }, { "continue", 8, KW_STATEMENT },
+    { "goto", 4, KW_STATEMENT }, { "sizeof", 6, KW_STATEMENT }, { "_Static_assert", 14, KW_STATEMENT },
+    { "static_assert", 13, KW_STATEMENT }, { "_Generic", 8, KW_STATEMENT },
+};
+
+/**
+ * Indica se un carattere può iniziare un nome (lettera, cifra o '_'): le parole che
+ * iniziano con un operatore non sono dichiaratori.
+ */
+static inline bool is_name_start(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/**
+ * Indica se una parola ha la forma di un identificatore C (come is_valid_c_identifier,
+ * ma su una parola non terminata da '\0').
+ */
+static bool is_identifier(const char* word, size_t len) {
+    if (len == 0 || (word[0] >= '0' && word[0] <= '9')) return false;
+    for (size_t k = 0; k < len; ++k) {
+        if (!is_name_start(word[k])) return false;
+    }
+    return true;
+}
+
+// Parametri dell'hash FNV-1a a 32 bit
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+/**
+ * Hash FNV-1a a 32 bit di un nome.
+ */
+static uint32_t hash_name(const char* name, size_t len) {
+    uint32_t hash = FNV_OFFSET;
+    for (size_t k = 0; k < len; ++k) {
+        hash = (hash ^ (unsigned char)name[k]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Classifica una parola rispetto alle parole chiave rilevanti per le dichiarazioni,
+ * tramite l'indice hash costruito da init_declaration_analyzer.
+ * @param hash Hash della parola (hash_name).
+ */
+static int keyword_class(const DeclarationAnalyzer* a, const char* word, size_t len, uint32_t hash) {
+    for (uint32_t i = hash & (KEYWORD_SLOTS - 1);; i = (i + 1) & (KEYWORD_SLOTS - 1)) {
+        int k = a->keyword_slots[i];
+        if (k == 0) return KW_NONE;
+        const Keyword* kw = &keywords[k - 1];
+        if (kw->length == len && memcmp(kw->name, word, len) == 0) return kw->kw_class;
+    }
+}
+
+// =====================
+// Arena dei simboli
+// =====================
+
+/**
+ * Alloca size byte dall'arena. I blocchi liberati da arena_release restano
+ * disponibili e vengono riusati dalle allocazioni successive.
+ * @return Puntatore alla memoria, NULL in caso di errore.
+ */
+static void* arena_alloc(SymbolArena* arena, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (arena->current >= 0 && arena->used + size <= arena->sizes[arena->current]) {
+        void* ptr = arena->blocks[arena->current] + arena->used;
+        arena->used += size;
+        return ptr;
+    }
+
+    // Passa al blocco successivo, allocandolo (o sostituendolo se troppo piccolo)
+    int next = arena->current + 1;
+    size_t block_size = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+    if (next < arena->count && arena->sizes[next] < size) {
+        char* block = mem_alloc(block_size);
+        if (!block) {
+            perror("malloc fallito in arena_alloc");
+            return NULL;
+        }
+        mem_free(arena->blocks[next]);
+        arena->blocks[next] = block;
+        arena->sizes[next] = block_size;
+    } else if (next >= arena->count) {
+        if (arena->count >= arena->capacity) {
+            int new_capacity = (arena->capacity == 0) ? 8 : arena->capacity * 2;
+            char** new_blocks = mem_realloc(arena->blocks, new_capacity * sizeof(char*));
+            if (!new_blocks) {
+                perror("Errore: Impossibile riallocare memoria per l'arena dei simboli");
+                return NULL;
+            }
+            arena->blocks = new_blocks;
+            size_t* new_sizes = mem_realloc(arena->sizes, new_capacity * sizeof(size_t));
+            if (!new_sizes) {
+                perror("Errore: Impossibile riallocare memoria per l'arena dei simboli");
+                return NULL;
+            }
+            arena->sizes = new_sizes;
+            arena->capacity = new_capacity;
+        }
+        char* block = mem_alloc(block_size);
+        if (!block) {
+            perror("malloc fallito in arena_alloc");
+            return NULL;
+        }
+        arena->blocks[arena->count] = block;
+        arena->sizes[arena->count] = block_size;
+        arena->count++;
+    }
+    arena->current = next;
+    arena->used = size;
+    return arena->blocks[next];
+}
+
+/**
+ * Riporta l'arena alla posizione indicata, rilasciando in blocco tutto ciò che è
+ * stato allocato dopo (i blocchi restano allocati per il riuso).
+ */
+static void arena_release(SymbolArena* arena, int block, size_t used) {
+    arena->current = block;
+    arena->used = used;
+}
+
+// =====================
+// Scope e tabella dei nomi
+// =====================
+
+/**
+ * Cerca la posizione della tabella dei nomi con una dichiarazione visibile del nome.
+ * @return La posizione, NULL se il nome non è visibile in nessuno scope.
+ */
+static NameSlot* find_name(const DeclarationAnalyzer* a, const char* name, size_t len, uint32_t hash) {
+    if (!a->names) return NULL;
+    uint32_t mask = (uint32_t)a->name_capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        NameSlot* slot = &a->names[i];
+        if (!slot->used) return NULL;
+        if (slot->binding && slot->hash == hash && slot->binding->length == len &&
+            memcmp(slot->binding->name, name, len) == 0) {
+            return slot;
+        }
+    }
+}
+
+/**
+ * Ricostruisce la tabella dei nomi, scartando le posizioni dei nomi non più visibili e
+ * raddoppiandola finché le posizioni occupate restano al massimo 1/4.
+ */
+static bool rebuild_names(DeclarationAnalyzer* a) {
+    int new_capacity = (a->name_capacity == 0) ? NAME_TABLE_INITIAL : a->name_capacity;
+    while ((a->name_live + 1) * 4 > new_capacity) new_capacity *= 2;
+    NameSlot* names = mem_calloc((size_t)new_capacity, sizeof(NameSlot));
+    if (!names) {
+        perror("Errore: Impossibile allocare memoria per la tabella dei nomi");
+        return false;
+    }
+    uint32_t mask = (uint32_t)new_capacity - 1;
+    for (int k = 0; k < a->name_capacity; ++k) {
+        if (!a->names[k].binding) continue;
+        uint32_t i = a->names[k].hash & mask;
+        while (names[i].used) i = (i + 1) & mask;
+        names[i] = a->names[k];
+    }
+    mem_free(a->names);
+    a->names = names;
+    a->name_capacity = new_capacity;
+    a->name_used = a->name_live;
+    return true;
+}
+
+/**
+ * Rende visibile un nuovo simbolo: diventa la dichiarazione più interna del suo nome
+ * e quella che nasconde resta collegata in shadowed, da ripristinare alla chiusura.
+ * @param slot Posizione del nome restituita da find_name (NULL se non visibile).
+ */
+static bool bind_name(DeclarationAnalyzer* a, NameSlot* slot, Symbol* sym) {
+    if (slot) {
+        sym->shadowed = slot->binding;
+        slot->binding = sym;
+        return true;
+    }
+    if ((a->name_used + 1) * 2 > a->name_capacity && !rebuild_names(a)) return false;
+    uint32_t mask = (uint32_t)a->name_capacity - 1;
+    uint32_t i = sym->hash & mask;
+    while (a->names[i].binding) i = (i + 1) & mask; // Riusa anche le posizioni svuotate
+    if (!a->names[i].used) a->name_used++;
+    a->name_live++;
+    a->names[i].hash = sym->hash;
+    a->names[i].used = true;
+    a->names[i].binding = sym;
+    sym->shadowed = NULL;
+    return true;
+}
+
+/**
+ * Ripristina la dichiarazione nascosta da un simbolo dello scope che si chiude.
+ */
+static void unbind_name(DeclarationAnalyzer* a, const Symbol* sym) {
+    uint32_t mask = (uint32_t)a->name_capacity - 1;
+    uint32_t i = sym->hash & mask;
+    while (a->names[i].binding != sym) i = (i + 1) & mask;
+    a->names[i].binding = sym->shadowed;
+    if (!sym->shadowed) a->name_live--;
+}
+
+/**
+ * Apre un nuovo scope in cima alla pila.
+ * @param kind Tipo di scope (ScopeKind).
+ * @param resume_state Stato del parser da riprendere alla chiusura.
+ */
+static void push_scope(DeclarationAnalyzer* a, int kind, int resume_state) {
+    if (a->scope_count >= a->scope_capacity) {
+        int new_capacity = (a->scope_capacity == 0) ? SCOPE_STACK_INITIAL : a->scope_capacity * 2;
+        Scope* new_scopes = mem_realloc(a->scopes, new_capacity * sizeof(Scope));
+        if (!new_scopes) {
+            perror("Errore: Impossibile riallocare memoria per gli scope");
+            a->lost_scopes++; // La '}' corrispondente non chiuderà lo scope esterno
+            return;
+        }
+        a->scopes = new_scopes;
+        a->scope_capacity = new_capacity;
+    }
+    Scope* scope = &a->scopes[a->scope_count++];
+    scope->symbols = NULL;
+    scope->count = 0;
+    scope->kind = (unsigned char)kind;
+    scope->resume_state = (unsigned char)resume_state;
+    scope->resume_typedef = a->stmt_typedef;
+    scope->loop = LOOP_NONE;
+    scope->mark_block = a->arena.current;
+    scope->mark_used = a->arena.used;
+}
+
+/**
+ * Chiude lo scope in cima alla pila (mai quello del file), rilasciandone i simboli e
+ * rendendo di nuovo visibili i nomi che nascondevano, e riprende lo stato del parser salvato all'apertura. Un blocco che termina il corpo
+ * di un ciclo for chiude anche lo scope del ciclo.
+ */
+static void pop_scope(DeclarationAnalyzer* a) {
+    a->state = DP_START;
+    a->stmt_typedef = false;
+    a->stmt_extern = false;
+    a->has_type = false;
+    a->has_pending = false;
+    a->function = NULL;
+    a->deferred_count = 0;
+    if (a->lost_scopes > 0) {
+        a->lost_scopes--;
+        return;
+    }
+    if (a->scope_count <= 1) return; // '}' senza '{' corrispondente
+    Scope* scope = &a->scopes[--a->scope_count];
+    for (const Symbol* sym = scope->symbols; sym; sym = sym->scope_next) {
+        unbind_name(a, sym);
+    }
+    arena_release(&a->arena, scope->mark_block, scope->mark_used);
+    a->state = scope->resume_state;
+    if (a->state == DP_SPECIFIERS) {
+        // Fine del corpo di struct/union: seguono i dichiaratori dell'istruzione esterna
+        a->stmt_typedef = scope->resume_typedef;
+        a->has_type = true;
+        a->grouped = false;
+        a->pointer_group = false;
+    } else if (scope->kind == SCOPE_BLOCK && a->scopes[a->scope_count - 1].loop == LOOP_BODY) {
+        pop_scope(a); // Fine del corpo del ciclo
+    }
+}
+
+/**
+ * Cerca la dichiarazione più interna di un nome in uno scope che precede quello indicato
+ * (esclusi i corpi di struct/union), scorrendo le dichiarazioni che nasconde.
+ */
+static Symbol* find_enclosing(const DeclarationAnalyzer* a, const NameSlot* slot, int below) {
+    for (Symbol* sym = slot ? slot->binding : NULL; sym; sym = sym->shadowed) {
+        if (sym->scope < below && a->scopes[sym->scope].kind != SCOPE_MEMBERS) return sym;
+    }
+    return NULL;
+}
+
+/**
+ * Indica se un nome visibile nel punto corrente denota un tipo definito con typedef.
+ */
+static bool is_typedef_name(const DeclarationAnalyzer* a, const char* name, size_t len, uint32_t hash) {
+    Symbol* sym = find_enclosing(a, find_name(a, name, len, hash), a->scope_count);
+    return sym && sym->kind == SYM_TYPEDEF;
+}
+
+/**
+ * Dichiara un nome nello scope corrente, segnalando le dichiarazioni duplicate nello
+ * stesso scope e quelle che nascondono un nome di uno scope esterno.
+ * @return Il simbolo (nuovo o già esistente), NULL in caso di errore di allocazione.
+ */
+static Symbol* declare_symbol(ProcessingStats* stats, const char* name, size_t len, int line, int kind, bool defined, int shadow_mode) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    if (a->scope_count == 0) return NULL;
+    Scope* scope = &a->scopes[a->scope_count - 1];
+    uint32_t hash = hash_name(name, len);
+
+    NameSlot* slot = find_name(a, name, len, hash);
+    Symbol* existing = (slot && slot->binding->scope == a->scope_count - 1) ? slot->binding : NULL;
+    if (existing) {
+        bool duplicate;
+        if (kind == SYM_TYPEDEF || existing->kind == SYM_TYPEDEF) {
+            duplicate = (kind != existing->kind); // Ridefinire un typedef identico è lecito
+        } else if (kind == SYM_FUNCTION && existing->kind == SYM_FUNCTION) {
+            duplicate = false; // Le definizioni ripetute sono controllate all'apertura del corpo
+        } else if (kind == SYM_FUNCTION || existing->kind == SYM_FUNCTION) {
+            duplicate = true;
+        } else if (scope->kind == SCOPE_FILE) {
+            // Le dichiarazioni provvisorie sono lecite; due definizioni no
+            duplicate = (existing->defined && defined) || kind == SYM_CONSTANT || existing->kind == SYM_CONSTANT;
+        } else {
+            duplicate = !a->stmt_extern;
+        }
+        if (duplicate) {
+            add_identifier_error(stats, a->filename, line, existing->name, ERR_DUPLICATE_DECLARATION);
+        }
+        existing->defined = existing->defined || defined;
+        return existing;
+    }
+
+    Symbol* sym = arena_alloc(&a->arena, sizeof(Symbol) + len + 1);
+    if (!sym) return NULL;
+    char* copy = (char*)(sym + 1);
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    sym->name = copy;
+    sym->length = (uint32_t)len;
+    sym->hash = hash;
+    sym->line = line;
+    sym->origin = (stats->options && stats->options->include_graph) ? stats->options->include_graph->current : -1;
+    sym->scope = a->scope_count - 1;
+    sym->kind = (unsigned char)kind;
+    sym->defined = defined;
+    if (!bind_name(a, slot, sym)) return NULL;
+    sym->scope_next = scope->symbols;
+    scope->symbols = sym;
+    scope->count++;
+
+    if (shadow_mode != SHADOW_NONE && scope->kind != SCOPE_MEMBERS && kind != SYM_FUNCTION && !a->stmt_extern &&
+        find_enclosing(a, slot, a->scope_count - 1)) {
+        if (shadow_mode == SHADOW_REPORT) {
+            add_identifier_error(stats, a->filename, line, sym->name, ERR_SHADOWED_DECLARATION);
+        } else if (a->deferred_count < MAX_DEFERRED_SHADOWS) {
+            a->deferred[a->deferred_count++] = sym;
+        }
+    }
+    return sym;
+}
+
+// =====================
+// Parser delle istruzioni
+// =====================
+
+/**
+ * Riporta il parser all'inizio di una nuova istruzione. La fine della clausola
+ * iniziale di un for passa alle clausole successive; la fine del corpo di un for
+ * chiude lo scope del ciclo.
+ */
+static void end_statement(DeclarationAnalyzer* a) {
+    a->state = DP_START;
+    a->stmt_typedef = false;
+    a->stmt_extern = false;
+    a->has_type = false;
+    a->grouped = false;
+    a->pointer_group = false;
+    a->has_pending = false;
+    a->function = NULL;
+    if (a->lost_scopes > 0 || a->scope_count <= 1) return;
+    Scope* top = &a->scopes[a->scope_count - 1];
+    if (top->loop == LOOP_HEADER) {
+        a->state = DP_FOR_CLAUSES;
+        a->nest = 1;
+    } else if (top->loop == LOOP_BODY) {
+        pop_scope(a);
+    }
+}
+
+/**
+ * Prepara il dichiaratore successivo di una lista (dopo ',').
+ */
+static void next_declarator(DeclarationAnalyzer* a) {
+    a->state = DP_SPECIFIERS;
+    a->has_type = true;
+    a->grouped = false;
+    a->pointer_group = false;
+    a->has_pending = false;
+}
+
+/**
+ * Inizia un dichiaratore: valida il nome e lo tiene in sospeso fino al delimitatore
+ * successivo, che ne stabilisce il tipo (variabile, funzione, definizione).
+ */
+static void begin_declarator(ProcessingStats* stats, const char* word, size_t len) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    // Campo di bit (nome:larghezza) nel corpo di una struct
+    if (a->scope_count > 0 && a->scopes[a->scope_count - 1].kind == SCOPE_MEMBERS) {
+        const char* colon = memchr(word, ':', len);
+        if (colon) len = (size_t)(colon - word);
+    }
+    a->state = DP_DECLARATOR;
+    a->extra_words = false;
+    a->has_pending = false;
+    if (len == 0) return;
+
+    memcpy(a->pending, word, len);
+    a->pending[len] = '\0';
+    stats->vars_checked++;
+    if (!is_valid_c_identifier(a->pending)) {
+        add_identifier_error(stats, a->filename, a->line, a->pending, ERR_INVALID_IDENTIFIER);
+        return;
+    }
+    a->pending_len = len;
+    a->pending_line = a->line;
+    a->has_pending = true;
+}
+
+/**
+ * Dichiara il dichiaratore in sospeso con il tipo stabilito dal delimitatore.
+ * @return Il simbolo dichiarato, NULL se non c'era un nome valido.
+ */
+static Symbol* commit_declarator(ProcessingStats* stats, int kind, bool defined) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    if (!a->has_pending) return NULL;
+    a->has_pending = false;
+    if (a->stmt_typedef) kind = SYM_TYPEDEF;
+    return declare_symbol(stats, a->pending, a->pending_len, a->pending_line, kind, defined && kind != SYM_TYPEDEF, SHADOW_REPORT);
+}
+
+/**
+ * Chiude un parametro della funzione in corso di dichiarazione: il nome è l'ultima
+ * parola non chiave del parametro, se il parametro ne contiene almeno due
+ * (un solo nome di tipo indica un parametro senza nome).
+ */
+static void finish_param(ProcessingStats* stats) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    if (a->has_param && a->param_words >= 2 &&
+        !(a->param_names == 1 && is_typedef_name(a, a->param, a->param_len, hash_name(a->param, a->param_len)))) {
+        stats->vars_checked++;
+        if (!is_valid_c_identifier(a->param)) {
+            add_identifier_error(stats, a->filename, a->param_line, a->param, ERR_INVALID_IDENTIFIER);
+        } else {
+            declare_symbol(stats, a->param, a->param_len, a->param_line, SYM_VARIABLE, false, SHADOW_DEFER);
+        }
+    }
+    a->has_param = false;
+    a->param_words = 0;
+    a->param_names = 0;
+    a->after_tag = false;
+}
+
+/**
+ * Entra nel corpo di una funzione: lo scope dei parametri diventa lo scope della
+ * funzione, la definizione viene registrata e si segnalano i parametri che
+ * nascondono nomi esterni.
+ */
+static void begin_function_body(ProcessingStats* stats) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    if (a->function) {
+        if (a->function->defined) {
+            add_identifier_error(stats, a->filename, a->line, a->function->name, ERR_DUPLICATE_DECLARATION);
+        }
+        a->function->defined = true;
+    }
+    for (int k = 0; k < a->deferred_count; ++k) {
+        add_identifier_error(stats, a->filename, a->deferred[k]->line, a->deferred[k]->name, ERR_SHADOWED_DECLARATION);
+    }
+    a->deferred_count = 0;
+    end_statement(a);
+}
+
+/**
+ * Gestisce una parola (identificatore, numero, operatore composto) dell'istruzione corrente.
+ * Le parole di espressioni, inizializzatori e parentesi saltate vengono scartate subito,
+ * senza calcolarne l'hash.
+ */
+static void on_word(ProcessingStats* stats, const char* word, size_t len) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    bool was_star = a->prev_star;
+    a->prev_star = false;
+    if (a->state == DP_SKIP || a->state == DP_INITIALIZER || a->state == DP_PARENS || a->state == DP_BRACKETS ||
+        a->state == DP_FOR_CLAUSES || (a->state == DP_PARAMS && a->nest > 1 && !(a->nest == 2 && was_star))) {
+        return;
+    }
+    uint32_t hash = hash_name(word, len);
+
+    switch (a->state) {
+        case DP_START:
+        case DP_SPECIFIERS:
+        case DP_MAYBE_TYPE: {
+            int kw = keyword_class(a, word, len, hash);
+            if (a->state == DP_MAYBE_TYPE) {
+                if (kw == KW_NONE && !is_name_start(word[0])) {
+                    a->state = DP_SKIP; // Espressione: "x += y", "x->y"
+                    a->nest = 0;
+                    return;
+                }
+                if (kw == KW_NONE) {
+                    // "Tipo nome": l'identificatore precedente era un nome di tipo non noto
+                    a->has_type = true;
+                    begin_declarator(stats, word, len);
+                    return;
+                }
+                a->state = DP_SPECIFIERS; // Prefisso (macro) seguito da specificatori
+                a->has_type = false;
+            }
+            switch (kw) {
+                case KW_TYPE:
+                    a->has_type = true;
+                    a->state = DP_SPECIFIERS;
+                    return;
+                case KW_EXTERN:
+                    a->stmt_extern = true;
+                    a->state = DP_SPECIFIERS;
+                    return;
+                case KW_TYPEDEF:
+                    a->stmt_typedef = true;
+                    a->state = DP_SPECIFIERS;
+                    return;
+                case KW_QUALIFIER:
+                    a->state = DP_SPECIFIERS;
+                    return;
+                case KW_TAG:
+                    a->state = DP_TAG;
+                    a->tag_enum = (len == 4);
+                    a->tag_named = false;
+                    return;
+                case KW_ATTRIBUTE:
+                    a->return_state = (a->state == DP_START) ? DP_SPECIFIERS : a->state;
+                    a->state = DP_PARENS;
+                    a->nest = 0;
+                    return;
+                case KW_FOR:
+                    if (a->state == DP_START) {
+                        a->state = DP_FOR;
+                        return;
+                    }
+                    a->state = DP_SKIP;
+                    a->nest = 0;
+                    return;
+                case KW_STATEMENT:
+                    a->state = DP_SKIP;
+                    a->nest = 0;
+                    return;
+            }
+            if (word[0] == '"' && a->stmt_extern) {
+                a->state = DP_LINKAGE; // extern "C"
+                return;
+            }
+            if (a->state == DP_SPECIFIERS) {
+                if (!a->has_type && is_typedef_name(a, word, len, hash)) {
+                    a->has_type = true;
+                } else {
+                    begin_declarator(stats, word, len);
+                }
+                return;
+            }
+            // Inizio di istruzione
+            if (is_typedef_name(a, word, len, hash)) {
+                a->has_type = true;
+                a->state = DP_SPECIFIERS;
+            } else if (is_identifier(word, len)) {
+                a->state = DP_MAYBE_TYPE;
+            } else {
+                a->state = DP_SKIP;
+                a->nest = 0;
+            }
+            return;
+        }
+        case DP_TAG:
+            if (!a->tag_named && keyword_class(a, word, len, hash) == KW_NONE) {
+                a->tag_named = true;
+            } else if (keyword_class(a, word, len, hash) == KW_ATTRIBUTE) {
+                a->return_state = DP_TAG;
+                a->state = DP_PARENS;
+                a->nest = 0;
+            } else {
+                // "struct S nome"
+                a->has_type = true;
+                a->state = DP_SPECIFIERS;
+                on_word(stats, word, len);
+            }
+            return;
+        case DP_DECLARATOR:
+            if (keyword_class(a, word, len, hash) == KW_ATTRIBUTE) {
+                a->return_state = DP_DECLARATOR;
+                a->state = DP_PARENS;
+                a->nest = 0;
+            }
+            a->extra_words = true; // Attributi o macro dopo il nome
+            return;
+        case DP_AFTER_PARAMS:
+            if (keyword_class(a, word, len, hash) == KW_ATTRIBUTE) {
+                a->return_state = DP_AFTER_PARAMS;
+                a->state = DP_PARENS;
+                a->nest = 0;
+            }
+            return;
+        case DP_PARAMS:
+            if (a->nest == 1 || (a->nest == 2 && was_star)) {
+                int kw = keyword_class(a, word, len, hash);
+                a->param_words++;
+                if (kw == KW_TAG) {
+                    a->after_tag = true;
+                } else if (kw == KW_NONE) {
+                    if (a->after_tag) {
+                        a->after_tag = false; // Nome del tag, non del parametro
+                    } else {
+                        memcpy(a->param, word, len);
+                        a->param[len] = '\0';
+                        a->param_len = len;
+                        a->param_line = a->line;
+                        a->has_param = true;
+                        a->param_names++;
+                    }
+                }
+            }
+            return;
+        case DP_ENUM_BODY:
+            if (a->nest == 0 && a->expect_name) {
+                a->expect_name = false;
+                stats->vars_checked++;
+                char name[MAX_LINE_LEN];
+                memcpy(name, word, len);
+                name[len] = '\0';
+                if (!is_valid_c_identifier(name)) {
+                    add_identifier_error(stats, a->filename, a->line, name, ERR_INVALID_IDENTIFIER);
+                } else {
+                    declare_symbol(stats, name, len, a->line, SYM_CONSTANT, true, SHADOW_REPORT);
+                }
+            }
+            return;
+        case DP_LINKAGE:
+            a->state = DP_START;
+            on_word(stats, word, len);
+            return;
+        case DP_FOR:
+            a->state = DP_SKIP; // Macro o estensione tra for e '('
+            a->nest = 0;
+            return;
+        default:
+            return; // Inizializzatori, parentesi saltate, istruzioni
+    }
+}
+
+/**
+ * Gestisce un delimitatore ( ) [ ] { } , ; * = dell'istruzione corrente.
+ */
+static void on_punct(ProcessingStats* stats, char c) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    a->prev_star = (c == '*');
+
+    switch (a->state) {
+        case DP_START:
+            if (c == '{') {
+                push_scope(a, SCOPE_BLOCK, DP_START);
+                end_statement(a);
+            } else if (c == '}') {
+                pop_scope(a);
+            } else if (c == ';') {
+                end_statement(a); // Istruzione vuota (anche come corpo o clausola di un for)
+            } else {
+                a->state = DP_SKIP;
+                a->nest = 0;
+                on_punct(stats, c);
+            }
+            return;
+        case DP_MAYBE_TYPE:
+            if (c == '*') return; // "Tipo *nome"
+            a->state = DP_SKIP;
+            a->nest = 0;
+            on_punct(stats, c);
+            return;
+        case DP_SPECIFIERS:
+            if (c == '*' || c == ')') return;
+            if (c == '(') {
+                a->grouped = true; // Dichiaratore tra parentesi: "(*nome)"
+            } else if (c == ';') {
+                end_statement(a);
+            } else if (c == '{') {
+                push_scope(a, SCOPE_BLOCK, DP_START);
+                end_statement(a);
+            } else if (c == '}') {
+                pop_scope(a);
+            } else {
+                a->state = DP_SKIP;
+                a->nest = 0;
+                on_punct(stats, c);
+            }
+            return;
+        case DP_TAG:
+            if (c == '{') {
+                a->has_type = true;
+                if (a->tag_enum) {
+                    a->state = DP_ENUM_BODY;
+                    a->nest = 0;
+                    a->expect_name = true;
+                } else {
+                    push_scope(a, SCOPE_MEMBERS, DP_SPECIFIERS); // Il flag typedef viene ripristinato alla chiusura
+                    end_statement(a);
+                }
+            } else if (c == ';') {
+                end_statement(a);
+            } else {
+                a->has_type = true;
+                a->state = DP_SPECIFIERS;
+                on_punct(stats, c);
+            }
+            return;
+        case DP_DECLARATOR:
+            switch (c) {
+                case '(':
+                    if (a->grouped || a->pointer_group || a->extra_words) {
+                        // Parametri di un puntatore a funzione o argomenti di un attributo
+                        a->return_state = DP_DECLARATOR;
+                        a->state = DP_PARENS;
+                        a->nest = 1;
+                    } else {
+                        a->function = commit_declarator(stats, SYM_FUNCTION, false);
+                        if (a->stmt_typedef) a->function = NULL;
+                        push_scope(a, SCOPE_FUNCTION, DP_START);
+                        a->deferred_count = 0;
+                        a->state = DP_PARAMS;
+                        a->nest = 1;
+                        a->has_param = false;
+                        a->param_words = 0;
+                        a->param_names = 0;
+                        a->after_tag = false;
+                    }
+                    return;
+                case ')':
+                    if (a->grouped) {
+                        a->grouped = false;
+                        a->pointer_group = true;
+                    }
+                    return;
+                case '[':
+                    a->return_state = DP_DECLARATOR;
+                    a->state = DP_BRACKETS;
+                    a->nest = 1;
+                    return;
+                case '=':
+                    commit_declarator(stats, SYM_VARIABLE, true);
+                    a->state = DP_INITIALIZER;
+                    a->nest = 0;
+                    return;
+                case ',':
+                    commit_declarator(stats, SYM_VARIABLE, false);
+                    next_declarator(a);
+                    return;
+                case ';':
+                    commit_declarator(stats, SYM_VARIABLE, false);
+                    end_statement(a);
+                    return;
+                case '{':
+                    commit_declarator(stats, SYM_VARIABLE, false);
+                    push_scope(a, SCOPE_BLOCK, DP_START);
+                    end_statement(a);
+                    return;
+                case '}':
+                    commit_declarator(stats, SYM_VARIABLE, false);
+                    pop_scope(a);
+                    return;
+                default:
+                    return;
+            }
+        case DP_INITIALIZER:
+            if (c == '(' || c == '[' || c == '{') {
+                a->nest++;
+            } else if (c == ')' || c == ']' || c == '}') {
+                if (a->nest > 0) {
+                    a->nest--;
+                } else if (c == '}') {
+                    pop_scope(a); // Fine del blocco senza ';'
+                }
+            } else if (a->nest == 0 && c == ',') {
+                next_declarator(a);
+            } else if (a->nest == 0 && c == ';') {
+                end_statement(a);
+            }
+            return;
+        case DP_PARAMS:
+            if (c == '(' || c == '[') {
+                a->nest++;
+            } else if (c == ')' || c == ']') {
+                a->nest--;
+                if (a->nest == 0) {
+                    finish_param(stats);
+                    a->state = DP_AFTER_PARAMS;
+                }
+            } else if (c == ',' && a->nest == 1) {
+                finish_param(stats);
+            }
+            return;
+        case DP_AFTER_PARAMS: {
+            if (c == '{') {
+                begin_function_body(stats);
+                return;
+            }
+            // Prototipo: i parametri non restano visibili
+            bool typedef_flag = a->stmt_typedef;
+            bool extern_flag = a->stmt_extern;
+            pop_scope(a);
+            a->stmt_typedef = typedef_flag;
+            a->stmt_extern = extern_flag;
+            switch (c) {
+                case ',':
+                    next_declarator(a);
+                    return;
+                case '=':
+                    a->state = DP_INITIALIZER;
+                    a->nest = 0;
+                    return;
+                case ';':
+                    end_statement(a);
+                    return;
+                case '}':
+                    pop_scope(a);
+                    return;
+                default:
+                    // Dichiaratore più complesso: funzione che restituisce un puntatore a funzione o un array
+                    a->state = DP_DECLARATOR;
+                    a->pointer_group = true;
+                    a->extra_words = false;
+                    on_punct(stats, c);
+                    return;
+            }
+        }
+        case DP_ENUM_BODY:
+            if (c == '(' || c == '[' || c == '{') {
+                a->nest++;
+            } else if (c == ')' || c == ']') {
+                if (a->nest > 0) a->nest--;
+            } else if (c == '}') {
+                if (a->nest > 0) {
+                    a->nest--;
+                } else {
+                    a->state = DP_SPECIFIERS; // "enum E { ... } nome;"
+                    a->has_type = true;
+                }
+            } else if (a->nest == 0 && c == ',') {
+                a->expect_name = true;
+            }
+            return;
+        case DP_PARENS:
+            if (c == '(') {
+                a->nest++;
+            } else if (c == ')' && a->nest > 0) {
+                if (--a->nest == 0) a->state = a->return_state;
+            } else if (a->nest == 0) {
+                a->state = a->return_state; // Parola chiave senza parentesi
+                on_punct(stats, c);
+            }
+            return;
+        case DP_BRACKETS:
+            if (c == '[') {
+                a->nest++;
+            } else if (c == ']' && --a->nest == 0) {
+                a->state = a->return_state;
+            }
+            return;
+        case DP_LINKAGE:
+            if (c == '{') {
+                end_statement(a); // I nomi restano nello scope del file
+            } else {
+                a->state = DP_START;
+                on_punct(stats, c);
+            }
+            return;
+        case DP_FOR:
+            if (c == '(') {
+                // Lo scope del ciclo resta aperto fino alla fine del corpo
+                int count = a->scope_count;
+                push_scope(a, SCOPE_BLOCK, DP_START);
+                if (a->scope_count > count) {
+                    a->scopes[a->scope_count - 1].loop = LOOP_HEADER;
+                    a->state = DP_START; // La clausola iniziale è analizzata come un'istruzione
+                    return;
+                }
+            }
+            a->state = DP_SKIP;
+            a->nest = 0;
+            on_punct(stats, c);
+            return;
+        case DP_FOR_CLAUSES:
+            if (c == '(' || c == '[') {
+                a->nest++;
+            } else if ((c == ')' || c == ']') && --a->nest == 0) {
+                a->scopes[a->scope_count - 1].loop = LOOP_BODY;
+                a->state = DP_START;
+            }
+            return;
+        case DP_SKIP:
+            if (c == '(' || c == '[') {
+                a->nest++;
+            } else if (c == ')' || c == ']') {
+                if (a->nest > 0) a->nest--;
+            } else if (a->nest == 0) {
+                if (c == ';') {
+                    end_statement(a);
+                } else if (c == '{') {
+                    push_scope(a, SCOPE_BLOCK, DP_START);
+                    end_statement(a);
+                } else if (c == '}') {
+                    pop_scope(a);
+                }
+            }
+            return;
+    }
+}
+
+/**
+ * Gestisce una parola tenendo conto dei letterali stringa e carattere: le parole
+ * interne a un letterale vengono ignorate, quelle che lo aprono o chiudono non sono
+ * comunque identificatori validi.
+ */
+static void feed_word(ProcessingStats* stats, const char* word, size_t len) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    bool quoted = false;
+    for (size_t k = 0; k < len; ++k) {
+        quoted |= (word[k] == '"') | (word[k] == '\'');
+    }
+    if (quoted || a->quote) {
+        bool inside = (a->quote != '\0');
+        for (size_t k = 0; k < len; ++k) {
+            char c = word[k];
+            if (a->quote) {
+                if (c == '\\') k++;
+                else if (c == a->quote) a->quote = '\0';
+            } else if (c == '"' || c == '\'') {
+                a->quote = c;
+            }
+        }
+        if (inside) return;
+    }
+    on_word(stats, word, len);
+}
+
+// =====================
+// Interfaccia
+// =====================
+
+/**
+ * Inizializza l'analizzatore delle dichiarazioni con il solo scope del file.
+ * @param a Puntatore all'analizzatore.
+ */
+void init_declaration_analyzer(DeclarationAnalyzer* a) {
+    memset(a, 0, sizeof(*a));
+    a->arena.current = -1;
+    a->state = DP_START;
+    // Indice hash delle parole chiave (posizione in keywords + 1, 0 = vuoto)
+    for (size_t k = 0; k < sizeof(keywords) / sizeof(keywords[0]); ++k) {
+        uint32_t i = hash_name(keywords[k].name, keywords[k].length) & (KEYWORD_SLOTS - 1);
+        while (a->keyword_slots[i]) i = (i + 1) & (KEYWORD_SLOTS - 1);
+        a->keyword_slots[i] = (unsigned char)(k + 1);
+    }
+    push_scope(a, SCOPE_FILE, DP_START);
+}
+
+/**
+ * Libera la memoria dell'analizzatore (arena, pila degli scope e tabella dei nomi).
+ * @param a Puntatore all'analizzatore.
+ */
+void free_declaration_analyzer(DeclarationAnalyzer* a) {
+    for (int i = 0; i < a->arena.count; ++i) {
+        mem_free(a->arena.blocks[i]);
+    }
+    mem_free(a->arena.blocks);
+    mem_free(a->arena.sizes);
+    mem_free(a->scopes);
+    mem_free(a->names);
+    memset(a, 0, sizeof(*a));
+    a->arena.current = -1;
+}
+
+/**
+ * Verifica che l'analizzatore sia nello scope del file, all'inizio di un'istruzione e
+ * fuori da direttive e letterali: lo stesso stato in cui si trova all'inizio di un file.
+ * @param a Puntatore all'analizzatore.
+ * @return true se il testo successivo viene analizzato come un file a sé.
+ */
+bool declaration_analyzer_at_top_level(const DeclarationAnalyzer* a) {
+    return a->scope_count == 1 && a->lost_scopes == 0 && a->state == DP_START &&
+           !a->in_directive && a->quote == '\0';
+}
+
+/**
+ * Dichiara nello scope corrente un simbolo proveniente da un header precompilato,
+ * con gli stessi controlli su duplicati e occultamenti di una dichiarazione letta.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param filename File in cui il simbolo è dichiarato.
+ * @param name Nome del simbolo.
+ * @param line Riga della dichiarazione.
+ * @param kind Tipo di simbolo.
+ * @param defined true se si tratta di una definizione.
+ */
+void import_declaration_symbol(ProcessingStats* stats, const char* filename, const char* name, int line, SymbolKind kind, bool defined) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+    const char* saved_filename = a->filename;
+    a->filename = filename;
+    declare_symbol(stats, name, strlen(name), line, kind, defined, SHADOW_REPORT);
+    a->filename = saved_filename;
+}
+
+/**
+ * Ricompone una parola dell'analisi (sequenza massimale di token WORD/SLASH consecutivi,
+ * eventualmente separati nel sorgente da commenti) a partire dal token t, copiandola in buf.
+ * @return Indice del token successivo alla parola.
+ */
+static int join_word(const TokenStream* stream, int t, int end, char* buf, size_t buf_size, size_t* len) {
+    *len = 0;
+    while (t < end) {
+        int kind = TOKEN_KIND(stream->kinds[t]);
+        if (kind != TOK_WORD && kind != TOK_SLASH) break;
+        size_t piece = stream->lengths[t];
+        if (*len + piece >= buf_size) piece = buf_size - 1 - *len;
+        if (kind == TOK_SLASH) {
+            if (piece > 0) buf[*len] = '/';
+        } else {
+            memcpy(buf + *len, stream->base + stream->offsets[t], piece);
+        }
+        *len += piece;
+        t++;
+    }
+    buf[*len] = '\0';
+    return t;
+}
+
+/**
+ * Restituisce il primo (o l'ultimo) carattere non di spaziatura di un token mantenuto,
+ * oppure '\0' se il token contiene solo spazi o non fa parte del testo mantenuto.
+ */
+static char token_edge_char(const TokenStream* stream, int t, bool last) {
+    int kind = TOKEN_KIND(stream->kinds[t]);
+    if (kind == TOK_SLASH) return '/';
+    if (kind != TOK_WORD && kind != TOK_SEP) return '\0';
+    const char* text = stream->base + stream->offsets[t];
+    size_t len = stream->lengths[t];
+    if (kind == TOK_WORD) return last ? text[len - 1] : text[0];
+    for (size_t k = 0; k < len; ++k) {
+        char c = text[last ? len - 1 - k : k];
+        if (c != ' ' && (c < '\t' || c > '\r')) return c;
+    }
+    return '\0';
+}
+
+/**
+ * Analizza i token di una riga (senza commenti) aggiornando gli scope e le tabelle
+ * dei simboli dell'unità di traduzione: valida i nomi dichiarati e segnala le
+ * dichiarazioni duplicate nello stesso scope e quelle che nascondono un nome esterno.
+ * Le righe devono arrivare nell'ordine dell'output; le direttive sono ignorate.
+ * @param stream Stream di token.
+ * @param first Primo token della riga.
+ * @param end Token successivo all'ultimo della riga.
+ * @param line_num Numero della riga corrente.
+ * @param current_filename Nome del file corrente.
+ * @param stats Puntatore alla struttura delle statistiche (contiene l'analizzatore).
+ */
+void analyze_declaration_tokens(const TokenStream* stream, int first, int end, int line_num, const char* current_filename, ProcessingStats* stats) {
+    DeclarationAnalyzer* a = &stats->analyzer;
+
+    // Primo carattere significativo (non spazio) della riga
+    char first_char = '\0';
+    for (int t = first; t < end && first_char == '\0'; ++t) {
+        first_char = token_edge_char(stream, t, false);
+    }
+    if (first_char == '\0') return; // Ignora righe vuote
+
+    // Direttive del preprocessore, comprese le righe di continuazione
+    if (first_char == '#' || a->in_directive) {
+        char last_char = '\0';
+        for (int t = end - 1; t >= first && last_char == '\0'; --t) {
+            last_char = token_edge_char(stream, t, true);
+        }
+        a->in_directive = (last_char == '\\');
+        return;
+    }
+
+    a->filename = current_filename;
+    a->line = line_num;
+    a->quote = '\0'; // I letterali non attraversano le righe
+
+    // Copie locali degli array: le chiamate al parser non possono modificarli
+    const char* base = stream->base;
+    const unsigned char* kinds = stream->kinds;
+    const uint32_t* offsets = stream->offsets;
+    const uint32_t* lengths = stream->lengths;
+    char word[MAX_LINE_LEN];
+    size_t word_len;
+    for (int t = first; t < end; ) {
+        int kind = TOKEN_KIND(kinds[t]);
+        if (kind == TOK_WORD && (t + 1 >= end || (TOKEN_KIND(kinds[t + 1]) != TOK_WORD && TOKEN_KIND(kinds[t + 1]) != TOK_SLASH))) {
+            // Parola di un solo token: usata direttamente dal sorgente
+            feed_word(stats, base + offsets[t], lengths[t]);
+            t++;
+            continue;
+        }
+        if (kind == TOK_WORD || kind == TOK_SLASH) {
+            t = join_word(stream, t, end, word, sizeof(word), &word_len);
+            feed_word(stats, word, word_len);
+            continue;
+        }
+        if (kind == TOK_SEP && a->quote == '\0') {
+            const char* text = base + offsets[t];
+            uint32_t len = lengths[t];
+            if (len == 1 && text[0] == ' ') {
+                t++; // Separatore più frequente: un solo spazio
+                continue;
+            }
+            for (uint32_t k = 0; k < len; ++k) {
+                char c = text[k];
+                if (c == ' ' || (c >= '\t' && c <= '\r')) continue;
+                on_punct(stats, c);
+            }
+        }
+        t++;
+    }
+}
@@ -0,0 +1,361 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "myPreCompiler.h"
+
+// Dimensione dei blocchi compressi letti dal disco e dei blocchi passati al codec in scrittura
+#define CODEC_CHUNK_SIZE (256 * 1024)
+
+// Buffer di output della decompressione, cresce per raddoppio
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} InflatedBuffer;
+
+// Stato di uno stream di output compresso (cookie di fopencookie)
+typedef struct {
+    Codec codec;
+    FILE* file;             // File compresso su disco
+    z_stream zs;
+#ifdef HAVE_ZSTD
+    ZSTD_CStream* zcs;
+#endif
+    char* block;            // Blocco compresso in attesa di scrittura
+    long written;           // Byte compressi scritti finora
+    long* compressed_bytes; // Destinazione del totale alla chiusura (può essere NULL)
+} CompressedOutput;
+
+// =====================
+// Riconoscimento del formato
+// =====================
+
+/**
+ * Allocatore passato a zlib, così anche lo stato del codec rientra nella memoria contabilizzata.
+ */
+static voidpf codec_zalloc(voidpf opaque, uInt items, uInt size) {
+    (void)opaque;
+    return mem_calloc(items, size);
+}
+
+static void codec_zfree(voidpf opaque, voidpf address) {
+    (void)opaque;
+    mem_free(address);
+}
+
+/**
+ * Riconosce il formato di compressione dai primi byte (magic number) di un file.
+ * @param data Inizio del contenuto del file.
+ * @param size Byte disponibili.
+ * @return CODEC_GZIP, CODEC_ZSTD oppure CODEC_NONE.
+ */
+Codec detect_codec(const char* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    if (size >= 2 && p[0] == 0x1f && p[1] == 0x8b) return CODEC_GZIP;
+    if (size >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd) return CODEC_ZSTD;
+    return CODEC_NONE;
+}
+
+/**
+ * Determina il formato di compressione dall'estensione del nome del file.
+ * @param filename Nome del file.
+ * @return CODEC_GZIP per ".gz", CODEC_ZSTD per ".zst", altrimenti CODEC_NONE.
+ */
+Codec codec_from_filename(const char* filename) {
+    size_t len = strlen(filename);
+    if (len > 3 && strcmp(filename + len - 3, ".gz") == 0) return CODEC_GZIP;
+    if (len > 4 && strcmp(filename + len - 4, ".zst") == 0) return CODEC_ZSTD;
+    return CODEC_NONE;
+}
+
+// =====================
+// Decompressione dell'input
+// =====================
+
+/**
+ * Garantisce spazio libero nel buffer di output della decompressione.
+ * @return true in caso di successo, false se l'allocazione fallisce.
+ */
+static bool reserve_inflated(InflatedBuffer* out, size_t min_free) {
+    if (out->capacity - out->size >= min_free) return true;
+    size_t new_capacity = out->capacity ? out->capacity : CODEC_CHUNK_SIZE;
+    while (new_capacity - out->size < min_free) new_capacity *= 2;
+    char* new_data = mem_realloc(out->data, new_capacity + 1);
+    if (!new_data) return false;
+    out->data = new_data;
+    out->capacity = new_capacity;
+    return true;
+}
+
+/**
+ * Decomprime un blocco gzip. Più membri gzip concatenati formano un unico contenuto.
+ * @return 0 in caso di successo, altrimenti un codice errno.
+ */
+static int inflate_block(z_stream* zs, const char* in, size_t in_size, InflatedBuffer* out) {
+    zs->next_in = (Bytef*)in;
+    zs->avail_in = (uInt)in_size;
+    while (zs->avail_in > 0) {
+        if (!reserve_inflated(out, CODEC_CHUNK_SIZE)) return ENOMEM;
+        zs->next_out = (Bytef*)(out->data + out->size);
+        zs->avail_out = (uInt)(out->capacity - out->size);
+        int ret = inflate(zs, Z_NO_FLUSH);
+        out->size = out->capacity - zs->avail_out;
+        if (ret == Z_STREAM_END) {
+            if (inflateReset(zs) != Z_OK) return EBADMSG;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return (ret == Z_MEM_ERROR) ? ENOMEM : EBADMSG;
+        }
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+/**
+ * Decomprime un blocco zstd (anche su più frame consecutivi).
+ * @param frame_open Impostato a true se il blocco termina a metà di un frame.
+ * @return 0 in caso di successo, altrimenti un codice errno.
+ */
+static int zstd_block(ZSTD_DStream* zds, const char* in, size_t in_size, InflatedBuffer* out, bool* frame_open) {
+    ZSTD_inBuffer input = { in, in_size, 0 };
+    while (input.pos < input.size) {
+        if (!reserve_inflated(out, CODEC_CHUNK_SIZE)) return ENOMEM;
+        ZSTD_outBuffer output = { out->data + out->size, out->capacity - out->size, 0 };
+        size_t ret = ZSTD_decompressStream(zds, &output, &input);
+        if (ZSTD_isError(ret)) return EBADMSG;
+        out->size += output.pos;
+        *frame_open = ret != 0;
+    }
+    return 0;
+}
+#endif
+
+/**
+ * Decomprime in memoria un file sorgente compresso. I byte già letti dall'inizio del
+ * file vengono passati in head; il resto viene letto da fp a blocchi e decompresso
+ * man mano, senza file temporanei.
+ * @param codec Formato di compressione (da detect_codec).
+ * @param head Byte già letti dall'inizio del file.
+ * @param head_size Numero di byte in head.
+ * @param fp File da cui leggere il resto (NULL se head contiene tutto il file).
+ * @param buf Buffer di destinazione (contenuto decompresso terminato da '\0').
+ * @return 0 in caso di successo, altrimenti il codice errno dell'errore.
+ */
+int decompress_source(Codec codec, const char* head, size_t head_size, FILE* fp, SourceBuffer* buf) {
+    InflatedBuffer out = { NULL, 0, 0 };
+    size_t compressed = head_size;
+    int err = 0;
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = codec_zalloc;
+    zs.zfree = codec_zfree;
+#ifdef HAVE_ZSTD
+    ZSTD_DStream* zds = NULL;
+#endif
+    bool frame_open = false;
+    if (codec == CODEC_GZIP) {
+        if (inflateInit2(&zs, 15 + 16) != Z_OK) return ENOMEM;
+    } else {
+#ifdef HAVE_ZSTD
+        zds = ZSTD_createDStream();
+        if (!zds) return ENOMEM;
+#else
+        return ENOTSUP;
+#endif
+    }
+
+    char* block = fp ? mem_alloc(CODEC_CHUNK_SIZE) : NULL;
+    if (fp && !block) err = ENOMEM;
+
+    const char* in = head;
+    size_t in_size = head_size;
+    while (err == 0 && in_size > 0) {
+        if (codec == CODEC_GZIP) {
+            err = inflate_block(&zs, in, in_size, &out);
+        } else {
+#ifdef HAVE_ZSTD
+            err = zstd_block(zds, in, in_size, &out, &frame_open);
+#endif
+        }
+        if (err != 0 || !fp) break;
+        in = block;
+        in_size = fread(block, 1, CODEC_CHUNK_SIZE, fp);
+        compressed += in_size;
+        if (in_size == 0 && ferror(fp)) err = errno ? errno : EIO;
+    }
+    // Un file troncato lascia a metà l'ultimo membro gzip (zs.total_in > 0 dopo l'ultimo reset)
+    // o l'ultimo frame zstd
+    if (err == 0 && ((codec == CODEC_GZIP && zs.total_in > 0) || frame_open)) err = EBADMSG;
+
+    if (codec == CODEC_GZIP) inflateEnd(&zs);
+#ifdef HAVE_ZSTD
+    ZSTD_freeDStream(zds);
+#endif
+    mem_free(block);
+
+    if (err == 0 && !reserve_inflated(&out, 1)) err = ENOMEM;
+    if (err != 0) {
+        mem_free(out.data);
+        return err;
+    }
+    out.data[out.size] = '\0';
+    buf->data = out.data;
+    buf->size = out.size;
+    buf->compressed_size = compressed;
+    buf->owned = true;
+    buf->pins = NULL;
+    return 0;
+}
+
+// =====================
+// Compressione dell'output
+// =====================
+
+/**
+ * Scrive su disco i byte compressi accumulati nel blocco.
+ * @return true in caso di successo, false in caso di errore di scrittura.
+ */
+static bool flush_block(CompressedOutput* co, size_t len) {
+    if (len == 0) return true;
+    if (fwrite(co->block, 1, len, co->file) != len) return false;
+    co->written += (long)len;
+    return true;
+}
+
+/**
+ * Passa al codec un blocco di byte (o, con finish, chiude lo stream compresso).
+ * @return true in caso di successo, false in caso di errore.
+ */
+static bool encode(CompressedOutput* co, const char* data, size_t size, bool finish) {
+    if (co->codec == CODEC_GZIP) {
+        co->zs.next_in = (Bytef*)data;
+        co->zs.avail_in = (uInt)size;
+        int ret;
+        do {
+            co->zs.next_out = (Bytef*)co->block;
+            co->zs.avail_out = CODEC_CHUNK_SIZE;
+            ret = deflate(&co->zs, finish ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR) return false;
+            if (!flush_block(co, CODEC_CHUNK_SIZE - co->zs.avail_out)) return false;
+        } while (co->zs.avail_out == 0 || (finish && ret != Z_STREAM_END));
+        return true;
+    }
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer input = { data, size, 0 };
+    size_t remaining;
+    do {
+        ZSTD_outBuffer output = { co->block, CODEC_CHUNK_SIZE, 0 };
+        remaining = ZSTD_compressStream2(co->zcs, &output, &input, finish ? ZSTD_e_end : ZSTD_e_continue);
+        if (ZSTD_isError(remaining)) return false;
+        if (!flush_block(co, output.pos)) return false;
+    } while (input.pos < input.size || (finish && remaining != 0));
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Funzione di scrittura dello stream compresso: riceve il contenuto del buffer dello
+ * stream (blocchi di CODEC_CHUNK_SIZE byte) e lo passa al codec.
+ */
+static ssize_t compressed_write(void* cookie, const char* data, size_t size) {
+    CompressedOutput* co = cookie;
+    if (!encode(co, data, size, false)) {
+        if (errno == 0) errno = EIO;
+        return 0;
+    }
+    return (ssize_t)size;
+}
+
+/**
+ * Funzione di chiusura dello stream compresso: completa lo stream, chiude il file e
+ * riporta i byte compressi scritti.
+ */
+static int compressed_close(void* cookie) {
+    CompressedOutput* co = cookie;
+    bool ok = encode(co, NULL, 0, true);
+    if (fclose(co->file) != 0) ok = false;
+    if (co->compressed_bytes) *co->compressed_bytes = co->written;
+    if (co->codec == CODEC_GZIP) deflateEnd(&co->zs);
+#ifdef HAVE_ZSTD
+    ZSTD_freeCStream(co->zcs);
+#endif
+    mem_free(co->block);
+    mem_free(co);
+    if (!ok && errno == 0) errno = EIO;
+    return ok ? 0 : EOF;
+}
+
+/**
+ * Apre il file di output in scrittura. Se il nome termina con ".gz" o ".zst" lo stream
+ * restituito comprime al volo: i dati vengono accumulati in un buffer di CODEC_CHUNK_SIZE
+ * byte e passati al codec a blocchi; il file si chiude normalmente con fclose.
+ * @param filename Nome del file di output.
+ * @param compressed_bytes Destinazione dei byte compressi scritti, aggiornata alla chiusura
+ *        (può essere NULL; non viene modificata per i file non compressi).
+ * @return Lo stream aperto, oppure NULL con errno impostato.
+ */
+FILE* open_output_stream(const char* filename, long* compressed_bytes) {
+    Codec codec = codec_from_filename(filename);
+    if (codec == CODEC_NONE) return fopen(filename, "w");
+#ifndef HAVE_ZSTD
+    if (codec == CODEC_ZSTD) {
+        errno = ENOTSUP;
+        return NULL;
+    }
+#endif
+
+    CompressedOutput* co = mem_calloc(1, sizeof(CompressedOutput));
+    if (!co) return NULL;
+    co->codec = codec;
+    co->compressed_bytes = compressed_bytes;
+    co->zs.zalloc = codec_zalloc;
+    co->zs.zfree = codec_zfree;
+    co->block = mem_alloc(CODEC_CHUNK_SIZE);
+    bool ready = co->block != NULL;
+    if (ready && codec == CODEC_GZIP) {
+        ready = deflateInit2(&co->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        if (!ready) errno = ENOMEM;
+    }
+#ifdef HAVE_ZSTD
+    if (ready && codec == CODEC_ZSTD) {
+        co->zcs = ZSTD_createCStream();
+        ready = co->zcs != NULL;
+        if (!ready) errno = ENOMEM;
+    }
+#endif
+    if (ready) {
+        co->file = fopen(filename, "wb");
+        ready = co->file != NULL;
+    }
+
+    FILE* stream = NULL;
+    if (ready) {
+        cookie_io_functions_t io = { .read = NULL, .write = compressed_write, .seek = NULL, .close = compressed_close };
+        stream = fopencookie(co, "w", io);
+        if (stream && setvbuf(stream, NULL, _IOFBF, CODEC_CHUNK_SIZE) != 0) {
+            fprintf(stderr, "Attenzione: Impossibile impostare il buffer dello stream compresso.\n");
+        }
+    }
+    if (stream) return stream;
+
+    int err = errno;
+    if (co->file) fclose(co->file);
+    if (codec == CODEC_GZIP && co->block) deflateEnd(&co->zs);
+#ifdef HAVE_ZSTD
+    ZSTD_freeCStream(co->zcs);
+#endif
+    mem_free(co->block);
+    mem_free(co);
+    errno = err;
+    return NULL;
+}
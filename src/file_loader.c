@@ -0,0 +1,722 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "myPreCompiler.h"
+
+// Numero di voci della submission queue di io_uring
+#define URING_QUEUE_DEPTH 64
+// Dimensione dei blocchi usati dalla lettura sincrona
+#define READ_CHUNK_SIZE 65536
+// Profondità massima di scansione degli include durante il prefetch
+#define MAX_PREFETCH_DEPTH 10
+
+// Operazioni io_uring associate a ciascun file (codificate nello user_data)
+typedef enum {
+    OP_OPEN,
+    OP_STATX,
+    OP_READ,
+    OP_CLOSE
+} UringOp;
+
+// Stato di lettura di un singolo file all'interno di un batch
+typedef struct {
+    const char* filename;   // Nome del file (appartiene alla lista del livello)
+    int fd;                 // Descrittore restituito da OPENAT (-1 se non ancora aperto)
+    bool size_known;        // true quando STATX è completata
+    struct statx stx;       // Risultato di STATX
+    char* data;             // Buffer di lettura
+    size_t size;            // Dimensione attesa
+    size_t read_bytes;      // Byte letti finora
+    bool failed;            // true se una delle operazioni è fallita
+    bool done;              // true quando il file è stato chiuso o scartato
+} PrefetchEntry;
+
+// Anello io_uring mappato in memoria (senza liburing)
+typedef struct {
+    int fd;
+    void* sq_ptr;
+    size_t sq_size;
+    void* cq_ptr;
+    size_t cq_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    unsigned entries;
+    unsigned pending;       // SQE preparate ma non ancora sottomesse
+    unsigned inflight;      // Operazioni sottomesse in attesa di completamento
+} Uring;
+
+// Operazione in coda in attesa di una SQE libera
+typedef struct {
+    int index;
+    UringOp op;
+} QueuedOp;
+
+// =====================
+// Gestione della cache
+// =====================
+
+/**
+ * Inizializza una cache di file vuota.
+ * @param cache Puntatore alla cache da inizializzare.
+ */
+void init_file_cache(FileCache* cache) {
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    cache->clock = 0;
+}
+
+/**
+ * Libera tutta la memoria associata alla cache e la riporta allo stato iniziale.
+ * @param cache Puntatore alla cache da liberare.
+ */
+void free_file_cache(FileCache* cache) {
+    if (!cache) return;
+    for (int i = 0; i < cache->count; ++i) {
+        mem_free(cache->entries[i].filename);
+        mem_free(cache->entries[i].data);
+    }
+    mem_free(cache->entries);
+    init_file_cache(cache);
+}
+
+/**
+ * Cerca un file nella cache.
+ * @param cache Puntatore alla cache.
+ * @param filename Nome del file da cercare.
+ * @return Puntatore alla voce trovata o NULL.
+ */
+static CachedFile* find_cached_file(FileCache* cache, const char* filename) {
+    for (int i = 0; i < cache->count; ++i) {
+        if (strcmp(cache->entries[i].filename, filename) == 0) {
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Inserisce un file nella cache, acquisendo la proprietà del buffer.
+ * @param compressed_size Byte letti dal disco se il file era compresso (0 altrimenti).
+ * @return true in caso di successo, false se l'allocazione fallisce (il buffer viene liberato).
+ */
+static bool add_cached_file(FileCache* cache, const char* filename, char* data, size_t size, size_t compressed_size) {
+    if (cache->count >= cache->capacity) {
+        int new_capacity = (cache->capacity == 0) ? 8 : cache->capacity * 2;
+        CachedFile* new_entries = mem_realloc(cache->entries, new_capacity * sizeof(CachedFile));
+        if (!new_entries) {
+            perror("Errore: Impossibile riallocare memoria per la cache dei file");
+            mem_free(data);
+            return false;
+        }
+        cache->entries = new_entries;
+        cache->capacity = new_capacity;
+    }
+
+    char* name_copy = mem_alloc(strlen(filename) + 1);
+    if (!name_copy) {
+        perror("malloc fallito per filename in add_cached_file");
+        mem_free(data);
+        return false;
+    }
+    strcpy(name_copy, filename);
+
+    cache->entries[cache->count].filename = name_copy;
+    cache->entries[cache->count].data = data;
+    cache->entries[cache->count].size = size;
+    cache->entries[cache->count].compressed_size = compressed_size;
+    cache->entries[cache->count].pins = 0;
+    cache->entries[cache->count].last_use = 0;
+    cache->count++;
+    return true;
+}
+
+/**
+ * Rimuove dalla cache il contenuto dei file non in uso, a partire da quelli usati meno
+ * di recente, finché la memoria non torna sotto la soglia del budget. I file rimossi
+ * restano nell'elenco con data = NULL e al prossimo uso vengono riletti dal disco.
+ * @param cache Puntatore alla cache.
+ */
+static void evict_cached_files(FileCache* cache) {
+    while (memory_pressure(0)) {
+        CachedFile* victim = NULL;
+        for (int i = 0; i < cache->count; ++i) {
+            CachedFile* entry = &cache->entries[i];
+            if (entry->data && entry->pins == 0 && (!victim || entry->last_use < victim->last_use)) {
+                victim = entry;
+            }
+        }
+        if (!victim) return;
+        note_memory_fallback(MEMORY_EVICTED_FILE, (long)victim->size);
+        mem_free(victim->data);
+        victim->data = NULL;
+    }
+}
+
+// =====================
+// Lettura sincrona
+// =====================
+
+/**
+ * Carica un file in memoria. Se il file è presente nella cache restituisce una vista
+ * sul buffer in cache, altrimenti lo legge in modo sincrono a blocchi. I file compressi
+ * (gzip o zstd, riconosciuti dal magic number) vengono decompressi durante la lettura.
+ * Vicino al budget di memoria i file della cache non in uso vengono rimossi e la lettura
+ * sincrona alloca un buffer della dimensione del file invece di farlo crescere per raddoppio.
+ * @param cache Cache dei file letti in anticipo (può essere NULL).
+ * @param filename Nome del file da leggere.
+ * @param buf Buffer di destinazione.
+ * @return 0 in caso di successo, altrimenti il codice errno dell'errore.
+ */
+int read_source_file(FileCache* cache, const char* filename, SourceBuffer* buf) {
+    buf->data = NULL;
+    buf->size = 0;
+    buf->compressed_size = 0;
+    buf->owned = false;
+    buf->pins = NULL;
+
+    // La cache non cresce dopo il prefetch: i puntatori alle voci restano validi
+    if (cache) {
+        if (memory_pressure(0)) evict_cached_files(cache);
+        CachedFile* cached = find_cached_file(cache, filename);
+        if (cached && cached->data) {
+            cached->pins++;
+            cached->last_use = ++cache->clock;
+            buf->data = cached->data;
+            buf->size = cached->size;
+            buf->compressed_size = cached->compressed_size;
+            buf->pins = &cached->pins;
+            return 0;
+        }
+    }
+
+    FILE* fp = fopen(filename, "r");
+    if (!fp) {
+        return errno;
+    }
+
+    size_t capacity = READ_CHUNK_SIZE;
+    struct stat st;
+    if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && memory_pressure((size_t)st.st_size * 2)) {
+        // Un byte in più permette di riconoscere la fine del file senza riallocare
+        capacity = (size_t)st.st_size + 1;
+    }
+    size_t size = 0;
+    char* data = mem_alloc(capacity + 1);
+    if (!data) {
+        fclose(fp);
+        return ENOMEM;
+    }
+
+    // Il primo blocco permette di riconoscere i file compressi, decompressi a blocchi dal resto del file
+    size = fread(data, 1, capacity, fp);
+    Codec codec = detect_codec(data, size);
+    if (codec != CODEC_NONE) {
+        int err = decompress_source(codec, data, size, fp, buf);
+        mem_free(data);
+        fclose(fp);
+        return err;
+    }
+
+    size_t n = size;
+    while (n > 0) {
+        if (size == capacity) {
+            char* new_data = mem_realloc(data, capacity * 2 + 1);
+            if (!new_data) {
+                mem_free(data);
+                fclose(fp);
+                return ENOMEM;
+            }
+            data = new_data;
+            capacity *= 2;
+        }
+        n = fread(data + size, 1, capacity - size, fp);
+        size += n;
+    }
+
+    if (ferror(fp)) {
+        int err = errno ? errno : EIO;
+        mem_free(data);
+        fclose(fp);
+        return err;
+    }
+    fclose(fp);
+
+    data[size] = '\0';
+    buf->data = data;
+    buf->size = size;
+    buf->owned = true;
+    return 0;
+}
+
+/**
+ * Rilascia un buffer ottenuto da read_source_file.
+ * I buffer appartenenti alla cache non vengono liberati, ma tornano rimovibili.
+ * @param buf Buffer da rilasciare.
+ */
+void release_source_buffer(SourceBuffer* buf) {
+    if (buf->owned) {
+        mem_free(buf->data);
+    }
+    if (buf->pins) {
+        (*buf->pins)--;
+    }
+    buf->pins = NULL;
+    buf->data = NULL;
+    buf->size = 0;
+    buf->compressed_size = 0;
+    buf->owned = false;
+}
+
+// =====================
+// io_uring (interfaccia a basso livello)
+// =====================
+
+/**
+ * Crea un'istanza io_uring e mappa in memoria gli anelli di submission e completion.
+ * @return true in caso di successo, false se io_uring non è disponibile.
+ */
+static bool uring_init(Uring* ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int)syscall(SYS_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        if (ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+        ring->cq_size = ring->sq_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+    if (single_mmap) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_size);
+            close(ring->fd);
+            return false;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (!single_mmap) munmap(ring->cq_ptr, ring->cq_size);
+        munmap(ring->sq_ptr, ring->sq_size);
+        close(ring->fd);
+        return false;
+    }
+
+    char* sq = ring->sq_ptr;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+    char* cq = ring->cq_ptr;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    ring->entries = params.sq_entries;
+    return true;
+}
+
+/**
+ * Rilascia le mappature e il descrittore dell'istanza io_uring (una sola volta).
+ */
+static void uring_destroy(Uring* ring) {
+    if (ring->fd < 0) return;
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_size);
+    munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+/**
+ * Restituisce la prossima SQE libera, azzerata, oppure NULL se la coda è piena.
+ */
+static struct io_uring_sqe* uring_get_sqe(Uring* ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring->sq_tail + ring->pending;
+    if (tail - head >= ring->entries || ring->inflight + ring->pending >= ring->entries) {
+        return NULL;
+    }
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->pending++;
+    return sqe;
+}
+
+/**
+ * Sottomette le SQE preparate e attende almeno un completamento se wait è true.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+static int uring_submit(Uring* ring, bool wait) {
+    unsigned to_submit = ring->pending;
+    if (to_submit > 0) {
+        __atomic_store_n(ring->sq_tail, *ring->sq_tail + to_submit, __ATOMIC_RELEASE);
+        ring->pending = 0;
+    }
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        long ret = syscall(SYS_io_uring_enter, ring->fd, to_submit, wait ? 1 : 0, flags, NULL, 0);
+        if (ret >= 0) {
+            ring->inflight += (unsigned)ret;
+            return 0;
+        }
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+// =====================
+// Prefetch batch dell'albero degli include
+// =====================
+
+/**
+ * Prepara la SQE corrispondente a un'operazione su un file del batch.
+ */
+static void prepare_op(struct io_uring_sqe* sqe, PrefetchEntry* entries, int index, UringOp op) {
+    PrefetchEntry* e = &entries[index];
+    switch (op) {
+        case OP_OPEN:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (unsigned long)e->filename;
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            break;
+        case OP_STATX:
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (unsigned long)e->filename;
+            sqe->len = STATX_SIZE;
+            sqe->off = (unsigned long)&e->stx;
+            break;
+        case OP_READ:
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = e->fd;
+            sqe->addr = (unsigned long)(e->data + e->read_bytes);
+            sqe->len = (unsigned)(e->size - e->read_bytes);
+            sqe->off = e->read_bytes;
+            break;
+        case OP_CLOSE:
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = e->fd;
+            break;
+    }
+    sqe->user_data = ((unsigned long)index << 2) | (unsigned long)op;
+}
+
+/**
+ * Accoda un'operazione da sottomettere appena c'è una SQE libera.
+ */
+static bool queue_op(QueuedOp** queue, int* count, int* capacity, int index, UringOp op) {
+    if (*count >= *capacity) {
+        int new_capacity = (*capacity == 0) ? 16 : *capacity * 2;
+        QueuedOp* new_queue = realloc(*queue, new_capacity * sizeof(QueuedOp));
+        if (!new_queue) {
+            perror("Errore: Impossibile riallocare la coda di operazioni io_uring");
+            return false;
+        }
+        *queue = new_queue;
+        *capacity = new_capacity;
+    }
+    (*queue)[*count].index = index;
+    (*queue)[*count].op = op;
+    (*count)++;
+    return true;
+}
+
+/**
+ * Legge in un unico batch io_uring tutti i file indicati: per ogni file vengono sottomessi
+ * insieme OPENAT e STATX, quindi la READ appena entrambe completano e infine la CLOSE.
+ * I completamenti vengono consumati nell'ordine in cui arrivano.
+ * I file letti con successo vengono inseriti nella cache; quelli falliti vengono ignorati
+ * e saranno riletti (con relativo messaggio di errore) dal percorso sincrono.
+ * @return Numero di file inseriti in cache, -1 in caso di errore di io_uring.
+ */
+static int uring_read_batch(Uring* ring, FileCache* cache, char** filenames, int count) {
+    PrefetchEntry* entries = calloc(count, sizeof(PrefetchEntry));
+    if (!entries) {
+        perror("calloc fallito in uring_read_batch");
+        return -1;
+    }
+
+    QueuedOp* queue = NULL;
+    int queue_count = 0, queue_capacity = 0, queue_pos = 0;
+    bool ok = true;
+
+    for (int i = 0; i < count && ok; ++i) {
+        entries[i].filename = filenames[i];
+        entries[i].fd = -1;
+        ok = queue_op(&queue, &queue_count, &queue_capacity, i, OP_OPEN) &&
+             queue_op(&queue, &queue_count, &queue_capacity, i, OP_STATX);
+    }
+
+    // In caso di errore si smette di sottomettere ma si attendono le operazioni in volo,
+    // che scrivono nei buffer delle voci del batch
+    bool ring_ok = true;
+    while ((ok && queue_pos < queue_count) || ring->inflight > 0) {
+        // Riempie la submission queue con le operazioni in attesa
+        struct io_uring_sqe* sqe;
+        while (ok && queue_pos < queue_count && (sqe = uring_get_sqe(ring)) != NULL) {
+            prepare_op(sqe, entries, queue[queue_pos].index, queue[queue_pos].op);
+            queue_pos++;
+        }
+        bool submitting = ring->pending > 0;
+        if (uring_submit(ring, true) != 0) {
+            ok = false;
+            ring_ok = false;
+            if (ring->inflight == 0) break;
+            if (!submitting) {
+                // L'anello non restituisce più i completamenti: viene chiuso prima di
+                // liberare i buffer e i nomi a cui fanno riferimento le operazioni in volo
+                uring_destroy(ring);
+                break;
+            }
+            continue; // Si raccolgono i completamenti senza sottomettere altro
+        }
+
+        // Consuma tutti i completamenti disponibili
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            int index = (int)(cqe->user_data >> 2);
+            UringOp op = (UringOp)(cqe->user_data & 3);
+            int res = cqe->res;
+            PrefetchEntry* e = &entries[index];
+            head++;
+            ring->inflight--;
+
+            switch (op) {
+                case OP_OPEN:
+                    if (res < 0) {
+                        e->failed = true;
+                        e->done = true;
+                    } else {
+                        e->fd = res;
+                    }
+                    break;
+                case OP_STATX:
+                    if (res < 0) {
+                        e->failed = true;
+                    } else {
+                        e->size_known = true;
+                        e->size = (size_t)e->stx.stx_size;
+                    }
+                    break;
+                case OP_READ:
+                    if (res < 0) {
+                        e->failed = true;
+                    } else if (res == 0) {
+                        // Il file si è accorciato dopo STATX: si tiene quanto letto
+                        e->size = e->read_bytes;
+                    } else {
+                        e->read_bytes += (size_t)res;
+                    }
+                    if (!e->failed && e->read_bytes < e->size) {
+                        ok = ok && queue_op(&queue, &queue_count, &queue_capacity, index, OP_READ);
+                    } else {
+                        ok = ok && queue_op(&queue, &queue_count, &queue_capacity, index, OP_CLOSE);
+                    }
+                    break;
+                case OP_CLOSE:
+                    e->fd = -1;
+                    e->done = true;
+                    break;
+            }
+
+            // Quando OPENAT e STATX sono entrambe completate si avvia la lettura
+            if ((op == OP_OPEN || op == OP_STATX) && e->fd >= 0 && e->data == NULL && (e->size_known || e->failed)) {
+                if (!e->failed && memory_pressure(e->size)) {
+                    // Vicino al budget di memoria il file sarà letto al momento dell'uso
+                    note_memory_fallback(MEMORY_SKIPPED_PREFETCH, 0);
+                    e->failed = true;
+                }
+                if (!e->failed) {
+                    e->data = mem_alloc(e->size + 1);
+                    if (!e->data) e->failed = true;
+                }
+                if (!e->failed && e->size > 0) {
+                    ok = ok && queue_op(&queue, &queue_count, &queue_capacity, index, OP_READ);
+                } else {
+                    ok = ok && queue_op(&queue, &queue_count, &queue_capacity, index, OP_CLOSE);
+                }
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // Inserisce in cache i file letti completamente; scarta gli altri
+    int loaded = 0;
+    for (int i = 0; i < count; ++i) {
+        PrefetchEntry* e = &entries[i];
+        if (e->fd >= 0) close(e->fd);
+        if (ok && e->done && !e->failed && e->data) {
+            e->data[e->size] = '\0';
+            // I file compressi vengono messi in cache già decompressi
+            Codec codec = detect_codec(e->data, e->size);
+            SourceBuffer inflated;
+            if (codec == CODEC_NONE) {
+                if (add_cached_file(cache, e->filename, e->data, e->size, 0)) loaded++;
+            } else if (decompress_source(codec, e->data, e->size, NULL, &inflated) == 0) {
+                mem_free(e->data);
+                if (add_cached_file(cache, e->filename, inflated.data, inflated.size, inflated.compressed_size)) loaded++;
+            } else {
+                mem_free(e->data); // Riletto (e segnalato) dal percorso sincrono
+            }
+        } else {
+            mem_free(e->data);
+        }
+    }
+
+    free(queue);
+    free(entries);
+    return (ok && ring_ok) ? loaded : -1;
+}
+
+/**
+ * Individua le direttive #include "..." di un buffer, con la stessa regola usata da
+ * process_c_file (riga che inizia, dopo gli spazi, con "#include"), senza stampare avvisi.
+ * I nomi trovati e non ancora in cache vengono aggiunti alla lista del livello successivo.
+ */
+static bool scan_includes(FileCache* cache, const char* data, char*** names, int* count, int* capacity) {
+    const char* p = data;
+    while (*p) {
+        const char* line_end = strchr(p, '\n');
+        if (!line_end) line_end = p + strlen(p);
+
+        const char* s = p;
+        while (s < line_end && isspace((unsigned char)*s)) s++;
+        if ((size_t)(line_end - s) >= 8 && strncmp(s, "#include", 8) == 0) {
+            const char* q1 = memchr(s, '"', line_end - s);
+            const char* q2 = q1 ? memchr(q1 + 1, '"', line_end - (q1 + 1)) : NULL;
+            if (q2 && q2 > q1 + 1) {
+                size_t len = q2 - (q1 + 1);
+                char* name = malloc(len + 1);
+                if (!name) {
+                    perror("malloc fallito in scan_includes");
+                    return false;
+                }
+                memcpy(name, q1 + 1, len);
+                name[len] = '\0';
+
+                bool known = find_cached_file(cache, name) != NULL;
+                for (int i = 0; i < *count && !known; ++i) {
+                    known = strcmp((*names)[i], name) == 0;
+                }
+                if (known) {
+                    free(name);
+                } else {
+                    if (*count >= *capacity) {
+                        int new_capacity = (*capacity == 0) ? 8 : *capacity * 2;
+                        char** new_names = realloc(*names, new_capacity * sizeof(char*));
+                        if (!new_names) {
+                            perror("Errore: Impossibile riallocare la lista degli include");
+                            free(name);
+                            return false;
+                        }
+                        *names = new_names;
+                        *capacity = new_capacity;
+                    }
+                    (*names)[(*count)++] = name;
+                }
+            }
+        }
+        p = (*line_end) ? line_end + 1 : line_end;
+    }
+    return true;
+}
+
+/**
+ * Legge in anticipo il file radice e tutti i file raggiungibili tramite #include.
+ * L'albero viene esplorato per livelli: tutti gli header scoperti a un livello vengono
+ * letti con un unico batch io_uring, poi scansionati per trovare il livello successivo.
+ * @param cache Cache in cui inserire i file letti.
+ * @param root_filename File di partenza.
+ * @return Numero di file messi in cache, -1 se io_uring non è disponibile.
+ */
+int prefetch_include_tree(FileCache* cache, const char* root_filename) {
+    Uring ring;
+    if (!uring_init(&ring, URING_QUEUE_DEPTH)) {
+        return -1;
+    }
+
+    char** level = malloc(sizeof(char*));
+    int level_count = 0, level_capacity = 1;
+    if (!level) {
+        uring_destroy(&ring);
+        return -1;
+    }
+    level[level_count] = malloc(strlen(root_filename) + 1);
+    if (!level[level_count]) {
+        free(level);
+        uring_destroy(&ring);
+        return -1;
+    }
+    strcpy(level[level_count++], root_filename);
+
+    int total_loaded = 0;
+    for (int depth = 0; depth <= MAX_PREFETCH_DEPTH && level_count > 0; ++depth) {
+        int first_new = cache->count;
+        int loaded = uring_read_batch(&ring, cache, level, level_count);
+
+        for (int i = 0; i < level_count; ++i) free(level[i]);
+        level_count = 0;
+
+        if (loaded < 0) {
+            total_loaded = (total_loaded > 0) ? total_loaded : -1;
+            break;
+        }
+        total_loaded += loaded;
+
+        // Scansiona i file appena letti per costruire il livello successivo
+        for (int i = first_new; i < cache->count; ++i) {
+            if (!scan_includes(cache, cache->entries[i].data, &level, &level_count, &level_capacity)) {
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < level_count; ++i) free(level[i]);
+    free(level);
+    uring_destroy(&ring);
+    return total_loaded;
+}
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "myPreCompiler.h"
+
+// Punti di inclusione elencati per header nel formato testuale (il JSON li riporta tutti)
+#define PROFILE_TEXT_INCLUDERS 8
+
+// Costi di un'occorrenza nel grafo: cumulativi (intero sottoalbero) e propri (esclusi i figli)
+typedef struct {
+    long self_bytes;
+    long cum_bytes;
+    long self_lines;
+    long cum_lines;
+    int64_t self_ns;
+    int64_t cum_ns;
+    bool outermost;         // Nessun antenato con lo stesso nome: conta nei cumulativi dell'header
+} NodeCost;
+
+// Occorrenza ordinata per header e poi per punto di inclusione
+typedef struct {
+    const char* filename;
+    const char* includer;   // File che contiene la direttiva (NULL per il file principale)
+    int line;               // Riga della direttiva
+    int node;               // Indice del nodo nel grafo
+} ProfileEntry;
+
+// Riga del profilo: un header distinto con i totali delle sue occorrenze
+typedef struct {
+    const char* filename;
+    int first;              // Prima occorrenza nell'array ordinato delle ProfileEntry
+    int count;              // Numero di occorrenze
+    long self_bytes;
+    long cum_bytes;
+    long self_lines;
+    long cum_lines;
+    int64_t self_ns;
+    int64_t cum_ns;
+} HeaderProfile;
+
+/**
+ * Ordina le occorrenze per nome del file, poi per file includente e riga della direttiva.
+ */
+static int compare_entries(const void* a, const void* b) {
+    const ProfileEntry* x = a;
+    const ProfileEntry* y = b;
+    int cmp = strcmp(x->filename, y->filename);
+    if (cmp != 0) return cmp;
+    if (!x->includer || !y->includer) return (x->includer != NULL) - (y->includer != NULL);
+    cmp = strcmp(x->includer, y->includer);
+    if (cmp != 0) return cmp;
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+/**
+ * Ordina gli header per byte cumulativi decrescenti (a parità, per nome).
+ */
+static int compare_headers(const void* a, const void* b) {
+    const HeaderProfile* x = a;
+    const HeaderProfile* y = b;
+    if (x->cum_bytes != y->cum_bytes) return (x->cum_bytes < y->cum_bytes) ? 1 : -1;
+    return strcmp(x->filename, y->filename);
+}
+
+/**
+ * Scrive una stringa JSON con i caratteri speciali in forma di escape.
+ */
+static void write_json_string(FILE* stream, const char* str) {
+    fputc('"', stream);
+    for (const unsigned char* p = (const unsigned char*)str; *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', stream);
+            fputc(*p, stream);
+        } else if (*p < 0x20) {
+            fprintf(stream, "\\u%04x", *p);
+        } else {
+            fputc(*p, stream);
+        }
+    }
+    fputc('"', stream);
+}
+
+/**
+ * Elenca i punti di inclusione distinti di un header (file:riga, con il numero di ripetizioni).
+ */
+static void write_includers(FILE* stream, const ProfileEntry* entries, const HeaderProfile* h, bool json) {
+    bool first = true;
+    int listed = 0;
+    for (int i = h->first; i < h->first + h->count;) {
+        int j = i + 1;
+        while (j < h->first + h->count && compare_entries(&entries[i], &entries[j]) == 0) j++;
+        if (entries[i].includer && !json && listed == PROFILE_TEXT_INCLUDERS) {
+            int others = 0;
+            for (int k = i; k < h->first + h->count; ++k) {
+                if (k == i || compare_entries(&entries[k - 1], &entries[k]) != 0) others++;
+            }
+            fprintf(stream, " e altri %d punti", others);
+            break;
+        }
+        if (entries[i].includer) {
+            listed++;
+            if (json) {
+                fprintf(stream, "%s{\"file\": ", first ? "" : ", ");
+                write_json_string(stream, entries[i].includer);
+                fprintf(stream, ", \"line\": %d, \"count\": %d}", entries[i].line, j - i);
+            } else {
+                fprintf(stream, "%s%s:%d", first ? "" : ", ", entries[i].includer, entries[i].line);
+                if (j - i > 1) fprintf(stream, " (x%d)", j - i);
+            }
+            first = false;
+        }
+        i = j;
+    }
+}
+
+/**
+ * Scrive uno stack compresso per ogni occorrenza (file principale;...;header peso),
+ * nel formato accettato dagli strumenti per i flamegraph.
+ */
+static void write_collapsed(FILE* stream, const IncludeGraph* graph, const NodeCost* costs, bool by_time) {
+    int chain[MAX_INCLUDE_DEPTH + 2];
+    for (int i = 0; i < graph->count; ++i) {
+        int depth = 0;
+        for (int n = i; n >= 0 && depth < MAX_INCLUDE_DEPTH + 2; n = graph->nodes[n].parent) {
+            chain[depth++] = n;
+        }
+        for (int d = depth - 1; d >= 0; --d) {
+            fprintf(stream, "%s%s", graph->nodes[chain[d]].filename, d > 0 ? ";" : "");
+        }
+        if (by_time) {
+            fprintf(stream, " %lld\n", (long long)(costs[i].self_ns / 1000));
+        } else {
+            fprintf(stream, " %ld\n", costs[i].self_bytes);
+        }
+    }
+}
+
+/**
+ * Scrive il profilo delle inclusioni: per ogni file distinto del grafo, quante volte è stato
+ * incluso e da dove, i byte e le righe di output e il tempo di elaborazione propri (esclusi
+ * gli header annidati) e cumulativi (inclusi). Nei cumulativi un'occorrenza annidata in
+ * un'altra dello stesso file non viene contata due volte.
+ * @param graph Grafo delle inclusioni registrato durante l'elaborazione.
+ * @param stream Stream di destinazione.
+ * @param format Formato del profilo.
+ * @return 0 in caso di successo, -1 in caso di errore di allocazione o di scrittura.
+ */
+int write_include_profile(const IncludeGraph* graph, FILE* stream, ProfileFormat format) {
+    int n = graph->count;
+    NodeCost* costs = calloc((size_t)(n > 0 ? n : 1), sizeof(NodeCost));
+    ProfileEntry* entries = malloc((size_t)(n > 0 ? n : 1) * sizeof(ProfileEntry));
+    HeaderProfile* headers = malloc((size_t)(n > 0 ? n : 1) * sizeof(HeaderProfile));
+    if (!costs || !entries || !headers) {
+        perror("Errore: Impossibile allocare memoria per il profilo delle inclusioni");
+        free(costs);
+        free(entries);
+        free(headers);
+        return -1;
+    }
+
+    // Costi cumulativi dagli intervalli del nodo, costi propri sottraendo quelli dei figli
+    for (int i = 0; i < n; ++i) {
+        const IncludeNode* node = &graph->nodes[i];
+        costs[i].cum_bytes = node->output_end - node->output_start;
+        costs[i].cum_lines = node->lines_end - node->lines_start;
+        costs[i].cum_ns = (int64_t)(node->time_end_ns - node->time_start_ns);
+        costs[i].self_bytes += costs[i].cum_bytes;
+        costs[i].self_lines += costs[i].cum_lines;
+        costs[i].self_ns += costs[i].cum_ns;
+        if (node->parent >= 0) {
+            costs[node->parent].self_bytes -= costs[i].cum_bytes;
+            costs[node->parent].self_lines -= costs[i].cum_lines;
+            costs[node->parent].self_ns -= costs[i].cum_ns;
+        }
+        costs[i].outermost = true;
+        for (int p = node->parent; p >= 0 && costs[i].outermost; p = graph->nodes[p].parent) {
+            if (strcmp(graph->nodes[p].filename, node->filename) == 0) costs[i].outermost = false;
+        }
+        entries[i].filename = node->filename;
+        entries[i].includer = (node->parent >= 0) ? graph->nodes[node->parent].filename : NULL;
+        entries[i].line = node->include_line;
+        entries[i].node = i;
+    }
+
+    // Raggruppa le occorrenze per file
+    qsort(entries, (size_t)n, sizeof(ProfileEntry), compare_entries);
+    int header_count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i == 0 || strcmp(entries[i].filename, entries[i - 1].filename) != 0) {
+            HeaderProfile* h = &headers[header_count++];
+            memset(h, 0, sizeof(*h));
+            h->filename = entries[i].filename;
+            h->first = i;
+        }
+        HeaderProfile* h = &headers[header_count - 1];
+        const NodeCost* c = &costs[entries[i].node];
+        h->count++;
+        h->self_bytes += c->self_bytes;
+        h->self_lines += c->self_lines;
+        h->self_ns += c->self_ns;
+        if (c->outermost) {
+            h->cum_bytes += c->cum_bytes;
+            h->cum_lines += c->cum_lines;
+            h->cum_ns += c->cum_ns;
+        }
+    }
+    qsort(headers, (size_t)header_count, sizeof(HeaderProfile), compare_headers);
+
+    if (format == PROFILE_TEXT) {
+        fprintf(stream, "\n--- Profilo delle Inclusioni ---\n");
+        fprintf(stream, "%8s %12s %12s %10s %10s %10s %10s  %s\n",
+                "Inclus.", "Byte propri", "Byte cumul.", "Righe pr.", "Righe cum.", "ms propri", "ms cumul.", "File");
+        for (int i = 0; i < header_count; ++i) {
+            const HeaderProfile* h = &headers[i];
+            fprintf(stream, "%8d %12ld %12ld %10ld %10ld %10.3f %10.3f  %s\n", h->count,
+                    h->self_bytes, h->cum_bytes, h->self_lines, h->cum_lines,
+                    (double)h->self_ns / 1e6, (double)h->cum_ns / 1e6, h->filename);
+            if (entries[h->first + h->count - 1].includer) {
+                fprintf(stream, "%8s incluso da: ", "");
+                write_includers(stream, entries, h, false);
+                fputc('\n', stream);
+            }
+        }
+    } else if (format == PROFILE_JSON) {
+        fprintf(stream, "{\"headers\": [");
+        for (int i = 0; i < header_count; ++i) {
+            const HeaderProfile* h = &headers[i];
+            fprintf(stream, "%s\n  {\"file\": ", i > 0 ? "," : "");
+            write_json_string(stream, h->filename);
+            fprintf(stream, ", \"includes\": %d, \"included_from\": [", h->count);
+            write_includers(stream, entries, h, true);
+            fprintf(stream, "], \"self_bytes\": %ld, \"cumulative_bytes\": %ld, \"self_lines\": %ld, \"cumulative_lines\": %ld, "
+                            "\"self_time_ns\": %lld, \"cumulative_time_ns\": %lld}",
+                    h->self_bytes, h->cum_bytes, h->self_lines, h->cum_lines, (long long)h->self_ns, (long long)h->cum_ns);
+        }
+        fprintf(stream, "\n]}\n");
+    } else {
+        write_collapsed(stream, graph, costs, format == PROFILE_COLLAPSED_TIME);
+    }
+
+    free(costs);
+    free(entries);
+    free(headers);
+    if (fflush(stream) != 0 || ferror(stream)) {
+        perror("Errore durante la scrittura del profilo delle inclusioni");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,488 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "myPreCompiler.h"
+
+// Capacità (in token) di una finestra dello stream
+#define TOKEN_WINDOW_CAPACITY 8192
+// Token massimi prodotti da una singola riga (un token per carattere, più '/' sospeso ed EOL)
+#define MAX_TOKENS_PER_LINE (MAX_LINE_LEN + 4)
+
+// Classi dei caratteri di codice: i delimitatori sono quelli che guidano l'analisi
+// delle dichiarazioni (" \t\n\v\f\r,;*()[]={}")
+enum {
+    CC_WORD = 0,    // Carattere di parola (tutto ciò che non è spazio o delimitatore)
+    CC_SPACE,       // Spazio (compreso '\n')
+    CC_PUNCT,       // Delimitatore , ; * ( ) [ ] = { }
+    CC_SLASH        // '/' (possibile inizio di commento)
+};
+
+// Tabella delle classi (i caratteri non elencati sono CC_WORD)
+static const unsigned char char_class[256] = {
+    [' '] = CC_SPACE, ['\t'] = CC_SPACE, ['\v'] = CC_SPACE, ['\f'] = CC_SPACE, ['\r'] = CC_SPACE,
+    [','] = CC_PUNCT, [';'] = CC_PUNCT, ['*'] = CC_PUNCT, ['('] = CC_PUNCT, [')'] = CC_PUNCT,
+    ['['] = CC_PUNCT, [']'] = CC_PUNCT, ['='] = CC_PUNCT, ['{'] = CC_PUNCT, ['}'] = CC_PUNCT,
+    ['\n'] = CC_SPACE, ['/'] = CC_SLASH,
+};
+
+// =====================
+// Token stream
+// =====================
+
+/**
+ * Inizializza uno stream di token vuoto.
+ * @param stream Puntatore allo stream.
+ */
+void init_token_stream(TokenStream* stream) {
+    stream->base = NULL;
+    stream->kinds = NULL;
+    stream->offsets = NULL;
+    stream->lengths = NULL;
+    stream->count = 0;
+    stream->capacity = 0;
+}
+
+/**
+ * Libera gli array dello stream.
+ * @param stream Puntatore allo stream.
+ */
+void free_token_stream(TokenStream* stream) {
+    mem_free(stream->kinds);
+    mem_free(stream->offsets);
+    mem_free(stream->lengths);
+    init_token_stream(stream);
+}
+
+/**
+ * Garantisce che lo stream possa contenere almeno capacity token.
+ * @return true in caso di successo, false se l'allocazione fallisce.
+ */
+bool reserve_token_stream(TokenStream* stream, int capacity) {
+    if (stream->capacity >= capacity) return true;
+    unsigned char* kinds = mem_realloc(stream->kinds, (size_t)capacity);
+    if (kinds) stream->kinds = kinds;
+    uint32_t* offsets = mem_realloc(stream->offsets, (size_t)capacity * sizeof(uint32_t));
+    if (offsets) stream->offsets = offsets;
+    uint32_t* lengths = mem_realloc(stream->lengths, (size_t)capacity * sizeof(uint32_t));
+    if (lengths) stream->lengths = lengths;
+    if (!kinds || !offsets || !lengths) {
+        perror("Errore: Impossibile riallocare memoria per lo stream di token");
+        return false;
+    }
+    stream->capacity = capacity;
+    return true;
+}
+
+// Cursore di scrittura sugli array dello stream, usato dal lexer in variabili locali:
+// i puntatori restrict evitano che ogni scrittura di un tipo costringa a rileggere gli altri campi
+typedef struct {
+    unsigned char* restrict kinds;
+    uint32_t* restrict offsets;
+    uint32_t* restrict lengths;
+    int count;
+} TokenWriter;
+
+/**
+ * Accoda un token, fondendolo con il precedente se ha lo stesso tipo ed è contiguo nel
+ * sorgente (parole e separatori vengono raggruppati).
+ * La capacità deve essere già stata garantita dal chiamante.
+ */
+static inline void push_token(TokenWriter* w, int kind, size_t offset, size_t length) {
+    int last = w->count - 1;
+    if (last >= 0 && w->kinds[last] == kind && kind != TOK_SLASH &&
+        w->offsets[last] + w->lengths[last] == offset) {
+        w->lengths[last] += (uint32_t)length;
+        return;
+    }
+    w->kinds[w->count] = (unsigned char)kind;
+    w->offsets[w->count] = (uint32_t)offset;
+    w->lengths[w->count] = (uint32_t)length;
+    w->count++;
+}
+
+// =====================
+// Lexer
+// =====================
+
+/**
+ * Inizializza il lexer su un buffer in memoria. Le direttive #include vengono
+ * riconosciute finché il campo includes resta true.
+ * @param lexer Puntatore al lexer.
+ * @param data Inizio del buffer.
+ * @param size Dimensione del buffer.
+ * @param start_state Stato iniziale della macchina dei commenti.
+ */
+void init_lexer(Lexer* lexer, const char* data, size_t size, CommentState start_state) {
+    lexer->data = data;
+    lexer->size = size;
+    lexer->pos = 0;
+    lexer->state = start_state;
+    lexer->includes = true;
+}
+
+/**
+ * Suddivide in token una porzione di codice [i, end) priva di '/' e di '\n'.
+ * Il ciclo è senza salti dipendenti dai dati: a ogni carattere l'indice del token corrente
+ * avanza di 1 solo al cambio di classe (parola/separatore), così i confini dei token,
+ * imprevedibili, non causano errori di predizione. Le lunghezze sono calcolate alla fine.
+ * Se l'ultimo token è contiguo e dello stesso tipo, la porzione lo prosegue.
+ * @return true se la porzione contiene caratteri significativi (non di spaziatura).
+ */
+static inline bool lex_code_run(TokenWriter* w, const char* data, size_t i, size_t end, size_t bo) {
+    int cur = w->count - 1;
+    int first = w->count;
+    int prev_kind = -1;
+    uint32_t start = 0;
+    if (cur >= 0 && (w->kinds[cur] == TOK_WORD || w->kinds[cur] == TOK_SEP) &&
+        w->offsets[cur] + w->lengths[cur] == bo + i) {
+        prev_kind = w->kinds[cur];
+        start = w->offsets[cur];
+        first = cur;
+    }
+
+    unsigned significant = 0;
+    for (size_t j = i; j < end; ++j) {
+        unsigned cls = char_class[(unsigned char)data[j]];
+        int kind = (cls == CC_WORD) ? TOK_WORD : TOK_SEP;
+        int boundary = (kind != prev_kind);
+        cur += boundary;
+        start = boundary ? (uint32_t)(bo + j) : start;
+        w->offsets[cur] = start;
+        significant |= (cls != CC_SPACE);
+        prev_kind = kind;
+    }
+
+    // Tipo e lunghezza sono ricavati per token (non per carattere) dal primo carattere
+    const char* base = data - bo;
+    for (int t = first; t <= cur; ++t) {
+        uint32_t next = (t < cur) ? w->offsets[t + 1] : (uint32_t)(bo + end);
+        w->lengths[t] = next - w->offsets[t];
+        unsigned cls = char_class[(unsigned char)base[w->offsets[t]]];
+        w->kinds[t] = (cls == CC_SPACE || cls == CC_PUNCT) ? TOK_SEP : TOK_WORD; // Una parola può iniziare con '/'
+    }
+    w->count = cur + 1;
+    return significant != 0;
+}
+
+/**
+ * Variante di lex_code_run per la sola rimozione dei commenti: la porzione diventa un
+ * unico token, senza suddivisione in parole e separatori.
+ * @return true se la porzione contiene caratteri significativi (non di spaziatura).
+ */
+static inline bool lex_code_span(TokenWriter* w, const char* data, size_t i, size_t end, size_t bo) {
+    unsigned significant = 0;
+    for (size_t j = i; j < end; ++j) {
+        significant |= (char_class[(unsigned char)data[j]] != CC_SPACE);
+    }
+    push_token(w, TOK_WORD, bo + i, end - i);
+    return significant != 0;
+}
+
+/**
+ * Verifica, senza stampare avvisi, se la riga [start, end) inizia (dopo gli spazi) con "#include".
+ * Se sì, indica anche se contiene un nome di file valido tra doppi apici (stessa condizione
+ * di successo di extract_include_filename).
+ */
+static bool scan_include_directive(const char* start, const char* end, bool* valid) {
+    const char* p = start;
+    while (p < end && (char_class[(unsigned char)*p] == CC_SPACE || *p == '\n')) p++;
+    if (end - p < 8 || memcmp(p, "#include", 8) != 0) return false;
+    const char* q1 = memchr(p, '"', (size_t)(end - p));
+    const char* q2 = q1 ? memchr(q1 + 1, '"', (size_t)(end - (q1 + 1))) : NULL;
+    *valid = (q2 != NULL && q2 > q1 + 1);
+    return true;
+}
+
+/**
+ * Analizza una riga (secondo la semantica di fgets) a partire dalla posizione corrente,
+ * producendone i token e il token EOL finale con i flag della riga.
+ * La funzione è sempre espansa: mode è una costante in ogni variante, per cui il
+ * lavoro non richiesto dal livello di dettaglio scompare dal codice generato.
+ * In LEX_LINES vengono prodotti solo le direttive e i token EOL (il flag LINE_BLANK
+ * non è significativo).
+ */
+static ALWAYS_INLINE void lex_line_mode(Lexer* lexer, TokenStream* stream, const LexMode mode) {
+    const char* data = lexer->data;
+    size_t ls = lexer->pos;
+    size_t available = lexer->size - ls;
+    if (available > MAX_LINE_LEN - 1) available = MAX_LINE_LEN - 1;
+    const char* newline = memchr(data + ls, '\n', available);
+    size_t le = newline ? (size_t)(newline - data) + 1 : ls + available;
+    lexer->pos = le;
+
+    // La parte significativa della riga termina al primo '\0', come nel percorso per righe
+    const char* nul = memchr(data + ls, '\0', le - ls);
+    size_t ee = nul ? (size_t)(nul - data) : le;
+
+    const char* base = stream->base;
+    size_t bo = (size_t)(data - base); // Offset del buffer del lexer rispetto alla base dello stream
+    TokenWriter w = { stream->kinds, stream->offsets, stream->lengths, stream->count };
+    unsigned flags = 0;
+
+    bool include_valid = false;
+    if (lexer->includes && scan_include_directive(data + ls, data + ee, &include_valid)) {
+        if (include_valid) {
+            // Direttiva valida: la riga non attraversa la macchina dei commenti
+            push_token(&w, TOK_INCLUDE, bo + ls, le - ls);
+            push_token(&w, TOK_EOL, bo + ls, le - ls);
+            stream->count = w.count;
+            return;
+        }
+        flags |= LINE_BAD_INCLUDE;
+    }
+
+    // Il '\n' finale (se fa parte della parte significativa) viene gestito dopo il ciclo:
+    // così all'interno della riga ogni stato di commento può cercare il proprio terminatore con memchr
+    bool has_newline = (newline != NULL && ee == le);
+    size_t ce = has_newline ? ee - 1 : ee;
+
+    CommentState state = lexer->state;
+    bool had_comment = false;
+    bool significant = false;
+    size_t i = ls;
+
+    while (i < ce) {
+        switch (state) {
+            case CODE: {
+                // Il codice prosegue fino al prossimo '/' (possibile inizio di commento)
+                const char* slash = memchr(data + i, '/', ce - i);
+                size_t j = slash ? (size_t)(slash - data) : ce;
+                if (j > i) {
+                    if (mode == LEX_TOKENS && lex_code_run(&w, data, i, j, bo)) significant = true;
+                    if (mode == LEX_SPANS && lex_code_span(&w, data, i, j, bo)) significant = true;
+                }
+                if (slash) {
+                    state = SLASH;
+                    j++;
+                }
+                i = j;
+                break;
+            }
+            case SLASH: {
+                char c = data[i];
+                bool slash_on_this_line = (i > ls);
+                if (c == '/' || c == '*') {
+                    state = (c == '/') ? LINE_COMMENT : BLOCK_COMMENT;
+                    had_comment = true;
+                    i++;
+                } else {
+                    // Il '/' era codice: viene emesso e il carattere corrente è rielaborato come codice
+                    if (mode == LEX_LINES) {
+                        // Nessun token
+                    } else if (slash_on_this_line) {
+                        push_token(&w, TOK_WORD, bo + i - 1, 1);
+                    } else {
+                        push_token(&w, TOK_SLASH, 0, 1);
+                    }
+                    significant = true;
+                    state = CODE;
+                }
+                break;
+            }
+            case LINE_COMMENT:
+                // Ignora tutto fino a fine riga
+                i = ce;
+                break;
+            case BLOCK_COMMENT: {
+                had_comment = true;
+                const char* star = memchr(data + i, '*', ce - i);
+                if (star) state = STAR_IN_BLOCK;
+                i = star ? (size_t)(star - data) + 1 : ce;
+                break;
+            }
+            case STAR_IN_BLOCK: {
+                had_comment = true;
+                char c = data[i];
+                if (c == '/') {
+                    state = CODE;
+                } else if (c != '*') {
+                    state = BLOCK_COMMENT;
+                }
+                i++;
+                break;
+            }
+        }
+    }
+
+    if (has_newline) {
+        // Il '\n' viene sempre mantenuto e chiude un eventuale commento su singola riga
+        switch (state) {
+            case SLASH:
+                if (mode == LEX_LINES) {
+                    // Nessun token
+                } else if (ce > ls) {
+                    push_token(&w, TOK_WORD, bo + ce - 1, 1);
+                } else {
+                    push_token(&w, TOK_SLASH, 0, 1);
+                }
+                significant = true;
+                state = CODE;
+                break;
+            case LINE_COMMENT:
+                state = CODE;
+                break;
+            case BLOCK_COMMENT:
+                had_comment = true;
+                break;
+            case STAR_IN_BLOCK:
+                had_comment = true;
+                state = BLOCK_COMMENT;
+                break;
+            case CODE:
+                break;
+        }
+        if (mode != LEX_LINES) push_token(&w, TOK_SEP, bo + ce, 1);
+    }
+
+    lexer->state = state;
+    if (had_comment) flags |= LINE_HAD_COMMENT;
+    if (!significant) flags |= LINE_BLANK;
+    if (had_comment && (!significant || state == BLOCK_COMMENT || state == STAR_IN_BLOCK)) {
+        flags |= LINE_COUNT_COMMENT;
+    }
+
+    w.kinds[w.count] = (unsigned char)(TOK_EOL | (flags << TOKEN_FLAGS_SHIFT));
+    w.offsets[w.count] = (uint32_t)(bo + ls);
+    w.lengths[w.count] = (uint32_t)(le - ls);
+    stream->count = w.count + 1;
+}
+
+/**
+ * Produce la prossima finestra di token: righe intere a partire dalla posizione corrente,
+ * finché la capacità della finestra lo consente. Gli offset dei token sono relativi a
+ * stream->base, che viene posto all'inizio della prima riga della finestra.
+ * Il sorgente viene quindi scandito una sola volta, a blocchi che restano in cache.
+ * @param lexer Puntatore al lexer.
+ * @param stream Stream di destinazione (svuotato).
+ * @param mode Livello di dettaglio dei token (costante in ogni variante).
+ * @return true se è stata prodotta almeno una riga, false a fine buffer o in caso di errore.
+ */
+static ALWAYS_INLINE bool lex_window_mode(Lexer* lexer, TokenStream* stream, const LexMode mode) {
+    stream->count = 0;
+    if (lexer->pos >= lexer->size) return false;
+
+    // I file piccoli (tipicamente gli header) non richiedono una finestra completa
+    size_t remaining = lexer->size - lexer->pos;
+    int capacity = (remaining + MAX_TOKENS_PER_LINE < TOKEN_WINDOW_CAPACITY) ? (int)remaining + MAX_TOKENS_PER_LINE : TOKEN_WINDOW_CAPACITY;
+    if (!reserve_token_stream(stream, capacity)) return false;
+
+    stream->base = lexer->data + lexer->pos;
+    while (lexer->pos < lexer->size) {
+        // Una riga produce al più un token per carattere, più '/' sospeso ed EOL
+        size_t line_max = lexer->size - lexer->pos;
+        if (line_max > MAX_LINE_LEN) line_max = MAX_LINE_LEN;
+        if ((size_t)stream->count + line_max + 4 > (size_t)stream->capacity) break;
+        lex_line_mode(lexer, stream, mode);
+    }
+    return true;
+}
+
+// Varianti specializzate per livello di dettaglio
+static bool lex_window_tokens(Lexer* lexer, TokenStream* stream) { return lex_window_mode(lexer, stream, LEX_TOKENS); }
+static bool lex_window_spans(Lexer* lexer, TokenStream* stream) { return lex_window_mode(lexer, stream, LEX_SPANS); }
+static bool lex_window_lines(Lexer* lexer, TokenStream* stream) { return lex_window_mode(lexer, stream, LEX_LINES); }
+
+/**
+ * Produce la prossima finestra di token completa (parole e separatori).
+ * @param lexer Puntatore al lexer.
+ * @param stream Stream di destinazione (svuotato).
+ * @return true se è stata prodotta almeno una riga, false a fine buffer o in caso di errore.
+ */
+bool lex_window(Lexer* lexer, TokenStream* stream) {
+    return lex_window_tokens(lexer, stream);
+}
+
+/**
+ * Produce la prossima finestra con il livello di dettaglio richiesto. La scelta della
+ * variante avviene una volta per finestra.
+ * @param lexer Puntatore al lexer.
+ * @param stream Stream di destinazione (svuotato).
+ * @param mode Livello di dettaglio dei token.
+ * @return true se è stata prodotta almeno una riga, false a fine buffer o in caso di errore.
+ */
+bool lex_window_as(Lexer* lexer, TokenStream* stream, LexMode mode) {
+    switch (mode) {
+        case LEX_SPANS: return lex_window_spans(lexer, stream);
+        case LEX_LINES: return lex_window_lines(lexer, stream);
+        default: return lex_window_tokens(lexer, stream);
+    }
+}
+
+// =====================
+// Consumatori dello stream
+// =====================
+
+/**
+ * Indica se un token fa parte del testo mantenuto (non direttiva, non EOL).
+ */
+static inline bool is_kept_token(int kind) {
+    return kind == TOK_WORD || kind == TOK_SEP || kind == TOK_SLASH;
+}
+
+/**
+ * Copia i token mantenuti dell'intervallo [first, end) in un buffer di testo contiguo,
+ * accodando a dest (se non NULL) i token corrispondenti con offset relativi a text.
+ * @param src Stream di origine.
+ * @param first Primo token.
+ * @param end Token successivo all'ultimo.
+ * @param text Buffer di destinazione del testo.
+ * @param text_offset Posizione in text da cui scrivere.
+ * @param dest Stream compatto di destinazione (capacità garantita dal chiamante) o NULL.
+ * @return Numero di byte scritti.
+ */
+size_t copy_kept_tokens(const TokenStream* src, int first, int end, char* text, size_t text_offset, TokenStream* dest) {
+    size_t written = 0;
+    for (int t = first; t < end; ++t) {
+        int kind = TOKEN_KIND(src->kinds[t]);
+        if (!is_kept_token(kind)) continue;
+        size_t len = src->lengths[t];
+        if (kind == TOK_SLASH) {
+            text[text_offset + written] = '/';
+        } else {
+            memcpy(text + text_offset + written, src->base + src->offsets[t], len);
+        }
+        if (dest) {
+            dest->kinds[dest->count] = (unsigned char)kind;
+            dest->offsets[dest->count] = (uint32_t)(text_offset + written);
+            dest->lengths[dest->count] = (uint32_t)len;
+            dest->count++;
+        }
+        written += len;
+    }
+    return written;
+}
+
+/**
+ * Scrive sullo stream di output i token mantenuti dell'intervallo [first, end),
+ * raggruppando in un'unica scrittura i token contigui nel sorgente.
+ * @param stream Stream di token.
+ * @param first Primo token.
+ * @param end Token successivo all'ultimo.
+ * @param out_stream Stream di output.
+ * @param written Byte scritti (output).
+ * @return true in caso di successo, false in caso di errore di scrittura.
+ */
+bool write_kept_tokens(const TokenStream* stream, int first, int end, FILE* out_stream, size_t* written) {
+    *written = 0;
+    const char* span = NULL;
+    size_t span_len = 0;
+    for (int t = first; t < end; ++t) {
+        int kind = TOKEN_KIND(stream->kinds[t]);
+        if (!is_kept_token(kind)) continue;
+        const char* text = (kind == TOK_SLASH) ? "/" : stream->base + stream->offsets[t];
+        size_t len = stream->lengths[t];
+        if (span && span + span_len == text) {
+            span_len += len;
+            continue;
+        }
+        if (span && fwrite(span, 1, span_len, out_stream) != span_len) return false;
+        *written += span_len;
+        span = text;
+        span_len = len;
+    }
+    if (span && fwrite(span, 1, span_len, out_stream) != span_len) return false;
+    *written += span_len;
+    return true;
+}
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <unistd.h>
 #include "myPreCompiler.h"
 
 /**
@@ -15,10 +16,83 @@ void print_usage(const char* prog_name) {
     fprintf(stderr, "\nOpzioni:\n");
     fprintf(stderr, "  -i <file>          Specifica il file C di input (obbligatorio, può essere primo argomento).\n");
     fprintf(stderr, "  -o <file>          Specifica il file di output. Se omesso, usa stdout.\n");
+    fprintf(stderr, "                     Con estensione .gz o .zst l'output viene compresso.\n");
     fprintf(stderr, "  -v                 Abilita l'output delle statistiche di elaborazione (su stderr).\n");
+    fprintf(stderr, "  --no-uring         Disabilita la lettura batch degli include via io_uring.\n");
+    fprintf(stderr, "  --pipeline         Esegue lettura, rimozione commenti, analisi e scrittura su thread distinti.\n");
+    fprintf(stderr, "  --watch            Dopo l'elaborazione osserva i file coinvolti e rigenera l'output (richiede -o).\n");
+    fprintf(stderr, "  --emit-pch         Precompila l'header di input in <output_file> (default: <input_file>.pch).\n");
+    fprintf(stderr, "  --no-pch           Ignora i file .pch accanto agli header inclusi.\n");
+    fprintf(stderr, "  --shm-cache[=<nome>]\n");
+    fprintf(stderr, "                     Condivide gli header elaborati tra i processi in un segmento di memoria condivisa.\n");
+    fprintf(stderr, "  --shm-cache-size=N[K|M|G]\n");
+    fprintf(stderr, "                     Dimensione del segmento creato da --shm-cache (default: 64M).\n");
+    fprintf(stderr, "  --only=<stadi>     Esegue solo gli stadi indicati, separati da virgole: strip, includes, check.\n");
+    fprintf(stderr, "  --minify           Compatta gli spazi fuori dai letterali ed elimina le righe vuote.\n");
+    fprintf(stderr, "  --line-markers     Con --minify, inserisce marcatori #line per risalire alle righe originali.\n");
+    fprintf(stderr, "  --error-log=<file> Scrive gli errori sugli identificatori appena rilevati ('-' = stderr).\n");
+    fprintf(stderr, "  --max-errors=N     Mantiene in memoria al più N errori distinti (i più frequenti).\n");
+    fprintf(stderr, "  --max-memory=N[K|M|G]\n");
+    fprintf(stderr, "                     Budget di memoria: vicino al limite riduce cache, errori mantenuti e buffer.\n");
+    fprintf(stderr, "  --include-profile=<file>\n");
+    fprintf(stderr, "                     Scrive il costo di ciascun header incluso: inclusioni, byte, righe, tempo ('-' = stderr).\n");
+    fprintf(stderr, "  --profile-format=<formato>\n");
+    fprintf(stderr, "                     Formato del profilo: text (default), json, collapsed, collapsed-time.\n");
+    fprintf(stderr, "  --progress=N       Scrive un rapporto di avanzamento ogni N secondi (sempre su SIGUSR1).\n");
+    fprintf(stderr, "  --status-file=<file>\n");
+    fprintf(stderr, "                     Scrive i rapporti di avanzamento nel file invece che su stderr.\n");
+    fprintf(stderr, "  --timeout=N        Interrompe l'elaborazione se non avanza per N secondi.\n");
+    fprintf(stderr, "  --parallel-strip[=N]\n");
+    fprintf(stderr, "                     Rimuove i commenti dei file molto grandi in parallelo su N thread (default: CPU disponibili).\n");
     fprintf(stderr, "  <input_file.c>     Alternativa per specificare l'input se è il primo argomento.\n");
 }
 
+/**
+ * Interpreta l'elenco degli stadi di --only (nomi separati da virgole).
+ * @param list Elenco, ad esempio "strip,includes".
+ * @param stages Maschera STAGE_* risultante.
+ * @return 0 in caso di successo, -1 se l'elenco è vuoto o contiene nomi non validi.
+ */
+static int parse_stages(const char* list, unsigned* stages) {
+    *stages = 0;
+    const char* p = list;
+    while (*p != '\0') {
+        size_t len = strcspn(p, ",");
+        if (len == 5 && strncmp(p, "strip", 5) == 0) {
+            *stages |= STAGE_STRIP;
+        } else if (len == 8 && strncmp(p, "includes", 8) == 0) {
+            *stages |= STAGE_INCLUDES;
+        } else if (len == 5 && strncmp(p, "check", 5) == 0) {
+            *stages |= STAGE_CHECK;
+        } else {
+            return -1;
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+    return (*stages != 0) ? 0 : -1;
+}
+
+/**
+ * Interpreta una dimensione in byte con suffisso opzionale K, M o G (potenze di 1024).
+ * @param text Dimensione, ad esempio "512M".
+ * @param bytes Dimensione risultante in byte.
+ * @return 0 in caso di successo, -1 se la dimensione non è valida.
+ */
+static int parse_size(const char* text, long* bytes) {
+    char* end = NULL;
+    long n = strtol(text, &end, 10);
+    if (end == text || n < 1) return -1;
+    long unit = 1;
+    if (*end == 'K' || *end == 'k') unit = 1024L;
+    else if (*end == 'M' || *end == 'm') unit = 1024L * 1024;
+    else if (*end == 'G' || *end == 'g') unit = 1024L * 1024 * 1024;
+    if (unit > 1) end++;
+    if (*end != '\0' || n > (1L << 50) / unit) return -1;
+    *bytes = n * unit;
+    return 0;
+}
+
 /**
  * Funzione principale del precompilatore.
  * Gestisce il parsing degli argomenti, apre i file di input/output,
@@ -28,6 +102,24 @@ int main(int argc, char *argv[]) {
     char* input_filename = NULL;     // Nome del file di input C da processare
     char* output_filename = NULL;    // Nome del file di output (opzionale)
     bool verbose_mode = false;       // Flag per abilitare la stampa delle statistiche
+    bool use_io_uring = true;        // Flag per il prefetch batch degli include via io_uring
+    bool pipeline_mode = false;      // Flag per l'esecuzione a pipeline multi-thread
+    int strip_threads = 1;           // Thread per la rimozione parallela dei commenti
+    bool watch_mode = false;         // Flag per la modalità watch (rigenerazione incrementale)
+    bool emit_pch = false;           // Flag per la generazione di un header precompilato
+    bool use_pch = true;             // Flag per l'uso dei file .pch degli header inclusi
+    const char* error_log = NULL;    // Destinazione in streaming degli errori (NULL = nessuna)
+    int max_errors = -1;             // Errori distinti mantenuti in memoria (-1 = tutti)
+    unsigned stages = STAGE_ALL;     // Stadi di elaborazione attivi
+    bool minify = false;             // Flag per la minificazione dell'output
+    bool line_markers = false;       // Flag per i marcatori #line nell'output minificato
+    const char* include_profile = NULL; // Destinazione del profilo delle inclusioni (NULL = nessuno)
+    ProfileFormat profile_format = PROFILE_TEXT; // Formato del profilo delle inclusioni
+    ProgressOptions progress = { .interval = 0, .timeout = 0, .status_file = NULL }; // Rapporto di avanzamento
+    long max_memory = 0;             // Budget di memoria in byte (0 = nessuno)
+    bool shm_cache = false;          // Flag per la cache degli header in memoria condivisa
+    const char* shm_name = NULL;     // Nome del segmento condiviso (NULL = default)
+    long shm_size = 0;               // Dimensione del segmento da creare (0 = default)
 
     // --- Parsing manuale degli argomenti della riga di comando ---
     // Supporta: -i <input>, -o <output>, -v, oppure input come primo argomento
@@ -62,6 +154,97 @@ int main(int argc, char *argv[]) {
                 }
             } else if (strcmp(argv[i], "-v") == 0) {
                 verbose_mode = true; // Abilita modalità verbosa
+            } else if (strcmp(argv[i], "--no-uring") == 0) {
+                use_io_uring = false; // Forza la lettura sincrona dei file
+            } else if (strcmp(argv[i], "--pipeline") == 0) {
+                pipeline_mode = true; // Abilita la pipeline multi-thread
+            } else if (strcmp(argv[i], "--watch") == 0) {
+                watch_mode = true; // Abilita la modalità watch
+            } else if (strcmp(argv[i], "--emit-pch") == 0) {
+                emit_pch = true; // Genera il file .pch invece dell'output
+            } else if (strcmp(argv[i], "--no-pch") == 0) {
+                use_pch = false; // Elabora sempre gli header inclusi
+            } else if (strcmp(argv[i], "--shm-cache") == 0) {
+                shm_cache = true; // Header elaborati condivisi tra processi
+            } else if (strncmp(argv[i], "--shm-cache=", 12) == 0 && argv[i][12] != '\0') {
+                shm_cache = true;
+                shm_name = argv[i] + 12;
+            } else if (strncmp(argv[i], "--shm-cache-size=", 17) == 0) {
+                if (parse_size(argv[i] + 17, &shm_size) != 0) {
+                    fprintf(stderr, "Errore: Dimensione della memoria condivisa non valida in '%s'.\n", argv[i]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+            } else if (strcmp(argv[i], "--minify") == 0) {
+                minify = true; // Compatta gli spazi dell'output
+            } else if (strcmp(argv[i], "--line-markers") == 0) {
+                line_markers = true; // Marcatori #line (con --minify)
+            } else if (strncmp(argv[i], "--only=", 7) == 0) {
+                if (parse_stages(argv[i] + 7, &stages) != 0) {
+                    fprintf(stderr, "Errore: Elenco di stadi non valido in '%s'.\n", argv[i]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "--include-profile=", 18) == 0 && argv[i][18] != '\0') {
+                include_profile = argv[i] + 18; // Profilo delle inclusioni
+            } else if (strncmp(argv[i], "--profile-format=", 17) == 0) {
+                const char* format = argv[i] + 17;
+                if (strcmp(format, "text") == 0) {
+                    profile_format = PROFILE_TEXT;
+                } else if (strcmp(format, "json") == 0) {
+                    profile_format = PROFILE_JSON;
+                } else if (strcmp(format, "collapsed") == 0) {
+                    profile_format = PROFILE_COLLAPSED;
+                } else if (strcmp(format, "collapsed-time") == 0) {
+                    profile_format = PROFILE_COLLAPSED_TIME;
+                } else {
+                    fprintf(stderr, "Errore: Formato del profilo non valido in '%s'.\n", argv[i]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "--error-log=", 12) == 0 && argv[i][12] != '\0') {
+                error_log = argv[i] + 12; // Streaming degli errori
+            } else if (strncmp(argv[i], "--max-errors=", 13) == 0) {
+                char* end = NULL;
+                long n = strtol(argv[i] + 13, &end, 10);
+                if (end == argv[i] + 13 || *end != '\0' || n < 0 || n > 100000000) {
+                    fprintf(stderr, "Errore: Numero massimo di errori non valido in '%s'.\n", argv[i]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                max_errors = (int)n;
+            } else if (strncmp(argv[i], "--max-memory=", 13) == 0) {
+                if (parse_size(argv[i] + 13, &max_memory) != 0) {
+                    fprintf(stderr, "Errore: Budget di memoria non valido in '%s'.\n", argv[i]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+            } else if (strncmp(argv[i], "--progress=", 11) == 0 || strncmp(argv[i], "--timeout=", 10) == 0) {
+                bool is_timeout = argv[i][2] == 't';
+                const char* value = argv[i] + (is_timeout ? 10 : 11);
+                char* end = NULL;
+                long n = strtol(value, &end, 10);
+                if (end == value || *end != '\0' || n < 1 || n > 86400) {
+                    fprintf(stderr, "Errore: Numero di secondi non valido in '%s'.\n", argv[i]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                if (is_timeout) progress.timeout = (int)n;
+                else progress.interval = (int)n;
+            } else if (strncmp(argv[i], "--status-file=", 14) == 0 && argv[i][14] != '\0') {
+                progress.status_file = argv[i] + 14; // Destinazione dei rapporti di avanzamento
+            } else if (strcmp(argv[i], "--parallel-strip") == 0) {
+                long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                strip_threads = (cpus > 1) ? (int)cpus : 2;
+            } else if (strncmp(argv[i], "--parallel-strip=", 17) == 0) {
+                char* end = NULL;
+                long n = strtol(argv[i] + 17, &end, 10);
+                if (end == argv[i] + 17 || *end != '\0' || n < 1 || n > 1024) {
+                    fprintf(stderr, "Errore: Numero di thread non valido in '%s'.\n", argv[i]);
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                strip_threads = (int)n;
             } else {
                 fprintf(stderr, "Errore: Opzione non riconosciuta '%s'.\n", argv[i]);
                 print_usage(argv[0]);
@@ -84,29 +267,181 @@ int main(int argc, char *argv[]) {
         print_usage(argv[0]);
         return 1;
     }
+    // La modalità watch riscrive il file di output a ogni modifica: serve un file, non stdout
+    if (watch_mode && output_filename == NULL) {
+        fprintf(stderr, "Errore: L'opzione --watch richiede un file di output (-o <file>).\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (watch_mode && pipeline_mode) {
+        fprintf(stderr, "Errore: Le opzioni --watch e --pipeline non possono essere usate insieme.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (stages != STAGE_ALL && (watch_mode || pipeline_mode || emit_pch)) {
+        fprintf(stderr, "Errore: L'opzione --only non può essere usata con --watch, --pipeline o --emit-pch.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (line_markers && !minify) {
+        fprintf(stderr, "Errore: L'opzione --line-markers richiede --minify.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (minify && (watch_mode || emit_pch)) {
+        fprintf(stderr, "Errore: L'opzione --minify non può essere usata con --watch o --emit-pch.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (emit_pch && (watch_mode || pipeline_mode)) {
+        fprintf(stderr, "Errore: L'opzione --emit-pch non può essere usata con --watch o --pipeline.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    // Il profilo si basa sul grafo delle inclusioni della sola elaborazione sequenziale
+    if (include_profile != NULL && (watch_mode || pipeline_mode || emit_pch)) {
+        fprintf(stderr, "Errore: L'opzione --include-profile non può essere usata con --watch, --pipeline o --emit-pch.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    // La cache condivisa sostituisce gli header come i file .pch, solo nell'elaborazione sequenziale
+    if (shm_cache && (watch_mode || pipeline_mode || emit_pch)) {
+        fprintf(stderr, "Errore: L'opzione --shm-cache non può essere usata con --watch, --pipeline o --emit-pch.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (shm_size > 0 && !shm_cache) {
+        fprintf(stderr, "Errore: L'opzione --shm-cache-size richiede --shm-cache.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    // In modalità watch il processo resta in attesa di modifiche: nessun rapporto né watchdog
+    if (watch_mode && (progress.interval > 0 || progress.timeout > 0 || progress.status_file != NULL)) {
+        fprintf(stderr, "Errore: Le opzioni --progress, --status-file e --timeout non possono essere usate con --watch.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    // Il file .pch viene mappato in memoria: non può essere compresso
+    if (emit_pch && output_filename != NULL && codec_from_filename(output_filename) != CODEC_NONE) {
+        fprintf(stderr, "Errore: Il file generato da --emit-pch non può essere compresso.\n");
+        print_usage(argv[0]);
+        return 1;
+    }
     // --- Fine parsing argomenti ---
 
+    // Il budget vale per tutte le modalità: le strutture si adattano vicino al limite
+    set_memory_budget(max_memory);
+
+    // Modalità watch: elaborazione iniziale e rigenerazione incrementale fino a SIGINT/SIGTERM
+    if (watch_mode) {
+        ProcessingOptions watch_options = { .file_cache = NULL, .strip_threads = strip_threads, .include_graph = NULL, .use_pch = false, .stages = STAGE_ALL };
+        fprintf(stderr, "Processando il file: %s\n", input_filename);
+        return run_watch_mode(input_filename, output_filename, &watch_options, verbose_mode);
+    }
+
+    // Rapporto di avanzamento (SIGUSR1, periodico, watchdog): avviato prima di qualsiasi altro thread
+    if (start_progress_reporter(&progress) != 0) {
+        return 1;
+    }
+
+    // Generazione di un header precompilato: l'output processato va nel file .pch
+    if (emit_pch) {
+        ProcessingOptions pch_options = { .file_cache = NULL, .strip_threads = strip_threads, .include_graph = NULL, .use_pch = false, .stages = STAGE_ALL };
+        char* pch_filename = NULL;
+        if (output_filename == NULL) {
+            pch_filename = malloc(strlen(input_filename) + sizeof(PCH_SUFFIX));
+            if (!pch_filename) {
+                perror("Errore: Impossibile allocare memoria per il nome del file .pch");
+                return 1;
+            }
+            sprintf(pch_filename, "%s%s", input_filename, PCH_SUFFIX);
+        }
+        fprintf(stderr, "Precompilando il file: %s\n", input_filename);
+        int pch_result = emit_precompiled_header(input_filename, output_filename ? output_filename : pch_filename, &pch_options, verbose_mode);
+        free(pch_filename);
+        stop_progress_reporter();
+        return (pch_result == 0) ? 0 : 1;
+    }
+
+    // Inizializza la struttura delle statistiche di elaborazione
+    ProcessingStats stats;
+    init_stats(&stats, verbose_mode);
+
     // Determina lo stream di output: stdout di default, oppure file se richiesto
+    // (compresso al volo se il nome termina con .gz o .zst)
     FILE* out_stream = stdout;
     bool custom_output_file = false; // Serve per sapere se chiudere out_stream
     if (output_filename != NULL) {
-        out_stream = fopen(output_filename, "w");
+        out_stream = open_output_stream(output_filename, &stats.output_compressed_bytes);
         if (!out_stream) {
             fprintf(stderr, "Errore: Impossibile aprire il file di output '%s': %s\n", output_filename, strerror(errno));
+            free_stats(&stats);
             return 1;
         }
         custom_output_file = true;
     }
 
-    // Inizializza la struttura delle statistiche di elaborazione
-    ProcessingStats stats;
-    init_stats(&stats, verbose_mode);
+    // Destinazione degli errori: streaming opzionale e limite degli errori in memoria
+    FILE* error_stream = NULL;
+    if (error_log != NULL) {
+        error_stream = (strcmp(error_log, "-") == 0) ? stderr : fopen(error_log, "w");
+        if (!error_stream) {
+            fprintf(stderr, "Errore: Impossibile aprire il file degli errori '%s': %s\n", error_log, strerror(errno));
+            if (custom_output_file) fclose(out_stream);
+            free_stats(&stats);
+            return 1;
+        }
+    }
+    configure_error_sink(&stats, error_stream ? write_error_to_stream : NULL, error_stream, true, max_errors);
+
+    // Prefetch dell'albero degli include: tutti gli header vengono letti in batch via io_uring.
+    // Se io_uring non è disponibile si prosegue con la lettura sincrona.
+    FileCache file_cache;
+    init_file_cache(&file_cache);
+    ProcessingOptions options = { .file_cache = NULL, .strip_threads = strip_threads, .include_graph = NULL, .use_pch = use_pch, .stages = stages,
+                                  .minify = minify, .line_markers = line_markers };
+    // Cache condivisa degli header: il prefetch leggerebbe in anticipo proprio gli header
+    // che la cache permette di non leggere, per cui in questo caso viene saltato
+    SharedHeaderCache shared_cache = { NULL, 0, 0, 0, 0 };
+    if (shm_cache) {
+        if (open_shared_header_cache(&shared_cache, shm_name, shm_size) != 0) {
+            if (custom_output_file) fclose(out_stream);
+            if (error_stream && error_stream != stderr) fclose(error_stream);
+            free_stats(&stats);
+            return 1;
+        }
+        options.shm_cache = &shared_cache;
+    }
+    if (use_io_uring && !shm_cache && (stages & STAGE_INCLUDES)) {
+        int prefetched = prefetch_include_tree(&file_cache, input_filename);
+        if (prefetched >= 0) {
+            options.file_cache = &file_cache;
+            if (verbose_mode) {
+                fprintf(stderr, "Prefetch io_uring: %d file letti in batch.\n", prefetched);
+            }
+        } else if (verbose_mode) {
+            fprintf(stderr, "io_uring non disponibile: uso della lettura sincrona.\n");
+        }
+    }
+    // Il profilo delle inclusioni registra il grafo (i file .pch vengono quindi ignorati)
+    IncludeGraph include_graph;
+    init_include_graph(&include_graph);
+    if (include_profile != NULL) {
+        options.include_graph = &include_graph;
+    }
+    stats.options = &options;
 
     // --- Avvia il pre-processing del file ---
     fprintf(stderr, "Processando il file: %s\n", input_filename);
-    int result = process_c_file(input_filename, out_stream, &stats, 0); // 0 = profondità iniziale
+    int result;
+    if (pipeline_mode) {
+        result = process_c_file_pipelined(input_filename, out_stream, &stats);
+    } else {
+        result = process_c_file(input_filename, out_stream, &stats, 0); // 0 = profondità iniziale
+    }
 
     // --- Operazioni di chiusura e stampa risultati ---
+    stop_progress_reporter();
     // Chiudi il file di output solo se non è stdout
     if (custom_output_file) {
         if (fclose(out_stream) != 0) {
@@ -119,13 +454,36 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "File processato scritto su stdout.\n");
     }
 
+    // Profilo delle inclusioni, anche se l'elaborazione è terminata con errori
+    if (include_profile != NULL) {
+        FILE* profile_stream = (strcmp(include_profile, "-") == 0) ? stderr : fopen(include_profile, "w");
+        if (!profile_stream) {
+            fprintf(stderr, "Errore: Impossibile aprire il file del profilo '%s': %s\n", include_profile, strerror(errno));
+            if (result == 0) result = 1;
+        } else {
+            if (write_include_profile(&include_graph, profile_stream, profile_format) != 0 && result == 0) result = 1;
+            if (profile_stream != stderr && fclose(profile_stream) != 0) {
+                fprintf(stderr, "Errore durante la chiusura del file del profilo '%s': %s\n", include_profile, strerror(errno));
+                if (result == 0) result = 1;
+            }
+        }
+    }
+
+    if (error_stream && error_stream != stderr && fclose(error_stream) != 0) {
+        fprintf(stderr, "Errore durante la chiusura del file degli errori '%s': %s\n", error_log, strerror(errno));
+        if (result == 0) result = 1;
+    }
+
     // Stampa statistiche di elaborazione se richiesto
     if (verbose_mode) {
         print_stats(&stats, stderr);
     }
 
-    // Libera memoria allocata per le statistiche
+    // Libera memoria allocata per le statistiche e per la cache dei file
     free_stats(&stats);
+    free_file_cache(&file_cache);
+    free_include_graph(&include_graph);
+    close_shared_header_cache(&shared_cache);
 
     // Messaggio finale di stato
     if (result == 0) {
@@ -0,0 +1,167 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <malloc.h>
+#include "myPreCompiler.h"
+
+// Percentuale del budget oltre la quale cache, errori e buffer si adattano: il margine
+// restante assorbe le allocazioni che non possono essere ridotte (ad esempio un file letto)
+#define MEMORY_SOFT_LIMIT_PERCENT 75
+
+// Contatori condivisi: le allocazioni avvengono anche nei thread della pipeline e della
+// rimozione parallela dei commenti
+typedef struct {
+    atomic_long live;
+    atomic_long peak;
+    long budget;
+    long soft_limit;
+    atomic_int evicted_files;
+    atomic_long evicted_bytes;
+    atomic_int skipped_prefetch;
+    atomic_int reduced_buffers;
+    atomic_bool errors_streamed;
+} MemoryAccount;
+
+static MemoryAccount account;
+
+// =====================
+// Allocazioni contabilizzate
+// =====================
+
+/**
+ * Aggiorna i byte allocati e il picco. I byte contati sono quelli effettivamente
+ * riservati dall'allocatore (malloc_usable_size), così mem_free non deve conoscere
+ * la dimensione richiesta.
+ */
+static void charge(long delta) {
+    long live = atomic_fetch_add_explicit(&account.live, delta, memory_order_relaxed) + delta;
+    if (delta <= 0) return;
+    long peak = atomic_load_explicit(&account.peak, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&account.peak, &peak, live, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+/**
+ * Alloca un blocco contabilizzato.
+ * @param size Dimensione in byte.
+ * @return Il blocco, NULL se la memoria è esaurita.
+ */
+void* mem_alloc(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr) charge((long)malloc_usable_size(ptr));
+    return ptr;
+}
+
+/**
+ * Alloca un blocco contabilizzato azzerato.
+ * @param count Numero di elementi.
+ * @param size Dimensione di un elemento.
+ * @return Il blocco, NULL se la memoria è esaurita.
+ */
+void* mem_calloc(size_t count, size_t size) {
+    void* ptr = calloc(count, size);
+    if (ptr) charge((long)malloc_usable_size(ptr));
+    return ptr;
+}
+
+/**
+ * Alloca un blocco contabilizzato allineato (ad esempio alla linea di cache).
+ * @param alignment Allineamento in byte (potenza di 2).
+ * @param size Dimensione in byte (multiplo di alignment).
+ * @return Il blocco, NULL se la memoria è esaurita.
+ */
+void* mem_aligned_alloc(size_t alignment, size_t size) {
+    void* ptr = aligned_alloc(alignment, size);
+    if (ptr) charge((long)malloc_usable_size(ptr));
+    return ptr;
+}
+
+/**
+ * Ridimensiona un blocco contabilizzato (o ne alloca uno nuovo se ptr è NULL).
+ * In caso di errore il blocco originale resta valido e contabilizzato.
+ * @param ptr Blocco da ridimensionare.
+ * @param size Nuova dimensione in byte.
+ * @return Il blocco ridimensionato, NULL se la memoria è esaurita.
+ */
+void* mem_realloc(void* ptr, size_t size) {
+    long old_size = ptr ? (long)malloc_usable_size(ptr) : 0;
+    void* new_ptr = realloc(ptr, size);
+    if (new_ptr) charge((long)malloc_usable_size(new_ptr) - old_size);
+    return new_ptr;
+}
+
+/**
+ * Libera un blocco ottenuto da mem_alloc, mem_calloc o mem_realloc.
+ * @param ptr Blocco da liberare (può essere NULL).
+ */
+void mem_free(void* ptr) {
+    if (!ptr) return;
+    charge(-(long)malloc_usable_size(ptr));
+    free(ptr);
+}
+
+// =====================
+// Budget
+// =====================
+
+/**
+ * Imposta il budget di memoria. Il budget non fa mai fallire un'allocazione: oltre la
+ * soglia di adattamento le strutture che possono farlo liberano o riducono la memoria.
+ * @param bytes Budget in byte (0 = nessun budget).
+ */
+void set_memory_budget(long bytes) {
+    account.budget = bytes;
+    account.soft_limit = bytes / 100 * MEMORY_SOFT_LIMIT_PERCENT;
+}
+
+/**
+ * Verifica se la memoria allocata, più quella che si sta per allocare, supera la soglia
+ * di adattamento del budget.
+ * @param extra Byte che si intende allocare (0 per controllare solo lo stato attuale).
+ * @return true se c'è un budget e la soglia verrebbe superata.
+ */
+bool memory_pressure(size_t extra) {
+    if (account.budget <= 0) return false;
+    return atomic_load_explicit(&account.live, memory_order_relaxed) + (long)extra > account.soft_limit;
+}
+
+/**
+ * Registra un adattamento applicato per restare entro il budget.
+ * @param kind Tipo di adattamento.
+ * @param bytes Byte liberati (solo per MEMORY_EVICTED_FILE).
+ */
+void note_memory_fallback(MemoryFallback kind, long bytes) {
+    switch (kind) {
+        case MEMORY_EVICTED_FILE:
+            atomic_fetch_add_explicit(&account.evicted_files, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&account.evicted_bytes, bytes, memory_order_relaxed);
+            break;
+        case MEMORY_SKIPPED_PREFETCH:
+            atomic_fetch_add_explicit(&account.skipped_prefetch, 1, memory_order_relaxed);
+            break;
+        case MEMORY_REDUCED_BUFFERS:
+            atomic_fetch_add_explicit(&account.reduced_buffers, 1, memory_order_relaxed);
+            break;
+        case MEMORY_ERRORS_STREAMED:
+            atomic_store_explicit(&account.errors_streamed, true, memory_order_relaxed);
+            break;
+    }
+}
+
+/**
+ * Legge i contatori della memoria.
+ * @param out Destinazione dei contatori.
+ */
+void get_memory_stats(MemoryStats* out) {
+    out->live_bytes = atomic_load_explicit(&account.live, memory_order_relaxed);
+    out->peak_bytes = atomic_load_explicit(&account.peak, memory_order_relaxed);
+    out->budget_bytes = account.budget;
+    out->evicted_files = atomic_load_explicit(&account.evicted_files, memory_order_relaxed);
+    out->evicted_bytes = atomic_load_explicit(&account.evicted_bytes, memory_order_relaxed);
+    out->skipped_prefetch = atomic_load_explicit(&account.skipped_prefetch, memory_order_relaxed);
+    out->reduced_buffers = atomic_load_explicit(&account.reduced_buffers, memory_order_relaxed);
+    out->errors_streamed = atomic_load_explicit(&account.errors_streamed, memory_order_relaxed);
+}
@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "myPreCompiler.h"
+
+// Dimensione indicativa di un chunk (il taglio avviene al primo '\n' successivo)
+#define PARALLEL_CHUNK_SIZE (1024 * 1024)
+// Numero di chunk elaborati per ogni thread in un'ondata (limita la memoria usata)
+#define PARALLEL_CHUNKS_PER_THREAD 4
+// Numero di stati della macchina CommentState
+#define COMMENT_STATE_COUNT 5
+
+// Righe rilevanti per la fase di unione sequenziale
+typedef struct {
+    int line_num;           // Numero di riga nel file
+    size_t src_offset;      // Posizione della riga originale nel chunk (solo direttive #include)
+    int src_len;            // Lunghezza della riga originale (solo direttive #include)
+    size_t out_offset;      // Posizione della riga processata nel buffer di output del chunk
+    int out_len;            // Lunghezza della riga processata
+    int token_first;        // Primo token della riga processata nello stream compatto del chunk
+    int token_end;          // Token successivo all'ultimo della riga processata
+    bool kept;              // true se la riga va analizzata e scritta (non completamente commentata)
+    bool include;           // true se la riga inizia con "#include"
+    bool include_ok;        // true se la direttiva è valida e va espansa
+} LineRecord;
+
+// Porzione del file assegnata a un thread
+typedef struct {
+    SourceBuffer view;                              // Vista sul buffer del file (non posseduta)
+    int line_count;                                 // Righe (secondo la semantica di fgets)
+    unsigned char transition[COMMENT_STATE_COUNT];  // Stato finale per ogni stato iniziale
+    CommentState start_state;                       // Stato iniziale corretto (dopo il prefisso)
+    int first_line_num;                             // Numero della prima riga del chunk
+
+    char* output;                                   // Righe processate e mantenute, concatenate
+    size_t output_size;
+    size_t output_capacity;
+    TokenStream tokens;                             // Token delle righe mantenute (offset relativi a output)
+    LineRecord* records;                            // Righe mantenute e direttive #include
+    int record_count;
+    int record_capacity;
+    int comments_removed;                           // Contributo al contatore dei commenti
+    bool failed;                                    // Errore di allocazione nel worker
+} StripChunk;
+
+// Lavoro condiviso fra i thread di una fase
+typedef struct {
+    StripChunk* chunks;
+    int count;
+    atomic_int next;        // Prossimo chunk da elaborare
+    void (*work)(StripChunk*);
+} ParallelPhase;
+
+// Tabella di transizione della macchina CommentState per classe di carattere:
+// 0 = altro, 1 = '/', 2 = '*', 3 = '\n'
+static const unsigned char comment_transition_table[COMMENT_STATE_COUNT][4] = {
+    /* CODE          */ { CODE,          SLASH,        CODE,          CODE },
+    /* SLASH         */ { CODE,          LINE_COMMENT, BLOCK_COMMENT, CODE },
+    /* BLOCK_COMMENT */ { BLOCK_COMMENT, BLOCK_COMMENT, STAR_IN_BLOCK, BLOCK_COMMENT },
+    /* LINE_COMMENT  */ { LINE_COMMENT,  LINE_COMMENT, LINE_COMMENT,  CODE },
+    /* STAR_IN_BLOCK */ { BLOCK_COMMENT, CODE,         STAR_IN_BLOCK, BLOCK_COMMENT },
+};
+
+/**
+ * Classifica un carattere per la tabella di transizione.
+ */
+static inline int comment_char_class(char c) {
+    switch (c) {
+        case '/': return 1;
+        case '*': return 2;
+        case '\n': return 3;
+        default: return 0;
+    }
+}
+
+/**
+ * Verifica, senza stampare avvisi, se una riga che inizia con "#include" contiene un nome
+ * di file valido tra doppi apici (stessa condizione di successo di extract_include_filename).
+ */
+static bool is_valid_include_line(const char* trimmed_line) {
+    const char* start_quote = strchr(trimmed_line, '"');
+    if (!start_quote) return false;
+    const char* end_quote = strchr(start_quote + 1, '"');
+    return end_quote && end_quote > start_quote + 1;
+}
+
+/**
+ * Restituisce l'inizio della riga senza gli spazi iniziali e indica se è una direttiva #include.
+ */
+static bool is_include_line(const char* line, const char** trimmed) {
+    const char* p = line;
+    while (isspace((unsigned char)*p)) p++;
+    *trimmed = p;
+    return strncmp(p, "#include", 8) == 0;
+}
+
+// =====================
+// Fase 1: funzione di transizione di ciascun chunk
+// =====================
+
+/**
+ * Esegue la macchina CommentState sul chunk a partire da tutti gli stati iniziali
+ * contemporaneamente, ottenendo la funzione di transizione del chunk. Quando le
+ * esecuzioni convergono nello stesso stato si prosegue con una sola simulazione.
+ * Le direttive #include valide vengono saltate come nel percorso sequenziale.
+ */
+static void compute_chunk_transition(StripChunk* chunk) {
+    unsigned char states[COMMENT_STATE_COUNT];
+    for (int s = 0; s < COMMENT_STATE_COUNT; ++s) states[s] = (unsigned char)s;
+    bool converged = false;
+
+    char line[MAX_LINE_LEN];
+    size_t pos = 0;
+    int lines = 0;
+    while (read_buffer_line(&chunk->view, &pos, line, sizeof(line)) != NULL) {
+        lines++;
+        const char* trimmed;
+        if (is_include_line(line, &trimmed) && is_valid_include_line(trimmed)) {
+            continue;
+        }
+
+        if (converged) {
+            unsigned char state = states[0];
+            for (const char* p = line; *p; ++p) {
+                state = comment_transition_table[state][comment_char_class(*p)];
+            }
+            states[0] = state;
+        } else {
+            for (const char* p = line; *p; ++p) {
+                int cls = comment_char_class(*p);
+                for (int s = 0; s < COMMENT_STATE_COUNT; ++s) {
+                    states[s] = comment_transition_table[states[s]][cls];
+                }
+            }
+            converged = true;
+            for (int s = 1; s < COMMENT_STATE_COUNT; ++s) {
+                if (states[s] != states[0]) converged = false;
+            }
+        }
+    }
+
+    for (int s = 0; s < COMMENT_STATE_COUNT; ++s) {
+        chunk->transition[s] = converged ? states[0] : states[s];
+    }
+    chunk->line_count = lines;
+}
+
+// =====================
+// Fase 2: rimozione dei commenti dallo stato iniziale corretto
+// =====================
+
+/**
+ * Aggiunge un record di riga al chunk.
+ */
+static bool add_line_record(StripChunk* chunk, const LineRecord* record) {
+    if (chunk->record_count >= chunk->record_capacity) {
+        int new_capacity = (chunk->record_capacity == 0) ? 1024 : chunk->record_capacity * 2;
+        LineRecord* new_records = mem_realloc(chunk->records, new_capacity * sizeof(LineRecord));
+        if (!new_records) return false;
+        chunk->records = new_records;
+        chunk->record_capacity = new_capacity;
+    }
+    chunk->records[chunk->record_count++] = *record;
+    return true;
+}
+
+/**
+ * Rimuove i commenti dal chunk partendo dallo stato iniziale determinato dal prefisso,
+ * usando lo stesso lexer del percorso sequenziale. Le righe mantenute vengono
+ * concatenate nel buffer di output del chunk e i loro token copiati in uno stream
+ * compatto, consumato dall'analisi nella fase di unione.
+ */
+static void strip_chunk(StripChunk* chunk) {
+    chunk->output_capacity = chunk->view.size + 1024;
+    chunk->output = mem_alloc(chunk->output_capacity);
+    if (!chunk->output) {
+        chunk->failed = true;
+        return;
+    }
+
+    Lexer lexer;
+    init_lexer(&lexer, chunk->view.data, chunk->view.size, chunk->start_state);
+    TokenStream window;
+    init_token_stream(&window);
+    int line_num = chunk->first_line_num;
+
+    while (!chunk->failed && lex_window(&lexer, &window)) {
+        int line_first = 0;
+        for (int t = 0; t < window.count; ++t) {
+            unsigned char kind = window.kinds[t];
+            if (TOKEN_KIND(kind) != TOK_EOL) continue;
+            unsigned flags = TOKEN_FLAGS(kind);
+            line_num++;
+            size_t line_start = (size_t)(window.base + window.offsets[t] - chunk->view.data);
+            LineRecord record = { line_num, line_start, (int)window.lengths[t], chunk->output_size, 0, 0, 0, false, false, false };
+
+            if (TOKEN_KIND(window.kinds[line_first]) == TOK_INCLUDE) {
+                record.include = true;
+                record.include_ok = true;
+                if (!add_line_record(chunk, &record)) chunk->failed = true;
+                line_first = t + 1;
+                continue;
+            }
+            record.include = (flags & LINE_BAD_INCLUDE) != 0;
+
+            if (flags & LINE_COUNT_COMMENT) {
+                chunk->comments_removed++;
+            }
+
+            if (!(flags & LINE_BLANK)) {
+                size_t line_tokens = (size_t)(t - line_first);
+                size_t max_len = window.lengths[t] + 1; // Un eventuale '/' sospeso dalla riga precedente
+                if (chunk->output_size + max_len > chunk->output_capacity) {
+                    size_t new_capacity = chunk->output_capacity * 2 + max_len;
+                    char* new_output = mem_realloc(chunk->output, new_capacity);
+                    if (!new_output) {
+                        chunk->failed = true;
+                        break;
+                    }
+                    chunk->output = new_output;
+                    chunk->output_capacity = new_capacity;
+                }
+                if (chunk->tokens.count + (int)line_tokens > chunk->tokens.capacity &&
+                    !reserve_token_stream(&chunk->tokens, chunk->tokens.capacity * 2 + (int)line_tokens + 1024)) {
+                    chunk->failed = true;
+                    break;
+                }
+                record.token_first = chunk->tokens.count;
+                size_t processed_len = copy_kept_tokens(&window, line_first, t, chunk->output, chunk->output_size, &chunk->tokens);
+                record.token_end = chunk->tokens.count;
+                chunk->output_size += processed_len;
+                record.out_len = (int)processed_len;
+                record.kept = true;
+            }
+
+            if (record.kept || record.include) {
+                if (!add_line_record(chunk, &record)) chunk->failed = true;
+            }
+            line_first = t + 1;
+        }
+    }
+    free_token_stream(&window);
+    chunk->tokens.base = chunk->output;
+}
+
+// =====================
+// Esecuzione parallela delle fasi
+// =====================
+
+/**
+ * Thread di lavoro: preleva chunk dalla fase finché ce ne sono.
+ */
+static void* phase_worker(void* arg) {
+    ParallelPhase* phase = arg;
+    int index;
+    while ((index = atomic_fetch_add(&phase->next, 1)) < phase->count) {
+        phase->work(&phase->chunks[index]);
+    }
+    return NULL;
+}
+
+/**
+ * Esegue una fase su tutti i chunk con il numero di thread indicato.
+ * Il thread chiamante partecipa al lavoro; se la creazione di un thread fallisce
+ * il lavoro residuo viene comunque completato dai thread disponibili.
+ */
+static void run_phase(StripChunk* chunks, int count, void (*work)(StripChunk*), int threads) {
+    ParallelPhase phase;
+    phase.chunks = chunks;
+    phase.count = count;
+    atomic_init(&phase.next, 0);
+    phase.work = work;
+
+    pthread_t* ids = malloc(sizeof(pthread_t) * (size_t)threads);
+    int started = 0;
+    if (ids) {
+        for (; started < threads - 1; ++started) {
+            if (pthread_create(&ids[started], NULL, phase_worker, &phase) != 0) break;
+        }
+    }
+    phase_worker(&phase);
+    for (int i = 0; i < started; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+    free(ids);
+}
+
+// =====================
+// Fase 3: unione sequenziale
+// =====================
+
+/**
+ * Processa un file già caricato rimuovendo i commenti in parallelo. Il file viene diviso
+ * in chunk terminati da '\n'; per ogni chunk si calcola in parallelo la funzione di
+ * transizione della macchina CommentState da tutti gli stati iniziali, un prefisso sui
+ * chunk determina lo stato iniziale corretto di ciascuno e una seconda fase parallela
+ * ne rimuove i commenti. L'unione finale, sequenziale, espande gli #include, esegue
+ * l'analisi delle dichiarazioni e scrive l'output: il risultato è identico byte per byte
+ * a quello di process_c_file. I chunk sono elaborati a ondate per limitare la memoria;
+ * vicino al budget di memoria un'ondata contiene un solo chunk per thread.
+ * @param input_filename Nome del file (per messaggi e statistiche).
+ * @param in_buf Contenuto del file.
+ * @param out_stream Stream di output.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param depth Livello di profondità di inclusione.
+ * @param threads Numero di thread da usare.
+ * @return 0 in caso di successo, -1 in caso di errore grave.
+ */
+int process_buffer_parallel(const char* input_filename, const SourceBuffer* in_buf, FILE* out_stream, ProcessingStats* stats, int depth, int threads) {
+    int wave_size = threads * PARALLEL_CHUNKS_PER_THREAD;
+    StripChunk* chunks = malloc(sizeof(StripChunk) * (size_t)wave_size);
+    if (!chunks) {
+        perror("malloc fallito in process_buffer_parallel");
+        return -1;
+    }
+
+    IncludeGraph* include_graph = stats->options ? stats->options->include_graph : NULL;
+    const bool minify = stats->options && stats->options->minify;
+    CommentState carried_state = CODE;     // Stato all'inizio dell'ondata
+    int carried_line = 0;
+    size_t offset = 0;
+    int result = 0;
+
+    while (offset < in_buf->size && result == 0) {
+        // Un chunk in elaborazione occupa qualche volta la sua dimensione (output, token e record)
+        int wave_chunks = wave_size;
+        if (memory_pressure((size_t)wave_size * PARALLEL_CHUNK_SIZE * 4)) {
+            wave_chunks = threads;
+            note_memory_fallback(MEMORY_REDUCED_BUFFERS, 0);
+        }
+
+        // Suddivisione dell'ondata in chunk che terminano con '\n'
+        int count = 0;
+        while (count < wave_chunks && offset < in_buf->size) {
+            size_t end = offset + PARALLEL_CHUNK_SIZE;
+            if (end >= in_buf->size) {
+                end = in_buf->size;
+            } else {
+                const char* newline = memchr(in_buf->data + end, '\n', in_buf->size - end);
+                end = newline ? (size_t)(newline - in_buf->data) + 1 : in_buf->size;
+            }
+            memset(&chunks[count], 0, sizeof(StripChunk));
+            chunks[count].view.data = in_buf->data + offset;
+            chunks[count].view.size = end - offset;
+            chunks[count].view.owned = false;
+            offset = end;
+            count++;
+        }
+
+        // Fase 1 (parallela): funzioni di transizione
+        run_phase(chunks, count, compute_chunk_transition, threads);
+
+        // Prefisso (sequenziale, O(numero di chunk)): stato e riga iniziale di ogni chunk
+        for (int c = 0; c < count; ++c) {
+            chunks[c].start_state = carried_state;
+            chunks[c].first_line_num = carried_line;
+            carried_state = (CommentState)chunks[c].transition[carried_state];
+            carried_line += chunks[c].line_count;
+        }
+
+        // Fase 2 (parallela): rimozione dei commenti
+        run_phase(chunks, count, strip_chunk, threads);
+
+        // Fase 3 (sequenziale): include, analisi e scrittura nell'ordine originale
+        for (int c = 0; c < count && result == 0; ++c) {
+            StripChunk* chunk = &chunks[c];
+            if (chunk->failed) {
+                fprintf(stderr, "Errore: memoria insufficiente durante la rimozione parallela dei commenti in '%s'.\n", input_filename);
+                result = -1;
+                break;
+            }
+            stats->comments_removed += chunk->comments_removed;
+
+            size_t written = 0; // Byte del buffer di output del chunk già scritti
+            for (int r = 0; r < chunk->record_count && result == 0; ++r) {
+                LineRecord* record = &chunk->records[r];
+
+                if (record->include_ok && !minify) {
+                    // Scrive le righe che precedono la direttiva prima di espanderla
+                    if (record->out_offset > written) {
+                        size_t pending = record->out_offset - written;
+                        if (fwrite(chunk->output + written, 1, pending, out_stream) != pending) {
+                            perror("Errore durante la scrittura sul file di output");
+                            result = -1;
+                            break;
+                        }
+                        written = record->out_offset;
+                    }
+                }
+
+                if (record->include) {
+                    // Ricostruisce la riga originale: estrazione del nome e avvisi come in process_c_file
+                    char line[MAX_LINE_LEN];
+                    memcpy(line, chunk->view.data + record->src_offset, (size_t)record->src_len);
+                    line[record->src_len] = '\0';
+                    const char* trimmed;
+                    is_include_line(line, &trimmed);
+
+                    char* included_filename = extract_include_filename(trimmed);
+                    if (included_filename) {
+                        stats->includes_processed++;
+                        if (include_graph) include_graph->next_include_line = record->line_num;
+                        int include_result = process_c_file(included_filename, out_stream, stats, depth + 1);
+                        free(included_filename);
+
+                        if (include_result != 0) {
+                            fprintf(stderr, "...Errore originato durante l'inclusione richiesta in '%s' riga %d.\n", input_filename, record->line_num);
+                            result = -1;
+                        }
+                        continue;
+                    } else {
+                        fprintf(stderr, "Attenzione: Formato #include non valido o errore in '%s' riga %d. Riga trattata come codice.\n", input_filename, record->line_num);
+                    }
+                }
+
+                if (record->kept) {
+                    analyze_declaration_tokens(&chunk->tokens, record->token_first, record->token_end, record->line_num, input_filename, stats);
+                    if (minify) {
+                        // Righe compattate una per volta invece che a blocchi
+                        if (!write_output_line(stats, out_stream, chunk->output + record->out_offset, (size_t)record->out_len, input_filename, record->line_num)) {
+                            perror("Errore durante la scrittura sul file di output");
+                            result = -1;
+                        }
+                    } else {
+                        stats->output_lines++;
+                        stats->output_size_bytes += record->out_len;
+                    }
+                }
+            }
+
+            if (result == 0 && !minify && chunk->output_size > written) {
+                size_t pending = chunk->output_size - written;
+                if (fwrite(chunk->output + written, 1, pending, out_stream) != pending) {
+                    perror("Errore durante la scrittura sul file di output");
+                    result = -1;
+                }
+            }
+            progress_advance(chunk->view.size, chunk->line_count);
+        }
+
+        for (int c = 0; c < count; ++c) {
+            mem_free(chunks[c].output);
+            mem_free(chunks[c].records);
+            free_token_stream(&chunks[c].tokens);
+        }
+    }
+
+    free(chunks);
+
+    if (result == 0 && depth == 0 && (carried_state == BLOCK_COMMENT || carried_state == STAR_IN_BLOCK)) {
+        fprintf(stderr, "Attenzione: Commento multi-riga /* ... */ non chiuso alla fine del file '%s'.\n", input_filename);
+    }
+    return result;
+}
@@ -0,0 +1,545 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "myPreCompiler.h"
+
+// Allineamento delle sezioni nel file
+#define PCH_ALIGN 8
+
+// Parametri dell'hash FNV-1a a 64 bit del contenuto delle dipendenze
+#define PCH_FNV_OFFSET 14695981039346656037ULL
+#define PCH_FNV_PRIME 1099511628211ULL
+
+/**
+ * Pool delle stringhe in costruzione (array dinamico di caratteri).
+ */
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} PchStringPool;
+
+/**
+ * Calcola l'hash FNV-1a a 64 bit di un buffer.
+ */
+static uint64_t pch_hash(const char* data, size_t size) {
+    uint64_t h = PCH_FNV_OFFSET;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= PCH_FNV_PRIME;
+    }
+    return h;
+}
+
+/**
+ * Costruisce il nome del file precompilato di un header (nome + PCH_SUFFIX).
+ * @return Stringa allocata dinamicamente, o NULL in caso di errore.
+ */
+static char* pch_path(const char* filename) {
+    size_t len = strlen(filename);
+    char* path = malloc(len + sizeof(PCH_SUFFIX));
+    if (!path) return NULL;
+    memcpy(path, filename, len);
+    memcpy(path + len, PCH_SUFFIX, sizeof(PCH_SUFFIX));
+    return path;
+}
+
+// =====================
+// Scrittura
+// =====================
+
+/**
+ * Aggiunge una stringa al pool.
+ * @param offset Posizione della stringa nel pool.
+ * @return true in caso di successo, false se la memoria o gli offset a 32 bit sono esauriti.
+ */
+static bool pool_add(PchStringPool* pool, const char* str, uint32_t* offset) {
+    size_t len = strlen(str) + 1;
+    if (pool->size + len > UINT32_MAX) return false;
+    if (pool->size + len > pool->capacity) {
+        size_t new_capacity = (pool->capacity == 0) ? 4096 : pool->capacity * 2;
+        while (new_capacity < pool->size + len) new_capacity *= 2;
+        char* new_data = realloc(pool->data, new_capacity);
+        if (!new_data) return false;
+        pool->data = new_data;
+        pool->capacity = new_capacity;
+    }
+    memcpy(pool->data + pool->size, str, len);
+    *offset = (uint32_t)pool->size;
+    pool->size += len;
+    return true;
+}
+
+/**
+ * Ordina i simboli esportati per riga di dichiarazione.
+ */
+static int compare_symbols(const void* a, const void* b) {
+    const Symbol* sa = *(const Symbol* const*)a;
+    const Symbol* sb = *(const Symbol* const*)b;
+    return (sa->line > sb->line) - (sa->line < sb->line);
+}
+
+/**
+ * Assegna a una sezione la posizione (allineata) e il numero di elementi.
+ * @param pos Dimensione dell'immagine fino alla sezione precedente (aggiornata).
+ */
+static void place_section(size_t* pos, PchSection* section, size_t elem_size, size_t count) {
+    *pos += (PCH_ALIGN - (*pos % PCH_ALIGN)) % PCH_ALIGN;
+    section->offset = (uint64_t)*pos;
+    section->count = count;
+    *pos += elem_size * count;
+}
+
+/**
+ * Scrive una sezione già posizionata, riempiendo con zeri lo spazio che la precede.
+ * @param pos Posizione corrente nello stream (aggiornata).
+ */
+static bool write_section(FILE* fp, size_t* pos, const PchSection* section, const void* data, size_t elem_size) {
+    static const char zeros[PCH_ALIGN] = {0};
+    size_t padding = (size_t)section->offset - *pos;
+    if (padding > 0 && fwrite(zeros, 1, padding, fp) != padding) return false;
+    if (section->count > 0 && fwrite(data, elem_size, (size_t)section->count, fp) != section->count) return false;
+    *pos = (size_t)section->offset + elem_size * (size_t)section->count;
+    return true;
+}
+
+/**
+ * Cerca la posizione di una dipendenza già registrata.
+ * @return Indice della dipendenza, -1 se assente.
+ */
+static int find_dependency(const PchDependency* deps, int count, const PchStringPool* pool, const char* name) {
+    for (int i = 0; i < count; ++i) {
+        if (strcmp(pool->data + deps[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * Elabora un header con statistiche e grafo delle inclusioni dedicati e ne costruisce in
+ * memoria la versione precompilata: output prodotto, dipendenze con dimensione, data di
+ * modifica e hash del contenuto, statistiche dei file, errori e simboli dello scope del file.
+ * @param input_filename Header da precompilare.
+ * @param base_options Opzioni di elaborazione (cache e thread).
+ * @param verbose Se true, stampa le statistiche dell'elaborazione.
+ * @param image Immagine prodotta (allocata dinamicamente, da liberare con free).
+ * @param image_size Dimensione dell'immagine in byte.
+ * @return 0 in caso di successo, 1 se l'header termina all'interno di una dichiarazione o
+ *         di un blocco (non precompilabile), -1 in caso di errore.
+ */
+int build_precompiled_image(const char* input_filename, const ProcessingOptions* base_options, bool verbose, char** image, size_t* image_size) {
+    *image = NULL;
+    *image_size = 0;
+    char* output = NULL;
+    size_t output_size = 0;
+    FILE* mem = open_memstream(&output, &output_size);
+    if (!mem) {
+        perror("Errore: open_memstream fallita durante la generazione dell'header precompilato");
+        return -1;
+    }
+
+    IncludeGraph graph;
+    init_include_graph(&graph);
+    ProcessingOptions options = *base_options;
+    options.include_graph = &graph;
+    options.use_pch = false; // I simboli degli header annidati servono completi
+    options.shm_cache = NULL;
+    ProcessingStats stats;
+    init_stats(&stats, verbose);
+    stats.options = &options;
+    configure_error_sink(&stats, NULL, NULL, false, -1); // Ogni occorrenza, riapplicata all'uso
+
+    int result = process_c_file(input_filename, mem, &stats, 0);
+    if (fclose(mem) != 0) {
+        perror("Errore durante la scrittura dell'output in memoria");
+        result = -1;
+    }
+    if (result == 0 && !declaration_analyzer_at_top_level(&stats.analyzer)) {
+        result = 1;
+    }
+
+    PchStringPool pool = { NULL, 0, 0 };
+    PchDependency* deps = NULL;
+    int dep_count = 0;
+    PchFileStats* files = NULL;
+    int file_count = 0;
+    PchError* errors = NULL;
+    PchSymbol* symbols = NULL;
+    const Symbol** sorted = NULL;
+    int symbol_count = 0;
+    uint32_t max_depth = 0;
+    FILE* fp = NULL;
+
+    // Raccolta dei record (result = -2 per esaurimento della memoria).
+    // Dipendenze: un record per file distinto, nell'ordine di visita (il primo è l'header)
+    if (result == 0) {
+        deps = malloc((size_t)(graph.count > 0 ? graph.count : 1) * sizeof(PchDependency));
+        if (!deps) result = -2;
+    }
+    for (int i = 0; result == 0 && i < graph.count; ++i) {
+        const IncludeNode* node = &graph.nodes[i];
+        if ((uint32_t)node->depth > max_depth) max_depth = (uint32_t)node->depth;
+        if (find_dependency(deps, dep_count, &pool, node->filename) >= 0) continue;
+
+        PchDependency* dep = &deps[dep_count];
+        memset(dep, 0, sizeof(*dep));
+        struct stat st;
+        SourceBuffer buf;
+        if (stat(node->filename, &st) != 0) {
+            fprintf(stderr, "Errore: Impossibile leggere i dati del file '%s': %s\n", node->filename, strerror(errno));
+            result = -1;
+        } else if (read_source_file(options.file_cache, node->filename, &buf) != 0) {
+            fprintf(stderr, "Errore: Impossibile rileggere il file '%s' per l'header precompilato.\n", node->filename);
+            result = -1;
+        } else {
+            dep->size = (int64_t)st.st_size;
+            dep->mtime_sec = (int64_t)st.st_mtim.tv_sec;
+            dep->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+            dep->hash = pch_hash(buf.data, buf.size);
+            release_source_buffer(&buf);
+            if (!pool_add(&pool, node->filename, &dep->name)) result = -2;
+            else dep_count++;
+        }
+    }
+
+    // Statistiche dei file: l'header e poi i file inclusi, nell'ordine di registrazione
+    if (result == 0) {
+        files = malloc((size_t)(stats.includes_processed + 1) * sizeof(PchFileStats));
+        if (!files) result = -2;
+    }
+    for (int i = -1; result == 0 && i < stats.includes_processed; ++i) {
+        const FileStats* fs = (i < 0) ? &stats.input_file_stats : &stats.included_files_stats[i];
+        PchFileStats* rec = &files[file_count];
+        memset(rec, 0, sizeof(*rec));
+        rec->lines = fs->lines;
+        rec->size_bytes = fs->size_bytes;
+        rec->compressed_bytes = fs->compressed_bytes;
+        if (!pool_add(&pool, fs->filename ? fs->filename : input_filename, &rec->name)) result = -2;
+        else file_count++;
+    }
+
+    // Errori, nell'ordine di rilevamento
+    if (result == 0 && stats.errors_retained > 0) {
+        errors = calloc((size_t)stats.errors_retained, sizeof(PchError));
+        if (!errors) result = -2;
+    }
+    for (int i = 0; result == 0 && i < stats.errors_retained; ++i) {
+        const IdentifierError* err = &stats.errors[i];
+        errors[i].line = err->line_number;
+        errors[i].kind = (int32_t)err->kind;
+        if (!pool_add(&pool, err->filename ? err->filename : "", &errors[i].filename) ||
+            !pool_add(&pool, err->identifier_name ? err->identifier_name : "", &errors[i].identifier)) {
+            result = -2;
+        }
+    }
+
+    // Simboli dello scope del file, ordinati per riga; il file di origine viene dal grafo
+    if (result == 0) {
+        const Scope* file_scope = &stats.analyzer.scopes[0];
+        sorted = malloc((size_t)(file_scope->count > 0 ? file_scope->count : 1) * sizeof(Symbol*));
+        symbols = calloc((size_t)(file_scope->count > 0 ? file_scope->count : 1), sizeof(PchSymbol));
+        if (!sorted || !symbols) result = -2;
+        for (const Symbol* sym = file_scope->symbols; result == 0 && sym; sym = sym->scope_next) {
+            sorted[symbol_count++] = sym;
+        }
+        if (result == 0) qsort(sorted, (size_t)symbol_count, sizeof(Symbol*), compare_symbols);
+    }
+    for (int i = 0; result == 0 && i < symbol_count; ++i) {
+        const Symbol* sym = sorted[i];
+        const char* origin = (sym->origin >= 0 && sym->origin < graph.count) ? graph.nodes[sym->origin].filename : input_filename;
+        int dep = find_dependency(deps, dep_count, &pool, origin);
+        symbols[i].filename = deps[dep >= 0 ? dep : 0].name;
+        symbols[i].line = sym->line;
+        symbols[i].kind = sym->kind;
+        symbols[i].defined = sym->defined;
+        if (!pool_add(&pool, sym->name, &symbols[i].name)) result = -2;
+    }
+    if (result == -2) {
+        fprintf(stderr, "Errore: Memoria insufficiente per precompilare il file '%s'.\n", input_filename);
+        result = -1;
+    }
+
+    // Scrittura: posizioni delle sezioni, intestazione e sezioni in un buffer in memoria
+    if (result == 0) {
+        fp = open_memstream(image, image_size);
+        if (!fp) {
+            perror("Errore: open_memstream fallita durante la generazione dell'header precompilato");
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        PchHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, PCH_MAGIC, sizeof(header.magic));
+        header.version = PCH_VERSION;
+        header.byte_order = PCH_BYTE_ORDER;
+        header.header_size = sizeof(PchHeader);
+        header.max_depth = max_depth;
+        header.vars_checked = stats.vars_checked;
+        header.comments_removed = stats.comments_removed;
+        header.output_lines = stats.output_lines;
+
+        size_t pos = sizeof(header);
+        place_section(&pos, &header.output, 1, output_size);
+        place_section(&pos, &header.strings, 1, pool.size);
+        place_section(&pos, &header.deps, sizeof(PchDependency), (size_t)dep_count);
+        place_section(&pos, &header.files, sizeof(PchFileStats), (size_t)file_count);
+        place_section(&pos, &header.errors, sizeof(PchError), (size_t)stats.errors_retained);
+        place_section(&pos, &header.symbols, sizeof(PchSymbol), (size_t)symbol_count);
+
+        pos = sizeof(header);
+        bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                  write_section(fp, &pos, &header.output, output, 1) &&
+                  write_section(fp, &pos, &header.strings, pool.data, 1) &&
+                  write_section(fp, &pos, &header.deps, deps, sizeof(PchDependency)) &&
+                  write_section(fp, &pos, &header.files, files, sizeof(PchFileStats)) &&
+                  write_section(fp, &pos, &header.errors, errors, sizeof(PchError)) &&
+                  write_section(fp, &pos, &header.symbols, symbols, sizeof(PchSymbol));
+        if (fclose(fp) != 0) ok = false;
+        if (!ok) {
+            perror("Errore durante la scrittura dell'header precompilato in memoria");
+            result = -1;
+        }
+    }
+    if (result != 0) {
+        free(*image);
+        *image = NULL;
+        *image_size = 0;
+    }
+
+    if (verbose) {
+        print_stats(&stats, stderr);
+    }
+
+    free(sorted);
+    free(symbols);
+    free(errors);
+    free(files);
+    free(deps);
+    free(pool.data);
+    free(output);
+    free_stats(&stats);
+    free_include_graph(&graph);
+    return result;
+}
+
+/**
+ * Elabora un header e ne scrive la versione precompilata. Il file viene scritto con un
+ * nome temporaneo e poi rinominato.
+ * @param input_filename Header da precompilare.
+ * @param pch_filename File .pch da scrivere.
+ * @param base_options Opzioni di elaborazione (cache e thread).
+ * @param verbose Se true, stampa le statistiche dell'elaborazione.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int emit_precompiled_header(const char* input_filename, const char* pch_filename, const ProcessingOptions* base_options, bool verbose) {
+    char* image = NULL;
+    size_t image_size = 0;
+    int result = build_precompiled_image(input_filename, base_options, verbose, &image, &image_size);
+    if (result == 1) {
+        fprintf(stderr, "Errore: Il file '%s' termina all'interno di una dichiarazione o di un blocco: impossibile precompilarlo.\n", input_filename);
+        return -1;
+    }
+    if (result != 0) return -1;
+
+    char* tmp_filename = malloc(strlen(pch_filename) + 5);
+    FILE* fp = NULL;
+    if (tmp_filename) {
+        sprintf(tmp_filename, "%s.tmp", pch_filename);
+        fp = fopen(tmp_filename, "wb");
+    }
+    if (!fp) {
+        fprintf(stderr, "Errore: Impossibile creare il file '%s': %s\n", tmp_filename ? tmp_filename : pch_filename, strerror(errno));
+        result = -1;
+    } else {
+        bool ok = fwrite(image, 1, image_size, fp) == image_size;
+        if (fclose(fp) != 0) ok = false;
+        if (!ok) {
+            fprintf(stderr, "Errore durante la scrittura del file '%s': %s\n", tmp_filename, strerror(errno));
+            result = -1;
+        } else if (rename(tmp_filename, pch_filename) != 0) {
+            fprintf(stderr, "Errore: Impossibile rinominare '%s' in '%s': %s\n", tmp_filename, pch_filename, strerror(errno));
+            result = -1;
+        }
+        if (result != 0) unlink(tmp_filename);
+    }
+    if (result == 0) {
+        fprintf(stderr, "Header precompilato scritto in: %s\n", pch_filename);
+    }
+    free(tmp_filename);
+    free(image);
+    return result;
+}
+
+// =====================
+// Lettura
+// =====================
+
+/**
+ * Verifica che una sezione sia allineata e contenuta nel file.
+ */
+static bool section_valid(const PchSection* section, size_t elem_size, size_t file_size) {
+    if (section->offset % PCH_ALIGN != 0 || section->offset > file_size) return false;
+    return section->count <= (file_size - section->offset) / elem_size;
+}
+
+/**
+ * Verifica intestazione, sezioni e offset delle stringhe di un file .pch mappato.
+ * @return true se il file è ben formato.
+ */
+static bool pch_valid(const char* base, size_t size) {
+    if (size < sizeof(PchHeader)) return false;
+    const PchHeader* h = (const PchHeader*)base;
+    if (memcmp(h->magic, PCH_MAGIC, sizeof(h->magic)) != 0 || h->version != PCH_VERSION ||
+        h->byte_order != PCH_BYTE_ORDER || h->header_size != sizeof(PchHeader)) {
+        return false;
+    }
+    if (!section_valid(&h->output, 1, size) || !section_valid(&h->strings, 1, size) ||
+        !section_valid(&h->deps, sizeof(PchDependency), size) || !section_valid(&h->files, sizeof(PchFileStats), size) ||
+        !section_valid(&h->errors, sizeof(PchError), size) || !section_valid(&h->symbols, sizeof(PchSymbol), size)) {
+        return false;
+    }
+    // Il pool termina con '\0': ogni offset interno individua una stringa terminata
+    uint64_t pool_size = h->strings.count;
+    if (pool_size == 0 || base[h->strings.offset + pool_size - 1] != '\0' || h->deps.count == 0) return false;
+
+    const PchDependency* deps = (const PchDependency*)(base + h->deps.offset);
+    for (uint64_t i = 0; i < h->deps.count; ++i) {
+        if (deps[i].name >= pool_size) return false;
+    }
+    const PchFileStats* files = (const PchFileStats*)(base + h->files.offset);
+    for (uint64_t i = 0; i < h->files.count; ++i) {
+        if (files[i].name >= pool_size) return false;
+    }
+    const PchError* errors = (const PchError*)(base + h->errors.offset);
+    for (uint64_t i = 0; i < h->errors.count; ++i) {
+        if (errors[i].filename >= pool_size || errors[i].identifier >= pool_size) return false;
+    }
+    const PchSymbol* symbols = (const PchSymbol*)(base + h->symbols.offset);
+    for (uint64_t i = 0; i < h->symbols.count; ++i) {
+        if (symbols[i].name >= pool_size || symbols[i].filename >= pool_size) return false;
+    }
+    return h->files.count > 0 && h->files.count <= INT32_MAX && h->errors.count <= INT32_MAX;
+}
+
+/**
+ * Verifica che una dipendenza non sia cambiata: stessa dimensione e stessa data di
+ * modifica, oppure (data diversa) stesso hash del contenuto.
+ */
+static bool dependency_fresh(const char* name, const PchDependency* dep, FileCache* cache) {
+    struct stat st;
+    if (stat(name, &st) != 0 || (int64_t)st.st_size != dep->size) return false;
+    if ((int64_t)st.st_mtim.tv_sec == dep->mtime_sec && (int64_t)st.st_mtim.tv_nsec == dep->mtime_nsec) return true;
+
+    SourceBuffer buf;
+    if (read_source_file(cache, name, &buf) != 0) return false;
+    size_t disk_size = buf.compressed_size ? buf.compressed_size : buf.size;
+    bool same = disk_size == (size_t)dep->size && pch_hash(buf.data, buf.size) == dep->hash;
+    release_source_buffer(&buf);
+    return same;
+}
+
+/**
+ * Indica se l'output di un header può essere sostituito da un'immagine precompilata:
+ * elaborazione completa senza grafo delle inclusioni né minificazione, con l'analisi
+ * nello stesso stato dell'inizio di un file (scope del file, inizio di un'istruzione).
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @return true se l'immagine può essere applicata.
+ */
+bool precompiled_replay_allowed(const ProcessingStats* stats) {
+    const ProcessingOptions* options = stats->options;
+    if (!options || options->include_graph || options->stages != STAGE_ALL || options->minify) return false;
+    return declaration_analyzer_at_top_level(&stats->analyzer);
+}
+
+/**
+ * Verifica un'immagine precompilata (formato .pch) e, se è valida, riferita al file
+ * indicato e con tutte le dipendenze aggiornate, ne scrive l'output e ne applica
+ * statistiche, errori e simboli, senza leggere né analizzare l'header.
+ * Il chiamante ha già contato l'inclusione e verificato precompiled_replay_allowed.
+ * @param base Immagine in memoria.
+ * @param size Dimensione dell'immagine in byte.
+ * @param filename Nome del file incluso.
+ * @param out_stream Stream di output.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param depth Profondità di inclusione del file.
+ * @return 1 se l'immagine è stata applicata, 0 se non valida o non aggiornata,
+ *         -1 in caso di errore di scrittura.
+ */
+int apply_precompiled_image(const char* base, size_t size, const char* filename, FILE* out_stream, ProcessingStats* stats, int depth) {
+    if (!pch_valid(base, size)) return 0;
+    const PchHeader* h = (const PchHeader*)base;
+    const char* strings = base + h->strings.offset;
+    const PchDependency* deps = (const PchDependency*)(base + h->deps.offset);
+    bool fresh = strcmp(strings + deps[0].name, filename) == 0 &&
+                 (uint64_t)depth + h->max_depth <= MAX_INCLUDE_DEPTH;
+    for (uint64_t i = 0; fresh && i < h->deps.count; ++i) {
+        fresh = dependency_fresh(strings + deps[i].name, &deps[i], stats->options->file_cache);
+    }
+    if (!fresh) return 0;
+
+    if (h->output.count > 0 && fwrite(base + h->output.offset, 1, h->output.count, out_stream) != h->output.count) {
+        perror("Errore durante la scrittura sul file di output");
+        return -1;
+    }
+    const PchFileStats* files = (const PchFileStats*)(base + h->files.offset);
+    add_included_file_stats(stats, filename, (long)files[0].size_bytes, (long)files[0].compressed_bytes, files[0].lines);
+    for (uint64_t i = 1; i < h->files.count; ++i) {
+        stats->includes_processed++;
+        add_included_file_stats(stats, strings + files[i].name, (long)files[i].size_bytes, (long)files[i].compressed_bytes, files[i].lines);
+    }
+    const PchError* errors = (const PchError*)(base + h->errors.offset);
+    for (uint64_t i = 0; i < h->errors.count; ++i) {
+        add_identifier_error(stats, strings + errors[i].filename, errors[i].line, strings + errors[i].identifier, (IdentifierErrorKind)errors[i].kind);
+    }
+    const PchSymbol* symbols = (const PchSymbol*)(base + h->symbols.offset);
+    for (uint64_t i = 0; i < h->symbols.count; ++i) {
+        import_declaration_symbol(stats, strings + symbols[i].filename, strings + symbols[i].name, symbols[i].line, (SymbolKind)symbols[i].kind, symbols[i].defined != 0);
+    }
+    stats->vars_checked += (int)h->vars_checked;
+    stats->comments_removed += (int)h->comments_removed;
+    stats->output_lines += (int)h->output_lines;
+    stats->output_size_bytes += (long)h->output.count;
+    return 1;
+}
+
+/**
+ * Se accanto al file incluso esiste un .pch valido e aggiornato, lo applica direttamente
+ * dalla mappatura in memoria (vedi apply_precompiled_image).
+ * @param filename Nome del file incluso.
+ * @param out_stream Stream di output.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param depth Profondità di inclusione del file.
+ * @return 1 se il file precompilato è stato usato, 0 se assente o non aggiornato,
+ *         -1 in caso di errore di scrittura.
+ */
+int use_precompiled_header(const char* filename, FILE* out_stream, ProcessingStats* stats, int depth) {
+    if (!stats->options || !stats->options->use_pch || !precompiled_replay_allowed(stats)) return 0;
+
+    char* path = pch_path(filename);
+    if (!path) return 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    free(path);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(PchHeader)) {
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t)st.st_size;
+    char* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+
+    int result = apply_precompiled_image(base, size, filename, out_stream, stats, depth);
+    if (result == 1) stats->pch_loaded++;
+    munmap(base, size);
+    return result;
+}
@@ -0,0 +1,577 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "myPreCompiler.h"
+
+// Dimensione fissa di un chunk scambiato tra due stadi della pipeline
+#define PIPELINE_CHUNK_SIZE (64 * 1024)
+// Numero di chunk in ciascun ring buffer (determina la backpressure)
+#define PIPELINE_RING_SLOTS 8
+// Numero di tentativi di attesa attiva prima di sospendere il thread
+#define PIPELINE_SPIN_LIMIT 64
+
+// Tipi di record trasportati nei chunk
+typedef enum {
+    REC_FILE_BEGIN, // Inizio di un file (payload: nome del file)
+    REC_LINE,       // Riga di codice (payload: contenuto della riga)
+    REC_FILE_END    // Fine di un file
+} RecordType;
+
+// Intestazione di un record, seguita dal payload terminato da '\0' e, per le righe
+// processate, dai token della riga in formato structure-of-arrays (offset, lunghezze, tipi)
+typedef struct {
+    int type;        // RecordType
+    int depth;       // Profondità di inclusione del file
+    int line_num;    // Numero di riga nel file (solo REC_LINE)
+    int length;      // Lunghezza del payload senza il terminatore
+    int token_count; // Numero di token che seguono il payload (0 se assenti)
+} RecordHeader;
+
+// Chunk di dimensione fissa contenente una sequenza di record
+typedef struct {
+    size_t used;                        // Byte occupati in data
+    bool last;                          // true se è l'ultimo chunk dello stream
+    int status;                         // Esito dello stadio produttore (solo sull'ultimo chunk)
+    alignas(RecordHeader) char data[PIPELINE_CHUNK_SIZE];
+} PipelineChunk;
+
+// Ring buffer lock-free a produttore singolo e consumatore singolo
+typedef struct {
+    PipelineChunk slots[PIPELINE_RING_SLOTS];
+    alignas(64) atomic_size_t head;     // Prossimo slot da pubblicare (scritto dal produttore)
+    alignas(64) atomic_size_t tail;     // Prossimo slot da consumare (scritto dal consumatore)
+    alignas(64) atomic_uint events;     // Pubblicazioni e rilasci (parola del futex)
+    atomic_int sleepers;                // Thread sospesi sul futex
+} SpscRing;
+
+// Stato del produttore di uno stadio: chunk in riempimento sul ring di uscita
+typedef struct {
+    SpscRing* ring;
+    PipelineChunk* chunk;
+} ChunkWriter;
+
+// Contesto condiviso fra tutti gli stadi
+typedef struct {
+    const char* input_filename;
+    FILE* out_stream;
+    ProcessingStats* stats;
+    SpscRing* read_ring;        // lettore -> rimozione commenti
+    SpscRing* strip_ring;       // rimozione commenti -> analisi
+    SpscRing* analyze_ring;     // analisi -> scrittura
+    atomic_bool abort;          // Richiesta di interruzione anticipata (errore di scrittura)
+    int reader_status;
+    int writer_status;
+} PipelineContext;
+
+// =====================
+// Ring buffer SPSC
+// =====================
+
+/**
+ * Attende un evento del ring: attesa attiva breve, poi sospensione sul futex finché
+ * l'altro lato non pubblica o rilascia uno slot.
+ * @param seen Valore di events letto prima di verificare la condizione di attesa:
+ *             se nel frattempo è cambiato, il thread non si sospende.
+ */
+static void pipeline_wait(SpscRing* ring, unsigned seen, int* spins) {
+    if (++(*spins) <= PIPELINE_SPIN_LIMIT) return;
+    atomic_fetch_add_explicit(&ring->sleepers, 1, memory_order_seq_cst);
+    syscall(SYS_futex, &ring->events, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+    atomic_fetch_sub_explicit(&ring->sleepers, 1, memory_order_relaxed);
+}
+
+/**
+ * Segnala un evento del ring dopo avere spostato head o tail, risvegliando il thread
+ * sospeso sull'altro lato. La chiamata di sistema avviene solo se qualcuno è sospeso.
+ */
+static void ring_notify(SpscRing* ring) {
+    atomic_fetch_add_explicit(&ring->events, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->sleepers, memory_order_seq_cst) > 0) {
+        syscall(SYS_futex, &ring->events, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+/**
+ * Restituisce lo slot libero successivo del ring, attendendo se il ring è pieno (backpressure).
+ */
+static PipelineChunk* ring_acquire_write(SpscRing* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int spins = 0;
+    for (;;) {
+        unsigned seen = atomic_load_explicit(&ring->events, memory_order_acquire);
+        if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) < PIPELINE_RING_SLOTS) break;
+        pipeline_wait(ring, seen, &spins);
+    }
+    PipelineChunk* chunk = &ring->slots[head % PIPELINE_RING_SLOTS];
+    chunk->used = 0;
+    chunk->last = false;
+    chunk->status = 0;
+    return chunk;
+}
+
+/**
+ * Pubblica lo slot riempito rendendolo visibile al consumatore.
+ */
+static void ring_commit_write(SpscRing* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    ring_notify(ring);
+}
+
+/**
+ * Restituisce il prossimo chunk pubblicato, attendendo se il ring è vuoto.
+ */
+static PipelineChunk* ring_acquire_read(SpscRing* ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int spins = 0;
+    for (;;) {
+        unsigned seen = atomic_load_explicit(&ring->events, memory_order_acquire);
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) != tail) break;
+        pipeline_wait(ring, seen, &spins);
+    }
+    return &ring->slots[tail % PIPELINE_RING_SLOTS];
+}
+
+/**
+ * Restituisce lo slot consumato al produttore.
+ */
+static void ring_release_read(SpscRing* ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    ring_notify(ring);
+}
+
+// =====================
+// Serializzazione dei record
+// =====================
+
+/**
+ * Calcola la posizione degli array dei token rispetto all'inizio del payload (allineata).
+ */
+static size_t record_tokens_offset(int length) {
+    return ((size_t)length + 1 + alignof(uint32_t) - 1) & ~(alignof(uint32_t) - 1);
+}
+
+/**
+ * Calcola lo spazio occupato da un record con payload di lunghezza length e token_count token (allineato).
+ */
+static size_t record_size(int length, int token_count) {
+    size_t size = sizeof(RecordHeader) + (size_t)length + 1;
+    if (token_count > 0) {
+        size = sizeof(RecordHeader) + record_tokens_offset(length) + (size_t)token_count * (2 * sizeof(uint32_t) + 1);
+    }
+    return (size + alignof(RecordHeader) - 1) & ~(alignof(RecordHeader) - 1);
+}
+
+/**
+ * Costruisce una vista (non posseduta) sui token serializzati dopo il payload di un record.
+ */
+static TokenStream record_token_view(const RecordHeader* header) {
+    TokenStream view;
+    init_token_stream(&view);
+    const char* payload = (const char*)(header + 1);
+    char* tokens = (char*)payload + record_tokens_offset(header->length);
+    view.base = payload;
+    view.offsets = (uint32_t*)tokens;
+    view.lengths = view.offsets + header->token_count;
+    view.kinds = (unsigned char*)(view.lengths + header->token_count);
+    view.count = header->token_count;
+    return view;
+}
+
+/**
+ * Accoda un record al chunk corrente; se non c'è spazio pubblica il chunk e ne acquisisce uno nuovo.
+ * Se tokens non è NULL, i suoi token (con offset relativi al payload) seguono il payload.
+ */
+static void emit_record(ChunkWriter* w, RecordType type, int depth, int line_num, const char* payload, int length, const TokenStream* tokens) {
+    int token_count = tokens ? tokens->count : 0;
+    size_t size = record_size(length, token_count);
+    if (w->chunk->used + size > PIPELINE_CHUNK_SIZE) {
+        ring_commit_write(w->ring);
+        w->chunk = ring_acquire_write(w->ring);
+    }
+    RecordHeader* header = (RecordHeader*)(w->chunk->data + w->chunk->used);
+    header->type = type;
+    header->depth = depth;
+    header->line_num = line_num;
+    header->length = length;
+    header->token_count = token_count;
+    char* dest = (char*)(header + 1);
+    if (length > 0) memcpy(dest, payload, (size_t)length);
+    dest[length] = '\0';
+    if (token_count > 0) {
+        TokenStream view = record_token_view(header);
+        memcpy(view.offsets, tokens->offsets, (size_t)token_count * sizeof(uint32_t));
+        memcpy(view.lengths, tokens->lengths, (size_t)token_count * sizeof(uint32_t));
+        memcpy(view.kinds, tokens->kinds, (size_t)token_count);
+    }
+    w->chunk->used += size;
+}
+
+/**
+ * Chiude lo stream di uno stadio pubblicando l'ultimo chunk con l'esito indicato.
+ */
+static void finish_stream(ChunkWriter* w, int status) {
+    w->chunk->last = true;
+    w->chunk->status = status;
+    ring_commit_write(w->ring);
+}
+
+// =====================
+// Stadio 1: lettura ed espansione degli #include
+// =====================
+
+/**
+ * Legge ricorsivamente un file e i suoi #include, emettendo un record per ogni riga.
+ * La gestione degli include e i messaggi di errore coincidono con process_c_file.
+ * @return 0 in caso di successo, -1 in caso di errore grave.
+ */
+static int reader_process_file(PipelineContext* ctx, ChunkWriter* w, const char* input_filename, int depth) {
+    ProcessingStats* stats = ctx->stats;
+
+    if (depth > MAX_INCLUDE_DEPTH) {
+        fprintf(stderr, "Errore: Profondità massima di inclusione (%d) superata per il file '%s'. Possibile inclusione ricorsiva infinita.\n", MAX_INCLUDE_DEPTH, input_filename);
+        return -1;
+    }
+
+    FileCache* file_cache = stats->options ? stats->options->file_cache : NULL;
+    SourceBuffer in_buf;
+    progress_file_begin(input_filename, depth);
+    int read_error = read_source_file(file_cache, input_filename, &in_buf);
+    if (read_error != 0) {
+        fprintf(stderr, "Errore: Impossibile aprire il file di input '%s': %s\n", input_filename, strerror(read_error));
+        progress_file_end(depth);
+        return -1;
+    }
+    register_file_stats(stats, input_filename, &in_buf, depth);
+
+    emit_record(w, REC_FILE_BEGIN, depth, 0, input_filename, (int)strlen(input_filename), NULL);
+
+    char line[MAX_LINE_LEN];
+    size_t read_pos = 0;
+    size_t reported_pos = 0; // Byte già conteggiati nell'avanzamento
+    int current_line_num = 0;
+    while (!atomic_load_explicit(&ctx->abort, memory_order_relaxed) &&
+           read_buffer_line(&in_buf, &read_pos, line, sizeof(line)) != NULL) {
+        current_line_num++;
+        progress_advance(read_pos - reported_pos, 1);
+        reported_pos = read_pos;
+
+        char* trimmed_line_start = line;
+        while (isspace((unsigned char)*trimmed_line_start)) trimmed_line_start++;
+
+        if (strncmp(trimmed_line_start, "#include", 8) == 0) {
+            char* included_filename = extract_include_filename(trimmed_line_start);
+            if (included_filename) {
+                stats->includes_processed++;
+                int include_result = reader_process_file(ctx, w, included_filename, depth + 1);
+                free(included_filename);
+
+                if (include_result != 0) {
+                    fprintf(stderr, "...Errore originato durante l'inclusione richiesta in '%s' riga %d.\n", input_filename, current_line_num);
+                    progress_file_end(depth);
+                    release_source_buffer(&in_buf);
+                    return -1;
+                }
+                continue;
+            } else {
+                fprintf(stderr, "Attenzione: Formato #include non valido o errore in '%s' riga %d. Riga trattata come codice.\n", input_filename, current_line_num);
+            }
+        }
+
+        emit_record(w, REC_LINE, depth, current_line_num, line, (int)strlen(line), NULL);
+    }
+
+    emit_record(w, REC_FILE_END, depth, 0, NULL, 0, NULL);
+    progress_file_end(depth);
+    release_source_buffer(&in_buf);
+    return 0;
+}
+
+/**
+ * Thread dello stadio di lettura.
+ */
+static void* reader_stage(void* arg) {
+    PipelineContext* ctx = arg;
+    ChunkWriter w = { ctx->read_ring, ring_acquire_write(ctx->read_ring) };
+    ctx->reader_status = reader_process_file(ctx, &w, ctx->input_filename, 0);
+    finish_stream(&w, ctx->reader_status);
+    return NULL;
+}
+
+// =====================
+// Stadio 2: rimozione dei commenti
+// =====================
+
+/**
+ * Thread dello stadio di rimozione dei commenti. Mantiene uno stato CommentState
+ * per ogni livello di inclusione e inoltra solo le righe non completamente commentate,
+ * insieme ai token prodotti dal lexer (consumati dallo stadio di analisi).
+ */
+static void* strip_stage(void* arg) {
+    PipelineContext* ctx = arg;
+    ChunkWriter w = { ctx->strip_ring, ring_acquire_write(ctx->strip_ring) };
+    CommentState states[MAX_INCLUDE_DEPTH + 2];
+    char processed_line[MAX_LINE_LEN * 2];
+    Lexer lexer;
+    TokenStream window, line_tokens;
+    init_token_stream(&window);
+    init_token_stream(&line_tokens);
+    int status = 0;
+    bool done = false;
+
+    while (!done) {
+        PipelineChunk* in = ring_acquire_read(ctx->read_ring);
+        size_t pos = 0;
+        while (pos < in->used) {
+            RecordHeader* header = (RecordHeader*)(in->data + pos);
+            const char* payload = (const char*)(header + 1);
+            pos += record_size(header->length, header->token_count);
+
+            switch (header->type) {
+                case REC_FILE_BEGIN:
+                    states[header->depth] = CODE;
+                    emit_record(&w, REC_FILE_BEGIN, header->depth, 0, payload, header->length, NULL);
+                    break;
+                case REC_LINE: {
+                    // Il payload contiene una sola riga: il lexer produce i suoi token e il TOK_EOL finale
+                    init_lexer(&lexer, payload, (size_t)header->length, states[header->depth]);
+                    if (!lex_window(&lexer, &window)) break; // Riga vuota (inizia con '\0')
+                    states[header->depth] = lexer.state;
+                    int eol = window.count - 1;
+                    unsigned flags = TOKEN_FLAGS(window.kinds[eol]);
+                    if (flags & LINE_COUNT_COMMENT) {
+                        ctx->stats->comments_removed++;
+                    }
+                    if (!(flags & LINE_BLANK)) {
+                        line_tokens.count = 0;
+                        if (!reserve_token_stream(&line_tokens, window.count)) {
+                            status = -1;
+                            atomic_store_explicit(&ctx->abort, true, memory_order_relaxed);
+                            break;
+                        }
+                        size_t processed_len = copy_kept_tokens(&window, 0, eol, processed_line, 0, &line_tokens);
+                        emit_record(&w, REC_LINE, header->depth, header->line_num, processed_line, (int)processed_len, &line_tokens);
+                    }
+                    break;
+                }
+                case REC_FILE_END:
+                    if (header->depth == 0 && (states[0] == BLOCK_COMMENT || states[0] == STAR_IN_BLOCK)) {
+                        fprintf(stderr, "Attenzione: Commento multi-riga /* ... */ non chiuso alla fine del file '%s'.\n", ctx->input_filename);
+                    }
+                    emit_record(&w, REC_FILE_END, header->depth, 0, NULL, 0, NULL);
+                    break;
+            }
+        }
+        done = in->last;
+        if (status == 0) status = in->status;
+        ring_release_read(ctx->read_ring);
+    }
+
+    free_token_stream(&window);
+    free_token_stream(&line_tokens);
+    finish_stream(&w, status);
+    return NULL;
+}
+
+// =====================
+// Stadio 3: analisi delle dichiarazioni
+// =====================
+
+/**
+ * Thread dello stadio di analisi. Mantiene il nome del file per ogni livello di
+ * inclusione, passa i token di ogni riga all'analizzatore dell'unità di traduzione
+ * (le righe arrivano nell'ordine dell'output) e inoltra il solo testo allo stadio di scrittura.
+ */
+static void* analyze_stage(void* arg) {
+    PipelineContext* ctx = arg;
+    ChunkWriter w = { ctx->analyze_ring, ring_acquire_write(ctx->analyze_ring) };
+    char* filenames[MAX_INCLUDE_DEPTH + 2] = { NULL };
+    int status = 0;
+    bool done = false;
+
+    while (!done) {
+        PipelineChunk* in = ring_acquire_read(ctx->strip_ring);
+        size_t pos = 0;
+        while (pos < in->used) {
+            RecordHeader* header = (RecordHeader*)(in->data + pos);
+            const char* payload = (const char*)(header + 1);
+            pos += record_size(header->length, header->token_count);
+
+            switch (header->type) {
+                case REC_FILE_BEGIN:
+                    free(filenames[header->depth]);
+                    filenames[header->depth] = malloc((size_t)header->length + 1);
+                    if (filenames[header->depth]) {
+                        memcpy(filenames[header->depth], payload, (size_t)header->length + 1);
+                    } else {
+                        perror("malloc fallito per filename in analyze_stage");
+                    }
+                    emit_record(&w, REC_FILE_BEGIN, header->depth, 0, payload, header->length, NULL);
+                    break;
+                case REC_LINE: {
+                    const char* filename = filenames[header->depth] ? filenames[header->depth] : "(alloc error)";
+                    TokenStream line_tokens = record_token_view(header);
+                    analyze_declaration_tokens(&line_tokens, 0, line_tokens.count, header->line_num, filename, ctx->stats);
+                    emit_record(&w, REC_LINE, header->depth, header->line_num, payload, header->length, NULL);
+                    break;
+                }
+                case REC_FILE_END:
+                    break;
+            }
+        }
+        done = in->last;
+        status = in->status;
+        ring_release_read(ctx->strip_ring);
+    }
+
+    for (int i = 0; i < MAX_INCLUDE_DEPTH + 2; ++i) free(filenames[i]);
+    finish_stream(&w, status);
+    return NULL;
+}
+
+// =====================
+// Stadio 4: scrittura dell'output
+// =====================
+
+/**
+ * Stadio di scrittura, eseguito dal thread chiamante. Scrive le righe nell'ordine
+ * originale; in caso di errore richiede l'interruzione degli stadi precedenti
+ * ma continua a svuotare il ring fino all'ultimo chunk.
+ * @return Esito complessivo degli stadi a monte.
+ */
+static int writer_stage(PipelineContext* ctx) {
+    ProcessingStats* stats = ctx->stats;
+    char* filenames[MAX_INCLUDE_DEPTH + 2] = { NULL }; // File di ogni livello (per i marcatori #line)
+    int status = 0;
+    bool done = false;
+
+    while (!done) {
+        PipelineChunk* in = ring_acquire_read(ctx->analyze_ring);
+        size_t pos = 0;
+        while (pos < in->used) {
+            RecordHeader* header = (RecordHeader*)(in->data + pos);
+            const char* payload = (const char*)(header + 1);
+            pos += record_size(header->length, header->token_count);
+
+            if (header->type == REC_FILE_BEGIN) {
+                free(filenames[header->depth]);
+                filenames[header->depth] = strdup(payload);
+            }
+            if (header->type != REC_LINE || ctx->writer_status != 0) continue;
+            const char* filename = filenames[header->depth] ? filenames[header->depth] : ctx->input_filename;
+            if (!write_output_line(stats, ctx->out_stream, payload, (size_t)header->length, filename, header->line_num)) {
+                perror("Errore durante la scrittura sul file di output");
+                ctx->writer_status = -1;
+                atomic_store_explicit(&ctx->abort, true, memory_order_relaxed);
+            }
+        }
+        done = in->last;
+        status = in->status;
+        ring_release_read(ctx->analyze_ring);
+    }
+
+    for (int i = 0; i < MAX_INCLUDE_DEPTH + 2; ++i) free(filenames[i]);
+    return status;
+}
+
+// =====================
+// Avvio della pipeline
+// =====================
+
+/**
+ * Inizializza un ring buffer vuoto.
+ */
+static SpscRing* create_ring(void) {
+    SpscRing* ring = mem_aligned_alloc(64, (sizeof(SpscRing) + 63) & ~(size_t)63);
+    if (!ring) {
+        perror("Errore: Impossibile allocare il ring buffer della pipeline");
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->events, 0);
+    atomic_init(&ring->sleepers, 0);
+    return ring;
+}
+
+/**
+ * Processa un file C con una pipeline a più thread: lettura/espansione degli include,
+ * rimozione dei commenti, analisi delle dichiarazioni e scrittura dell'output sono
+ * eseguiti da stadi distinti collegati da ring buffer SPSC lock-free di chunk a
+ * dimensione fissa. L'ordine dell'output e le statistiche coincidono con process_c_file.
+ * @param input_filename Nome del file da processare.
+ * @param out_stream Stream di output su cui scrivere il codice processato.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @return 0 in caso di successo, -1 in caso di errore grave.
+ */
+int process_c_file_pipelined(const char* input_filename, FILE* out_stream, ProcessingStats* stats) {
+    PipelineContext ctx;
+    ctx.input_filename = input_filename;
+    ctx.out_stream = out_stream;
+    ctx.stats = stats;
+    ctx.read_ring = create_ring();
+    ctx.strip_ring = create_ring();
+    ctx.analyze_ring = create_ring();
+    atomic_init(&ctx.abort, false);
+    ctx.reader_status = 0;
+    ctx.writer_status = 0;
+
+    if (!ctx.read_ring || !ctx.strip_ring || !ctx.analyze_ring) {
+        mem_free(ctx.read_ring);
+        mem_free(ctx.strip_ring);
+        mem_free(ctx.analyze_ring);
+        return -1;
+    }
+
+    pthread_t threads[3];
+    void* (*stages[3])(void*) = { reader_stage, strip_stage, analyze_stage };
+    int started = 0;
+    for (; started < 3; ++started) {
+        int err = pthread_create(&threads[started], NULL, stages[started], &ctx);
+        if (err != 0) {
+            fprintf(stderr, "Errore: Impossibile avviare il thread della pipeline: %s\n", strerror(err));
+            break;
+        }
+    }
+
+    int result;
+    if (started == 3) {
+        int status = writer_stage(&ctx);
+        result = (status != 0 || ctx.writer_status != 0) ? -1 : 0;
+    } else {
+        // Si interrompe la lettura e si svuota il ring in uscita dall'ultimo stadio avviato,
+        // così che nessun thread resti bloccato sulla backpressure
+        atomic_store_explicit(&ctx.abort, true, memory_order_relaxed);
+        SpscRing* rings[3] = { ctx.read_ring, ctx.strip_ring, ctx.analyze_ring };
+        if (started > 0) {
+            SpscRing* ring = rings[started - 1];
+            bool done = false;
+            while (!done) {
+                done = ring_acquire_read(ring)->last;
+                ring_release_read(ring);
+            }
+        }
+        result = -1;
+    }
+
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    mem_free(ctx.read_ring);
+    mem_free(ctx.strip_ring);
+    mem_free(ctx.analyze_ring);
+    return result;
+}
@@ -6,362 +6,416 @@
 #include <ctype.h>
 #include "myPreCompiler.h"
 
-// Dimensione massima di una riga letta dal file sorgente
-#define MAX_LINE_LEN 4096
-// Profondità massima consentita per l'inclusione ricorsiva di file (#include)
-#define MAX_INCLUDE_DEPTH 10
-
-// Rimozione dei commenti dal codice sorgente
-typedef enum {
-    CODE,           // Analisi normale del codice (non in commento)
-    SLASH,          // Trovato '/' in attesa di capire se è l'inizio di un commento
-    BLOCK_COMMENT,  // All'interno di un commento multi-linea /* ... */
-    LINE_COMMENT,   // All'interno di un commento su singola riga //
-    STAR_IN_BLOCK   // Trovato '*' all'interno di un commento multi-linea
-} CommentState;
-
-// Parsing delle dichiarazioni di variabili
-typedef enum {
-    PRE_MAIN,                 // Prima di trovare la funzione 'main'
-    GLOBAL_DECL,              // Analisi delle dichiarazioni globali (prima di 'main')
-    IN_MAIN_FIND_OPEN_BRACE,  // Trovata la dichiarazione di 'main', in attesa della '{'
-    IN_MAIN_LOCAL_DECL,       // All'interno di 'main', ricerca di dichiarazioni locali
-    IN_MAIN_CODE,             // All'interno di 'main', analisi del codice vero e proprio
-    POST_MAIN                 // Dopo la chiusura di 'main' (stato teorico, non dovrebbe verificarsi)
-} ParsingState;
+// Dimensione minima di un file per attivare la rimozione parallela dei commenti
+#define PARALLEL_STRIP_MIN_SIZE (2 * 1024 * 1024)
 
 // =====================
 // Funzioni di utilità
 // =====================
 
 /**
- * Calcola la dimensione in byte e il numero di righe di un file di testo.
- * @param filename Nome del file da analizzare.
+ * Calcola la dimensione in byte e il numero di righe di un file già caricato in memoria.
+ * @param buf Contenuto del file.
  * @param size Puntatore dove salvare la dimensione in byte.
  * @param lines Puntatore dove salvare il numero di righe.
- * @return true se l'operazione ha successo, false in caso di errore (es. file non trovato).
+ * @return true se l'operazione ha successo, false in caso di errore (buffer non valido).
  */
-bool get_file_pre_stats(const char* filename, long* size, int* lines) {
+bool get_file_pre_stats(const SourceBuffer* buf, long* size, int* lines) {
     *size = 0;
     *lines = 0;
 
-    FILE* fp = fopen(filename, "r");
-    if (!fp) {
+    if (!buf || !buf->data) {
         // L'errore viene gestito dal chiamante
         return false;
     }
 
-    // Calcola la dimensione del file
-    if (fseek(fp, 0, SEEK_END) == 0) {
-        *size = ftell(fp);
-        if (*size == -1) {
-             perror("Errore ftell");
-             *size = 0;
-        }
-        rewind(fp);
-    } else {
-        perror("Errore fseek");
-    }
+    *size = (long)buf->size;
 
     // Conta il numero di righe
-    int ch;
-    bool in_last_line = false;
-    while ((ch = fgetc(fp)) != EOF) {
-        in_last_line = true;
-        if (ch == '\n') {
-            (*lines)++;
-            in_last_line = false;
-        }
+    const char* p = buf->data;
+    const char* end = buf->data + buf->size;
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+        (*lines)++;
+        p++;
     }
     // Conta l'ultima riga se non termina con '\n'
-    if (in_last_line) {
+    if (buf->size > 0 && buf->data[buf->size - 1] != '\n') {
         (*lines)++;
     }
 
-    fclose(fp);
     return true;
 }
 
 /**
- * Analizza una riga per identificare dichiarazioni di variabili e validare i nomi.
- * Aggiorna lo stato di parsing e le statistiche.
- * @param line Riga da analizzare (modificata dalla funzione).
- * @param line_num Numero della riga corrente.
- * @param current_filename Nome del file corrente.
- * @param p_state Puntatore allo stato di parsing.
- * @param stats Puntatore alla struttura delle statistiche.
+ * Estrae la prossima riga da un buffer in memoria, con la stessa semantica di fgets:
+ * copia fino a '\n' incluso o fino a capacity - 1 caratteri.
+ * @param buf Contenuto del file.
+ * @param pos Posizione corrente nel buffer (aggiornata).
+ * @param line Buffer di destinazione.
+ * @param capacity Dimensione del buffer di destinazione.
+ * @return line, oppure NULL se il buffer è terminato.
  */
-void process_declaration_line(char* line, int line_num, const char* current_filename, ParsingState* p_state, ProcessingStats* stats) {
-    char* trimmed_line = line;
-    while (isspace((unsigned char)*trimmed_line)) trimmed_line++;
-    if (*trimmed_line == '\0') return; // Ignora righe vuote
-
-    // Gestione delle parentesi graffe per cambiare stato
-    if (*trimmed_line == '{') {
-        if (*p_state == IN_MAIN_FIND_OPEN_BRACE) {
-            *p_state = IN_MAIN_LOCAL_DECL;
-        }
-        return;
-    }
-    if (*trimmed_line == '}') {
-        if (*p_state == IN_MAIN_CODE || *p_state == IN_MAIN_LOCAL_DECL) {
-            *p_state = POST_MAIN;
-        }
-        return;
-    }
-
-    // Rileva l'inizio della funzione main
-    if (*p_state == PRE_MAIN || *p_state == GLOBAL_DECL) {
-        if (strstr(line, "main") != NULL && strchr(line, '(') != NULL) {
-            *p_state = IN_MAIN_FIND_OPEN_BRACE;
-            return;
-        }
-        if (*p_state == PRE_MAIN) {
-            *p_state = GLOBAL_DECL;
-        }
-    } else if (*p_state == IN_MAIN_FIND_OPEN_BRACE) {
-        // Attende la '{' dopo la dichiarazione di main
-        return;
-    }
-
-    // Analizza dichiarazioni globali o locali
-    if (*p_state == GLOBAL_DECL || *p_state == IN_MAIN_LOCAL_DECL) {
-        // Verifica se la riga termina con ';'
-        char* end = line + strlen(line) - 1;
-        while(end >= line && isspace((unsigned char)*end)) end--;
-        bool ends_with_semicolon = (end >= line && *end == ';');
-
-        if (ends_with_semicolon) {
-            // Estrae potenziali identificatori dalla dichiarazione
-            size_t line_len = strlen(line);
-            char* line_copy = malloc(line_len + 1);
-            if (!line_copy) {
-                perror("malloc fallito in process_declaration_line");
-                return;
-            }
-            strcpy(line_copy, line);
-
-            // Tokenizza la riga per trovare i nomi delle variabili
-            char* token = strtok(line_copy, " \t\n\v\f\r,;*()[]=");
-            bool first_token = true; // Il primo token è il tipo
-
-            while (token != NULL) {
-                if (!first_token) {
-                    // Pulisce il token da eventuali spazi
-                    while (isspace((unsigned char)*token)) token++;
-                    char *tok_end = token + strlen(token) - 1;
-                    while(tok_end > token && isspace((unsigned char)*tok_end)) tok_end--;
-                    *(tok_end + 1) = '\0';
-
-                    if (strlen(token) > 0) {
-                        stats->vars_checked++;
-                        if (!is_valid_c_identifier(token)) {
-                            add_identifier_error(stats, current_filename, line_num, token);
-                        }
-                    }
-                }
-                first_token = false;
-                token = strtok(NULL, " \t\n\v\f\r,;*()[]=");
-            }
-            free(line_copy);
-        } else if (*p_state == IN_MAIN_LOCAL_DECL && *trimmed_line != '\0') {
-            // Se la riga non è una dichiarazione, si passa all'analisi del codice vero e proprio
-            *p_state = IN_MAIN_CODE;
-        }
+char* read_buffer_line(const SourceBuffer* buf, size_t* pos, char* line, size_t capacity) {
+    if (*pos >= buf->size) {
+        return NULL;
     }
+    size_t available = buf->size - *pos;
+    size_t max_len = capacity - 1;
+    if (available > max_len) available = max_len;
+
+    const char* start = buf->data + *pos;
+    const char* newline = memchr(start, '\n', available);
+    size_t len = newline ? (size_t)(newline - start) + 1 : available;
+
+    memcpy(line, start, len);
+    line[len] = '\0';
+    *pos += len;
+    return line;
 }
 
 /**
- * Funzione principale ricorsiva per processare un file C.
- * Rimuove i commenti, gestisce le direttive #include, analizza le dichiarazioni di variabili
- * e aggiorna le statistiche di elaborazione.
- * @param input_filename Nome del file da processare.
- * @param out_stream Stream di output su cui scrivere il codice processato.
+ * Registra le statistiche pre-processamento di un file appena caricato:
+ * per il file principale (depth 0) aggiorna input_file_stats, altrimenti
+ * aggiunge una voce all'array dei file inclusi.
  * @param stats Puntatore alla struttura delle statistiche.
- * @param depth Livello di profondità di inclusione (per evitare ricorsione infinita).
- * @return 0 in caso di successo, -1 in caso di errore grave.
+ * @param filename Nome del file.
+ * @param buf Contenuto del file.
+ * @param depth Livello di profondità di inclusione.
  */
-int process_c_file(const char* input_filename, FILE* out_stream, ProcessingStats* stats, int depth) {
-
-    if (depth > MAX_INCLUDE_DEPTH) {
-        fprintf(stderr, "Errore: Profondità massima di inclusione (%d) superata per il file '%s'. Possibile inclusione ricorsiva infinita.\n", MAX_INCLUDE_DEPTH, input_filename);
-        return -1;
-    }
-
-    // Ottiene statistiche pre-processamento (dimensione e righe)
+void register_file_stats(ProcessingStats* stats, const char* filename, const SourceBuffer* buf, int depth) {
     long file_size = 0;
     int file_lines = 0;
-    bool stats_ok = get_file_pre_stats(input_filename, &file_size, &file_lines);
-
-    // Apre il file di input
-    FILE* in_file = fopen(input_filename, "r");
-    if (!in_file) {
-        fprintf(stderr, "Errore: Impossibile aprire il file di input '%s': %s\n", input_filename, strerror(errno));
-        return -1;
-    }
+    bool stats_ok = get_file_pre_stats(buf, &file_size, &file_lines);
 
-    // Aggiorna le statistiche del file principale o dei file inclusi
     if (stats_ok) {
         if (depth == 0) {
             free(stats->input_file_stats.filename);
-            size_t filename_len = strlen(input_filename);
+            size_t filename_len = strlen(filename);
             stats->input_file_stats.filename = malloc(filename_len + 1);
             if (!stats->input_file_stats.filename) {
                 perror("malloc fallito per nome file input in process_c_file");
                 stats->input_file_stats.filename = NULL;
             } else {
-                strcpy(stats->input_file_stats.filename, input_filename);
+                strcpy(stats->input_file_stats.filename, filename);
             }
             stats->input_file_stats.size_bytes = file_size;
+            stats->input_file_stats.compressed_bytes = (long)buf->compressed_size;
             stats->input_file_stats.lines = file_lines;
         } else {
-            add_included_file_stats(stats, input_filename, file_size, file_lines);
+            add_included_file_stats(stats, filename, file_size, (long)buf->compressed_size, file_lines);
         }
     } else if (depth > 0) {
-        add_included_file_stats(stats, input_filename, -1, -1);
-        fprintf(stderr, "Attenzione: Impossibile ottenere statistiche pre-processamento per il file incluso '%s'.\n", input_filename);
+        add_included_file_stats(stats, filename, -1, 0, -1);
+        fprintf(stderr, "Attenzione: Impossibile ottenere statistiche pre-processamento per il file incluso '%s'.\n", filename);
     } else {
-        fprintf(stderr, "Attenzione: Impossibile ottenere statistiche pre-processamento per il file input '%s'.\n", input_filename);
+        fprintf(stderr, "Attenzione: Impossibile ottenere statistiche pre-processamento per il file input '%s'.\n", filename);
     }
+}
 
-    // Buffer per la riga letta e per la riga processata (senza commenti)
-    char line[MAX_LINE_LEN];
-    char processed_line[MAX_LINE_LEN * 2];
-    int current_line_num = 0;
-    CommentState comment_state = CODE;     // Stato iniziale per la rimozione commenti
-    ParsingState parsing_state = PRE_MAIN; // Stato iniziale per il parsing delle dichiarazioni
-
-    // Ciclo principale di lettura e analisi del file riga per riga
-    while (fgets(line, sizeof(line), in_file) != NULL) {
-        current_line_num++;
-        int processed_len = 0; // Lunghezza della riga processata (senza commenti)
-        bool line_had_comment_flag = false; // Indica se la riga originale conteneva un commento
-        bool is_include_directive = false;
-
-        // 1. Gestione direttiva #include (analizza e processa ricorsivamente i file inclusi)
-        char* trimmed_line_start = line;
-        while(isspace((unsigned char)*trimmed_line_start)) trimmed_line_start++;
-
-        if (strncmp(trimmed_line_start, "#include", 8) == 0) {
-            is_include_directive = true;
-            char* included_filename = extract_include_filename(trimmed_line_start);
-            if (included_filename) {
-                stats->includes_processed++;
-                int include_result = process_c_file(included_filename, out_stream, stats, depth + 1);
-                free(included_filename);
-
-                if (include_result != 0) {
-                    fprintf(stderr, "...Errore originato durante l'inclusione richiesta in '%s' riga %d.\n", input_filename, current_line_num);
-                    fclose(in_file);
-                    return -1;
+/**
+ * Rimuove i commenti da una riga facendo avanzare la macchina a stati CommentState.
+ * Lo stato viene conservato tra una riga e l'altra per gestire i commenti multi-linea.
+ * @param line Riga da processare (terminata da '\0').
+ * @param processed_line Buffer di destinazione (almeno MAX_LINE_LEN * 2 caratteri).
+ * @param comment_state Puntatore allo stato della macchina (aggiornato).
+ * @param had_comment Impostato a true se la riga contiene almeno un carattere di commento.
+ * @return Lunghezza della riga processata.
+ */
+int strip_comments_line(const char* line, char* processed_line, CommentState* comment_state, bool* had_comment) {
+    int processed_len = 0;
+    CommentState state = *comment_state;
+    bool line_had_comment_flag = false;
+
+    for (int i = 0; line[i] != '\0'; ++i) {
+        switch (state) {
+            case CODE:
+                if (line[i] == '/') {
+                    state = SLASH;
+                } else {
+                    processed_line[processed_len++] = line[i];
                 }
-                continue; // Passa alla prossima riga dopo aver gestito l'include
-            } else {
-                fprintf(stderr, "Attenzione: Formato #include non valido o errore in '%s' riga %d. Riga trattata come codice.\n", input_filename, current_line_num);
-                is_include_directive = false;
-            }
-        }
-
-        // 2. Rimozione dei commenti dalla riga corrente
-        processed_len = 0;
-        processed_line[0] = '\0';
-        bool current_line_is_fully_commented = false;
-
-        for (int i = 0; line[i] != '\0'; ++i) {
-            switch (comment_state) {
-                case CODE:
-                    if (line[i] == '/') {
-                        comment_state = SLASH;
-                    } else {
-                        processed_line[processed_len++] = line[i];
-                    }
-                    break;
-                case SLASH:
-                    if (line[i] == '/') {
-                        comment_state = LINE_COMMENT;
-                        line_had_comment_flag = true;
-                    } else if (line[i] == '*') {
-                        comment_state = BLOCK_COMMENT;
-                        line_had_comment_flag = true;
-                    } else {
-                        processed_line[processed_len++] = '/';
-                        processed_line[processed_len++] = line[i];
-                        comment_state = CODE;
-                    }
-                    break;
-                case LINE_COMMENT:
-                    // Ignora tutto fino a fine riga
-                    if (line[i] == '\n') {
-                        processed_line[processed_len++] = '\n';
-                        comment_state = CODE;
-                    }
-                    break;
-                case BLOCK_COMMENT:
+                break;
+            case SLASH:
+                if (line[i] == '/') {
+                    state = LINE_COMMENT;
                     line_had_comment_flag = true;
-                    if (line[i] == '*') {
-                        comment_state = STAR_IN_BLOCK;
-                    } else if (line[i] == '\n') {
-                        processed_line[processed_len++] = '\n';
-                    }
-                    break;
-                case STAR_IN_BLOCK:
+                } else if (line[i] == '*') {
+                    state = BLOCK_COMMENT;
                     line_had_comment_flag = true;
-                    if (line[i] == '/') {
-                        comment_state = CODE;
-                    } else if (line[i] == '*') {
-                        // Rimane in STAR_IN_BLOCK
-                    } else {
-                        comment_state = BLOCK_COMMENT;
-                        if (line[i] == '\n') {
-                            processed_line[processed_len++] = '\n';
-                        }
+                } else {
+                    processed_line[processed_len++] = '/';
+                    processed_line[processed_len++] = line[i];
+                    state = CODE;
+                }
+                break;
+            case LINE_COMMENT:
+                // Ignora tutto fino a fine riga
+                if (line[i] == '\n') {
+                    processed_line[processed_len++] = '\n';
+                    state = CODE;
+                }
+                break;
+            case BLOCK_COMMENT:
+                line_had_comment_flag = true;
+                if (line[i] == '*') {
+                    state = STAR_IN_BLOCK;
+                } else if (line[i] == '\n') {
+                    processed_line[processed_len++] = '\n';
+                }
+                break;
+            case STAR_IN_BLOCK:
+                line_had_comment_flag = true;
+                if (line[i] == '/') {
+                    state = CODE;
+                } else if (line[i] == '*') {
+                    // Rimane in STAR_IN_BLOCK
+                } else {
+                    state = BLOCK_COMMENT;
+                    if (line[i] == '\n') {
+                        processed_line[processed_len++] = '\n';
                     }
-                    break;
-            }
+                }
+                break;
         }
-        processed_line[processed_len] = '\0';
+    }
+    processed_line[processed_len] = '\0';
 
-        // Verifica se la riga processata è vuota o ci sono solo spazi
-        char* check_empty = processed_line;
-        while(isspace((unsigned char)*check_empty)) check_empty++;
-        current_line_is_fully_commented = (*check_empty == '\0');
+    *comment_state = state;
+    *had_comment = line_had_comment_flag;
+    return processed_len;
+}
 
-        // Aggiorna il contatore dei commenti rimossi
-        if (line_had_comment_flag && (current_line_is_fully_commented || comment_state == BLOCK_COMMENT || comment_state == STAR_IN_BLOCK)) {
-            stats->comments_removed++;
-        }
+/**
+ * Verifica se una riga processata è vuota o contiene solo spazi.
+ * @param processed_line Riga da verificare.
+ * @return true se la riga non contiene caratteri significativi.
+ */
+bool is_blank_line(const char* processed_line) {
+    while (isspace((unsigned char)*processed_line)) processed_line++;
+    return *processed_line == '\0';
+}
 
-        // 3. Analisi delle dichiarazioni di variabili sulla riga processata
-        if (!current_line_is_fully_commented) {
-            char line_copy_for_analysis[MAX_LINE_LEN * 2];
-            strncpy(line_copy_for_analysis, processed_line, sizeof(line_copy_for_analysis) -1);
-            line_copy_for_analysis[sizeof(line_copy_for_analysis) - 1] = '\0';
-            process_declaration_line(line_copy_for_analysis, current_line_num, input_filename, &parsing_state, stats);
-        }
+/**
+ * Indica se una riga con commenti va conteggiata tra le righe di commento eliminate:
+ * la riga deve essere interamente commentata oppure terminare dentro un commento multi-linea.
+ */
+bool counts_as_comment_line(bool had_comment, bool fully_commented, CommentState state_after) {
+    return had_comment && (fully_commented || state_after == BLOCK_COMMENT || state_after == STAR_IN_BLOCK);
+}
 
-        // 4. Scrittura della riga processata sull'output, se non è completamente commentata
-        if (!current_line_is_fully_commented) {
-            if (fputs(processed_line, out_stream) == EOF) {
-                perror("Errore durante la scrittura sul file di output");
-                fclose(in_file);
-                return -1;
+/**
+ * Indica se un carattere è uno spazio compattabile (il '\n' finale è gestito a parte).
+ */
+static inline bool is_minify_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * Compatta una riga di output: fuori dai letterali stringa e carattere ogni sequenza di
+ * spazi diventa un solo spazio, gli spazi iniziali e finali vengono eliminati. All'inizio
+ * della prosecuzione di una riga spezzata gli spazi iniziali diventano un solo spazio,
+ * alla fine di una riga senza '\n' quelli finali, così i token non vengono mai uniti.
+ * @param state Stato della minificazione (aggiornato se la riga viene mantenuta).
+ * @param text Riga da compattare.
+ * @param len Lunghezza della riga.
+ * @param out Buffer di destinazione (almeno len byte).
+ * @return Lunghezza della riga compattata, 0 se la riga è vuota e va eliminata.
+ */
+static size_t minify_line(MinifyState* state, const char* text, size_t len, char* out) {
+    bool continuation = state->mid_line;
+    char quote = continuation ? state->quote : '\0';
+    bool has_newline = len > 0 && text[len - 1] == '\n';
+    size_t body = has_newline ? len - 1 : len;
+    bool in_space = false;
+    size_t n = 0;
+
+    for (size_t i = 0; i < body; ++i) {
+        char c = text[i];
+        if (quote) {
+            out[n++] = c;
+            if (c == '\\' && i + 1 < body) {
+                out[n++] = text[++i];
+            } else if (c == quote) {
+                quote = '\0';
             }
-            stats->output_lines++;
-            stats->output_size_bytes += processed_len;
+            continue;
+        }
+        if (is_minify_space(c)) {
+            in_space = true;
+            continue;
         }
+        if (in_space && (n > 0 || continuation)) out[n++] = ' ';
+        in_space = false;
+        if (c == '"' || c == '\'') quote = c;
+        out[n++] = c;
     }
+    if (in_space && !has_newline && (n > 0 || continuation)) out[n++] = ' ';
 
-    // Gestione di eventuali errori di lettura
-    if (ferror(in_file)) {
-        fprintf(stderr, "Errore durante la lettura del file '%s': %s\n", input_filename, strerror(errno));
-        fclose(in_file);
-        return -1;
+    // Le righe vuote vengono eliminate, tranne quella che chiude una continuazione
+    if (n == 0 && !continuation && (has_newline || !in_space)) return 0;
+    if (has_newline) out[n++] = '\n';
+
+    bool continues = !has_newline || (n >= 2 && out[n - 2] == '\\');
+    state->mid_line = continues;
+    state->quote = continues ? quote : '\0';
+    return n;
+}
+
+/**
+ * Scrive una riga di output e aggiorna le statistiche. Con l'opzione minify la riga viene
+ * compattata (le righe vuote non vengono scritte) e, se richiesto, preceduta da un marcatore
+ * #line quando non segue la riga scritta in precedenza nello stesso file.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param out_stream Stream di output.
+ * @param text Riga da scrivere.
+ * @param len Lunghezza della riga.
+ * @param filename File di provenienza della riga (per i marcatori #line).
+ * @param line_num Numero della riga nel file di provenienza.
+ * @return true in caso di successo, false in caso di errore di scrittura.
+ */
+bool write_output_line(ProcessingStats* stats, FILE* out_stream, const char* text, size_t len, const char* filename, int line_num) {
+    const ProcessingOptions* options = stats->options;
+    char minified[MAX_LINE_LEN * 2];
+    if (options && options->minify && len <= sizeof(minified)) {
+        MinifyState* state = &stats->minify;
+        bool at_line_start = !state->mid_line;
+        size_t n = minify_line(state, text, len, minified);
+        state->bytes_saved += (long)(len - n);
+        if (n == 0) return true;
+
+        if (options->line_markers && at_line_start &&
+            (!state->marker_filename || line_num != state->next_line || strcmp(state->marker_filename, filename) != 0)) {
+            int marker_len = fprintf(out_stream, "#line %d \"%s\"\n", line_num, filename);
+            if (marker_len < 0) return false;
+            stats->output_lines++;
+            stats->output_size_bytes += marker_len;
+            state->markers++;
+            if (!state->marker_filename || strcmp(state->marker_filename, filename) != 0) {
+                free(state->marker_filename);
+                state->marker_filename = strdup(filename);
+            }
+        }
+        state->next_line = line_num + 1;
+        text = minified;
+        len = n;
     }
 
-    // Chiusura del file di input
-    if (fclose(in_file) != 0) {
-        fprintf(stderr, "Errore durante la chiusura del file '%s': %s\n", input_filename, strerror(errno));
+    if (len > 0 && fwrite(text, 1, len, out_stream) != len) return false;
+    stats->output_lines++;
+    stats->output_size_bytes += (long)len;
+    return true;
+}
+
+/**
+ * Ciclo di elaborazione di un file già caricato, per una combinazione di stadi.
+ * La funzione è sempre espansa e stages è una costante in ogni variante: gli stadi non
+ * attivi non lasciano né codice né salti nel ciclo, e il lexer produce solo i token
+ * necessari (nessuna parola senza analisi, nessun token senza rimozione dei commenti).
+ * @param input_filename Nome del file (per messaggi e statistiche).
+ * @param in_buf Contenuto del file.
+ * @param out_stream Stream di output su cui scrivere il codice processato.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param depth Livello di profondità di inclusione.
+ * @param stages Stadi attivi (maschera STAGE_*).
+ * @return 0 in caso di successo, -1 in caso di errore grave.
+ */
+static ALWAYS_INLINE int process_lines(const char* input_filename, const SourceBuffer* in_buf, FILE* out_stream, ProcessingStats* stats, int depth, const unsigned stages) {
+    const bool strip = (stages & STAGE_STRIP) != 0;
+    const bool includes = (stages & STAGE_INCLUDES) != 0;
+    const bool check = (stages & STAGE_CHECK) != 0;
+    const LexMode lex_mode = check ? LEX_TOKENS : (strip ? LEX_SPANS : LEX_LINES);
+    IncludeGraph* include_graph = stats->options ? stats->options->include_graph : NULL;
+
+    // Il file viene scandito una sola volta dal lexer: ogni finestra di token (righe intere)
+    // alimenta in sequenza la gestione degli include, l'analisi e la scrittura dell'output.
+    Lexer lexer;
+    init_lexer(&lexer, in_buf->data, in_buf->size, CODE);
+    lexer.includes = includes; // Senza espansione le direttive sono codice: i commenti vengono rimossi
+    TokenStream tokens;
+    init_token_stream(&tokens);
+    char line[MAX_LINE_LEN * 2];
+    const bool minify = stats->options && stats->options->minify;
+    int current_line_num = 0;
+    int result = 0;
+    size_t reported_pos = 0;        // Byte già conteggiati nell'avanzamento
+    int reported_lines = 0;
+
+    // Ciclo principale: finestre di token, elaborate riga per riga
+    while (result == 0 && lex_window_as(&lexer, &tokens, lex_mode)) {
+        int line_first = 0;
+        for (int t = 0; t < tokens.count && result == 0; ++t) {
+            unsigned char kind = tokens.kinds[t];
+            if (TOKEN_KIND(kind) != TOK_EOL) continue;
+            int line_end = t;
+            unsigned flags = TOKEN_FLAGS(kind);
+            current_line_num++;
+            bool is_include = TOKEN_KIND(tokens.kinds[line_first]) == TOK_INCLUDE;
+
+            // 1. Gestione direttiva #include (analizza e processa ricorsivamente i file inclusi)
+            if (includes && (is_include || (flags & LINE_BAD_INCLUDE))) {
+                memcpy(line, tokens.base + tokens.offsets[t], tokens.lengths[t]);
+                line[tokens.lengths[t]] = '\0';
+                char* trimmed_line_start = line;
+                while(isspace((unsigned char)*trimmed_line_start)) trimmed_line_start++;
+
+                char* included_filename = extract_include_filename(trimmed_line_start);
+                if (included_filename) {
+                    stats->includes_processed++;
+                    if (include_graph) include_graph->next_include_line = current_line_num;
+                    int include_result = process_c_file(included_filename, out_stream, stats, depth + 1);
+                    free(included_filename);
+
+                    if (include_result != 0) {
+                        fprintf(stderr, "...Errore originato durante l'inclusione richiesta in '%s' riga %d.\n", input_filename, current_line_num);
+                        result = -1;
+                    }
+                    line_first = t + 1;
+                    continue; // Passa alla prossima riga dopo aver gestito l'include
+                } else {
+                    fprintf(stderr, "Attenzione: Formato #include non valido o errore in '%s' riga %d. Riga trattata come codice.\n", input_filename, current_line_num);
+                }
+            }
+
+            bool ok = true;
+            if (strip) {
+                // 2. Commenti rimossi: i flag della riga sono calcolati dal lexer
+                if (flags & LINE_COUNT_COMMENT) {
+                    stats->comments_removed++;
+                }
+
+                // 3. Analisi delle dichiarazioni e 4. scrittura della riga, se non è completamente commentata
+                if (!(flags & LINE_BLANK)) {
+                    if (check) analyze_declaration_tokens(&tokens, line_first, line_end, current_line_num, input_filename, stats);
+
+                    if (minify) {
+                        size_t kept_len = copy_kept_tokens(&tokens, line_first, line_end, line, 0, NULL);
+                        ok = write_output_line(stats, out_stream, line, kept_len, input_filename, current_line_num);
+                    } else {
+                        size_t written = 0;
+                        ok = write_kept_tokens(&tokens, line_first, line_end, out_stream, &written);
+                        stats->output_lines++;
+                        stats->output_size_bytes += (long)written;
+                    }
+                }
+            } else {
+                // Commenti mantenuti: l'analisi usa comunque i token senza commenti
+                if (check) analyze_declaration_tokens(&tokens, line_first, line_end, current_line_num, input_filename, stats);
+                ok = write_output_line(stats, out_stream, tokens.base + tokens.offsets[t], tokens.lengths[t], input_filename, current_line_num);
+            }
+            if (!ok) {
+                perror("Errore durante la scrittura sul file di output");
+                result = -1;
+                break;
+            }
+            line_first = t + 1;
+        }
+        progress_advance(lexer.pos - reported_pos, current_line_num - reported_lines);
+        reported_pos = lexer.pos;
+        reported_lines = current_line_num;
     }
+    free_token_stream(&tokens);
+    if (result != 0) return result;
+    CommentState comment_state = lexer.state;
 
     // Avviso se il file termina con un commento multi-linea non chiuso
     if (depth == 0 && (comment_state == BLOCK_COMMENT || comment_state == STAR_IN_BLOCK)) {
@@ -369,4 +423,100 @@ int process_c_file(const char* input_filename, FILE* out_stream, ProcessingStats
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+// Varianti specializzate del ciclo, una per combinazione di stadi (indice = maschera STAGE_*)
+typedef int (*StageLoop)(const char* input_filename, const SourceBuffer* in_buf, FILE* out_stream, ProcessingStats* stats, int depth);
+
+#define DEFINE_STAGE_LOOP(stages) \
+    static int process_lines_##stages(const char* input_filename, const SourceBuffer* in_buf, FILE* out_stream, ProcessingStats* stats, int depth) { \
+        return process_lines(input_filename, in_buf, out_stream, stats, depth, stages); \
+    }
+DEFINE_STAGE_LOOP(1)
+DEFINE_STAGE_LOOP(2)
+DEFINE_STAGE_LOOP(3)
+DEFINE_STAGE_LOOP(4)
+DEFINE_STAGE_LOOP(5)
+DEFINE_STAGE_LOOP(6)
+DEFINE_STAGE_LOOP(7)
+#undef DEFINE_STAGE_LOOP
+
+static const StageLoop stage_loops[STAGE_ALL + 1] = {
+    process_lines_7, // Nessuno stadio selezionato: elaborazione completa
+    process_lines_1, process_lines_2, process_lines_3,
+    process_lines_4, process_lines_5, process_lines_6, process_lines_7
+};
+
+/**
+ * Elabora riga per riga un file già caricato: rimuove i commenti, gestisce le direttive
+ * #include, analizza le dichiarazioni di variabili e scrive l'output, secondo gli stadi
+ * attivi nelle opzioni.
+ * @param input_filename Nome del file (per messaggi e statistiche).
+ * @param in_buf Contenuto del file.
+ * @param out_stream Stream di output su cui scrivere il codice processato.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param depth Livello di profondità di inclusione.
+ * @return 0 in caso di successo, -1 in caso di errore grave.
+ */
+static int process_loaded_file(const char* input_filename, const SourceBuffer* in_buf, FILE* out_stream, ProcessingStats* stats, int depth) {
+    unsigned stages = stats->options ? (stats->options->stages & STAGE_ALL) : STAGE_ALL;
+
+    // I file di grandi dimensioni vengono suddivisi in chunk elaborati in parallelo
+    int strip_threads = stats->options ? stats->options->strip_threads : 1;
+    if (stages == STAGE_ALL && strip_threads > 1 && in_buf->size >= PARALLEL_STRIP_MIN_SIZE) {
+        return process_buffer_parallel(input_filename, in_buf, out_stream, stats, depth, strip_threads);
+    }
+
+    return stage_loops[stages](input_filename, in_buf, out_stream, stats, depth);
+}
+
+/**
+ * Funzione principale ricorsiva per processare un file C.
+ * Rimuove i commenti, gestisce le direttive #include, analizza le dichiarazioni di variabili
+ * e aggiorna le statistiche di elaborazione.
+ * @param input_filename Nome del file da processare.
+ * @param out_stream Stream di output su cui scrivere il codice processato.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param depth Livello di profondità di inclusione (per evitare ricorsione infinita).
+ * @return 0 in caso di successo, -1 in caso di errore grave.
+ */
+int process_c_file(const char* input_filename, FILE* out_stream, ProcessingStats* stats, int depth) {
+
+    if (depth > MAX_INCLUDE_DEPTH) {
+        fprintf(stderr, "Errore: Profondità massima di inclusione (%d) superata per il file '%s'. Possibile inclusione ricorsiva infinita.\n", MAX_INCLUDE_DEPTH, input_filename);
+        return -1;
+    }
+
+    // Header inclusi: usa la versione precompilata, se presente e aggiornata, oppure
+    // quella condivisa tra i processi in memoria condivisa
+    if (depth > 0) {
+        int pch_result = use_precompiled_header(input_filename, out_stream, stats, depth);
+        if (pch_result == 0) pch_result = use_shared_header(input_filename, out_stream, stats, depth);
+        if (pch_result != 0) return (pch_result > 0) ? 0 : -1;
+    }
+
+    // Carica il file di input (dalla cache del prefetch o con lettura sincrona)
+    FileCache* file_cache = stats->options ? stats->options->file_cache : NULL;
+    SourceBuffer in_buf;
+    progress_file_begin(input_filename, depth);
+    int read_error = read_source_file(file_cache, input_filename, &in_buf);
+    if (read_error != 0) {
+        fprintf(stderr, "Errore: Impossibile aprire il file di input '%s': %s\n", input_filename, strerror(read_error));
+        progress_file_end(depth);
+        return -1;
+    }
+
+    // Aggiorna le statistiche del file principale o dei file inclusi
+    register_file_stats(stats, input_filename, &in_buf, depth);
+
+    // Registra l'occorrenza del file nel grafo delle inclusioni, se richiesto
+    IncludeGraph* include_graph = stats->options ? stats->options->include_graph : NULL;
+    int graph_node = include_graph ? include_graph_enter(include_graph, input_filename, depth, stats->output_size_bytes, stats->output_lines) : -1;
+
+    int result = process_loaded_file(input_filename, &in_buf, out_stream, stats, depth);
+    progress_file_end(depth);
+
+    if (include_graph) include_graph_leave(include_graph, graph_node, stats->output_size_bytes, stats->output_lines);
+    release_source_buffer(&in_buf);
+    return result;
+}
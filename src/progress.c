@@ -0,0 +1,253 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "myPreCompiler.h"
+
+// Lunghezza massima dei nomi conservati nella pila delle inclusioni
+#define PROGRESS_NAME_LEN 256
+
+// Contatori di avanzamento: scritti dal solo thread che elabora i file (il thread principale,
+// oppure il lettore in modalità pipeline) e letti dal thread del rapporto.
+// La pila delle inclusioni è protetta da un seqlock: stack_seq è dispari durante una modifica.
+typedef struct {
+    atomic_long bytes;      // Byte sorgente elaborati
+    atomic_long lines;      // Righe sorgente elaborate
+    atomic_int files;       // File aperti
+    atomic_uint stack_seq;
+    atomic_int depth;       // Elementi validi della pila
+    char stack[MAX_INCLUDE_DEPTH + 1][PROGRESS_NAME_LEN];
+
+    bool active;            // true mentre il thread del rapporto è in esecuzione
+    atomic_bool stop;
+    pthread_t thread;
+    ProgressOptions options;
+    uint64_t start_ns;
+} ProgressState;
+
+static ProgressState progress;
+
+// =====================
+// Aggiornamento dei contatori
+// =====================
+
+/**
+ * Registra l'inizio dell'elaborazione di un file: il nome diventa la cima della pila.
+ * @param filename Nome del file.
+ * @param depth Profondità di inclusione del file.
+ */
+void progress_file_begin(const char* filename, int depth) {
+    if (!progress.active || depth < 0 || depth > MAX_INCLUDE_DEPTH) return;
+    unsigned seq = atomic_load_explicit(&progress.stack_seq, memory_order_relaxed);
+    atomic_store_explicit(&progress.stack_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    strncpy(progress.stack[depth], filename, PROGRESS_NAME_LEN - 1);
+    progress.stack[depth][PROGRESS_NAME_LEN - 1] = '\0';
+    atomic_store_explicit(&progress.depth, depth + 1, memory_order_relaxed);
+    atomic_store_explicit(&progress.stack_seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&progress.files, atomic_load_explicit(&progress.files, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+/**
+ * Registra la fine dell'elaborazione del file alla profondità indicata.
+ * @param depth Profondità di inclusione del file.
+ */
+void progress_file_end(int depth) {
+    if (!progress.active || depth < 0 || depth > MAX_INCLUDE_DEPTH) return;
+    atomic_store_explicit(&progress.depth, depth, memory_order_release);
+}
+
+/**
+ * Aggiunge byte e righe sorgente elaborati. Essendo un solo thread a scrivere, i contatori
+ * vengono aggiornati con load e store invece che con operazioni atomiche read-modify-write.
+ * @param bytes Byte elaborati.
+ * @param lines Righe elaborate.
+ */
+void progress_advance(size_t bytes, int lines) {
+    if (!progress.active) return;
+    atomic_store_explicit(&progress.bytes, atomic_load_explicit(&progress.bytes, memory_order_relaxed) + (long)bytes, memory_order_relaxed);
+    atomic_store_explicit(&progress.lines, atomic_load_explicit(&progress.lines, memory_order_relaxed) + lines, memory_order_relaxed);
+}
+
+// =====================
+// Rapporto
+// =====================
+
+/**
+ * Copia la pila delle inclusioni corrente ("a.c > b.h > c.h") rileggendola finché
+ * non si ottiene una copia coerente.
+ */
+static void read_include_stack(char* text, size_t capacity) {
+    unsigned seq_before, seq_after;
+    do {
+        seq_before = atomic_load_explicit(&progress.stack_seq, memory_order_acquire);
+        size_t len = 0;
+        text[0] = '\0';
+        int depth = atomic_load_explicit(&progress.depth, memory_order_acquire);
+        for (int d = 0; d < depth && d <= MAX_INCLUDE_DEPTH; ++d) {
+            int n = snprintf(text + len, capacity - len, "%s%.*s", d > 0 ? " > " : "", PROGRESS_NAME_LEN, progress.stack[d]);
+            if (n < 0 || (size_t)n >= capacity - len) break;
+            len += (size_t)n;
+        }
+        atomic_thread_fence(memory_order_acquire);
+        seq_after = atomic_load_explicit(&progress.stack_seq, memory_order_relaxed);
+    } while ((seq_before & 1) || seq_before != seq_after);
+}
+
+/**
+ * Scrive una riga di rapporto: tempo trascorso, byte e righe elaborati, velocità
+ * nell'ultimo intervallo e media, file aperti e pila delle inclusioni.
+ * @param reason Motivo del rapporto (NULL per i rapporti periodici e su segnale).
+ * @param last_bytes Byte al rapporto precedente (aggiornato).
+ * @param last_ns Istante del rapporto precedente (aggiornato).
+ */
+static void write_report(const char* reason, long* last_bytes, uint64_t* last_ns) {
+    uint64_t now = monotonic_ns();
+    long bytes = atomic_load_explicit(&progress.bytes, memory_order_relaxed);
+    long lines = atomic_load_explicit(&progress.lines, memory_order_relaxed);
+    int files = atomic_load_explicit(&progress.files, memory_order_relaxed);
+    double elapsed = (double)(now - progress.start_ns) / 1e9;
+    double interval = (double)(now - *last_ns) / 1e9;
+    double rate = interval > 0 ? (double)(bytes - *last_bytes) / interval / 1e6 : 0.0;
+    double average = elapsed > 0 ? (double)bytes / elapsed / 1e6 : 0.0;
+    *last_bytes = bytes;
+    *last_ns = now;
+
+    char stack[(MAX_INCLUDE_DEPTH + 1) * (PROGRESS_NAME_LEN + 3)];
+    read_include_stack(stack, sizeof(stack));
+
+    char report[sizeof(stack) + 256];
+    snprintf(report, sizeof(report), "[avanzamento] %.1f s: %ld byte, %ld righe, %.1f MB/s (media %.1f MB/s), %d file; inclusioni: %s%s%s\n",
+             elapsed, bytes, lines, rate, average, files, stack[0] ? stack : "(nessun file)",
+             reason ? "; " : "", reason ? reason : "");
+
+    // Il file di stato viene sostituito per intero, così chi lo legge non vede mai un rapporto a metà
+    if (progress.options.status_file) {
+        size_t len = strlen(progress.options.status_file);
+        char* tmp = malloc(len + 5);
+        FILE* fp = NULL;
+        if (tmp) {
+            sprintf(tmp, "%s.tmp", progress.options.status_file);
+            fp = fopen(tmp, "w");
+        }
+        bool ok = fp && fputs(report, fp) >= 0;
+        if (fp && fclose(fp) != 0) ok = false;
+        if (!ok || rename(tmp, progress.options.status_file) != 0) {
+            fprintf(stderr, "Attenzione: Impossibile aggiornare il file di stato '%s'.\n", progress.options.status_file);
+            fputs(report, stderr);
+        }
+        free(tmp);
+    } else {
+        fputs(report, stderr);
+    }
+}
+
+/**
+ * Thread del rapporto: attende SIGUSR1 (bloccato in tutti i thread) con sigtimedwait,
+ * con un timeout pari alla prossima scadenza tra rapporto periodico e controllo del watchdog.
+ */
+static void* progress_thread(void* arg) {
+    (void)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+
+    const uint64_t interval_ns = (uint64_t)progress.options.interval * 1000000000ull;
+    const uint64_t timeout_ns = (uint64_t)progress.options.timeout * 1000000000ull;
+    // Il watchdog controlla i contatori quattro volte per periodo di timeout
+    const uint64_t watchdog_step = timeout_ns / 4;
+    uint64_t next_report = progress.start_ns + interval_ns;
+    uint64_t next_check = progress.start_ns + watchdog_step;
+    uint64_t last_change = progress.start_ns;
+    long watched_bytes = 0;
+    long last_bytes = 0;
+    uint64_t last_ns = progress.start_ns;
+
+    while (!atomic_load(&progress.stop)) {
+        uint64_t now = monotonic_ns();
+        uint64_t deadline = UINT64_MAX;
+        if (interval_ns > 0) deadline = next_report;
+        if (timeout_ns > 0 && next_check < deadline) deadline = next_check;
+
+        int sig;
+        if (deadline == UINT64_MAX) {
+            sig = sigwaitinfo(&set, NULL);
+        } else {
+            uint64_t wait = (deadline > now) ? deadline - now : 0;
+            struct timespec ts = { (time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull) };
+            sig = sigtimedwait(&set, NULL, &ts);
+        }
+        if (atomic_load(&progress.stop)) break;
+        now = monotonic_ns();
+
+        if (sig == SIGUSR1) write_report(NULL, &last_bytes, &last_ns);
+        if (interval_ns > 0 && now >= next_report) {
+            write_report(NULL, &last_bytes, &last_ns);
+            while (next_report <= now) next_report += interval_ns;
+        }
+        if (timeout_ns > 0 && now >= next_check) {
+            long bytes = atomic_load_explicit(&progress.bytes, memory_order_relaxed);
+            if (bytes != watched_bytes) {
+                watched_bytes = bytes;
+                last_change = now;
+            } else if (now - last_change >= timeout_ns) {
+                char stack[(MAX_INCLUDE_DEPTH + 1) * (PROGRESS_NAME_LEN + 3)];
+                read_include_stack(stack, sizeof(stack));
+                write_report("nessun avanzamento", &last_bytes, &last_ns);
+                fprintf(stderr, "Errore: Nessun avanzamento da %d secondi (inclusioni: %s): elaborazione interrotta.\n",
+                        progress.options.timeout, stack[0] ? stack : "(nessun file)");
+                _exit(1);
+            }
+            while (next_check <= now) next_check += watchdog_step;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Avvia il thread del rapporto di avanzamento. SIGUSR1 viene bloccato nel thread chiamante
+ * (e quindi in tutti i thread creati in seguito) ed è ricevuto solo dal thread del rapporto.
+ * @param options Intervallo dei rapporti periodici, timeout del watchdog e file di stato.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int start_progress_reporter(const ProgressOptions* options) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    int err = pthread_sigmask(SIG_BLOCK, &set, NULL);
+    if (err != 0) {
+        fprintf(stderr, "Errore: Impossibile bloccare SIGUSR1: %s\n", strerror(err));
+        return -1;
+    }
+
+    progress.options = *options;
+    progress.start_ns = monotonic_ns();
+    atomic_store(&progress.stop, false);
+    progress.active = true;
+    err = pthread_create(&progress.thread, NULL, progress_thread, NULL);
+    if (err != 0) {
+        progress.active = false;
+        fprintf(stderr, "Errore: Impossibile avviare il thread di avanzamento: %s\n", strerror(err));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Ferma il thread del rapporto di avanzamento. SIGUSR1 resta bloccato: un segnale che
+ * arriva dopo la chiusura non termina il processo.
+ */
+void stop_progress_reporter(void) {
+    if (!progress.active) return;
+    atomic_store(&progress.stop, true);
+    pthread_kill(progress.thread, SIGUSR1);
+    pthread_join(progress.thread, NULL);
+    progress.active = false;
+}
@@ -0,0 +1,429 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "myPreCompiler.h"
+
+// Formato del segmento: intestazione, indice a dimensione fissa e area dati a crescita lineare
+#define SHM_CACHE_MAGIC "MYSHMC\x1a\n"     // 7 caratteri più '\0' (campo magic di 8 byte)
+#define SHM_CACHE_VERSION 2
+#define SHM_CACHE_DEFAULT_NAME "/myPreCompiler"
+#define SHM_CACHE_DEFAULT_SIZE (64L * 1024 * 1024)
+#define SHM_CACHE_SLOTS 4096                // Voci dell'indice (indirizzamento aperto)
+#define SHM_CACHE_ALIGN 64                  // Allineamento dell'area dati e delle immagini
+#define SHM_CACHE_INIT_WAIT_MS 2000         // Attesa massima dell'inizializzazione da parte del creatore
+#define SHM_CACHE_STALE_RETRIES 3           // Ripubblicazioni tentate per un'immagine non aggiornata
+#define SHM_CACHE_WRITE_WAIT_MS 10000       // Attesa massima della pubblicazione di una voce riservata
+
+// Tag di una voce: stato nei 2 bit bassi, identità del writer nei 38 bit successivi
+// (solo per le voci riservate) e hash della chiave nei 24 bit alti
+#define SLOT_STATE_MASK 0x3ULL
+#define SLOT_OWNER_SHIFT 2
+#define SLOT_OWNER_MASK (((1ULL << 38) - 1) << SLOT_OWNER_SHIFT)
+#define SLOT_HASH_SHIFT 40
+#define SLOT_HASH_MASK (~0ULL << SLOT_HASH_SHIFT)
+#define SLOT_WRITING 0x1ULL                 // Riservata: il processo writer sta elaborando l'header
+#define SLOT_READY 0x2ULL                   // Pubblicata (length = 0: header non memorizzabile)
+#define SLOT_ABANDONED 0x3ULL               // Writer terminato prima della pubblicazione o immagine non aggiornata
+
+// Parametri dell'hash FNV-1a a 64 bit della chiave
+#define SHM_FNV_OFFSET 14695981039346656037ULL
+#define SHM_FNV_PRIME 1099511628211ULL
+
+/**
+ * Intestazione del segmento. Il creatore la compila e poi imposta ready: gli altri
+ * processi la leggono solo dopo averlo visto a 1.
+ */
+typedef struct {
+    char magic[8];          // SHM_CACHE_MAGIC
+    uint32_t version;       // SHM_CACHE_VERSION
+    uint32_t byte_order;    // PCH_BYTE_ORDER
+    uint64_t size;          // Dimensione del segmento
+    uint64_t data_start;    // Inizio dell'area dati
+    uint32_t slot_count;    // SHM_CACHE_SLOTS
+    atomic_uint ready;      // 1 quando l'intestazione è completa
+    _Atomic uint64_t data_used; // Byte riservati nell'area dati (mai restituiti)
+} ShmCacheHeader;
+
+/**
+ * Identità di un header: file (dispositivo, inode, dimensione, data di modifica),
+ * directory di lavoro (gli include annidati sono risolti rispetto a essa) e hash del
+ * nome usato nella direttiva (l'immagine registra il nome nelle diagnostiche).
+ */
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t cwd_dev;
+    uint64_t cwd_ino;
+    uint64_t name_hash;
+} ShmCacheKey;
+
+/**
+ * Voce dell'indice. Una voce viene riservata una sola volta (tag da 0 a hash | writer |
+ * SLOT_WRITING, con un unico compare-and-swap che registra anche chi la elabora) e
+ * pubblicata una sola volta (store con release di hash | SLOT_READY): chiave, offset e
+ * lunghezza sono scritti prima della pubblicazione e non cambiano più, per cui un lettore
+ * che vede SLOT_READY con acquire li legge senza lock.
+ */
+typedef struct {
+    _Atomic uint64_t tag;   // 0 = libera, altrimenti hash della chiave | writer | stato
+    ShmCacheKey key;
+    uint64_t offset;        // Immagine precompilata, relativa all'inizio del segmento
+    uint64_t length;        // Dimensione dell'immagine (0 = header elaborato normalmente)
+} ShmCacheSlot;
+
+/**
+ * Calcola l'hash FNV-1a a 64 bit di un buffer, a partire da un hash precedente.
+ */
+static uint64_t shm_hash(uint64_t h, const void* data, size_t size) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= SHM_FNV_PRIME;
+    }
+    return h;
+}
+
+/**
+ * Parte del tag di una voce ricavata dall'hash della chiave (mai nulla).
+ */
+static uint64_t slot_tag_hash(uint64_t hash) {
+    uint64_t tag_hash = hash & SLOT_HASH_MASK;
+    return tag_hash ? tag_hash : 1ULL << SLOT_HASH_SHIFT;
+}
+
+static ShmCacheSlot* cache_slots(const SharedHeaderCache* cache) {
+    return (ShmCacheSlot*)(cache->base + sizeof(ShmCacheHeader));
+}
+
+/**
+ * Attende circa un millisecondo (mentre un altro processo completa il proprio lavoro).
+ */
+static void shm_pause(void) {
+    struct timespec ts = { 0, 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Legge da /proc lo stato di un processo e l'istante di avvio (in tick dall'avvio del sistema).
+ * @return 0 in caso di successo, -1 se il processo non esiste, -2 se /proc non è leggibile.
+ */
+static int read_process_stat(int pid, char* state, uint64_t* start_time) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* fp = fopen(path, "r");
+    if (!fp) return (errno == ENOENT || errno == ESRCH) ? -1 : -2;
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+    // I campi seguono il nome del comando, racchiuso tra parentesi: stato (3) ... avvio (22)
+    const char* p = strrchr(buf, ')');
+    if (!p || p[1] != ' ') return -2;
+    *state = p[2];
+    p += 2;
+    for (int field = 3; field < 22 && p; ++field) {
+        p = strchr(p, ' ');
+        if (p) p++;
+    }
+    if (!p) return -2;
+    *start_time = strtoull(p, NULL, 10);
+    return 0;
+}
+
+/**
+ * Identità del processo corrente nei tag delle voci riservate: pid (al più 22 bit su Linux)
+ * e 16 bit dell'istante di avvio, che distinguono un pid riutilizzato da un altro processo.
+ */
+static uint64_t current_owner(void) {
+    int pid = (int)getpid();
+    char state;
+    uint64_t start_time = 0;
+    if (read_process_stat(pid, &state, &start_time) != 0) start_time = 0;
+    return ((uint64_t)pid << 16) | (start_time & 0xFFFF);
+}
+
+/**
+ * Indica se il processo che ha riservato una voce è ancora in esecuzione. Un processo
+ * terminato ma non ancora raccolto dal padre (zombie) non pubblicherà più la voce, e un
+ * pid riutilizzato da un processo avviato in un altro istante non è il writer.
+ */
+static bool writer_alive(uint64_t owner) {
+    int pid = (int)(owner >> 16);
+    char state;
+    uint64_t start_time;
+    int result = read_process_stat(pid, &state, &start_time);
+    if (result == -1) return false;
+    if (result == -2) return !(kill(pid, 0) != 0 && errno == ESRCH); // /proc non disponibile
+    return state != 'Z' && state != 'X' && (start_time & 0xFFFF) == (owner & 0xFFFF);
+}
+
+// =====================
+// Apertura del segmento
+// =====================
+
+/**
+ * Apre il segmento di memoria condivisa con il nome indicato; il primo processo che lo
+ * trova assente lo crea e ne inizializza l'intestazione. Un segmento esistente viene
+ * usato con la propria dimensione.
+ * @param cache Cache da inizializzare.
+ * @param name Nome del segmento (NULL = SHM_CACHE_DEFAULT_NAME; '/' iniziale facoltativa).
+ * @param size Dimensione del segmento da creare in byte (0 = SHM_CACHE_DEFAULT_SIZE).
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int open_shared_header_cache(SharedHeaderCache* cache, const char* name, long size) {
+    cache->base = NULL;
+    cache->size = 0;
+
+    struct stat cwd;
+    if (stat(".", &cwd) != 0) {
+        perror("Errore: Impossibile leggere i dati della directory di lavoro");
+        return -1;
+    }
+    cache->cwd_dev = (uint64_t)cwd.st_dev;
+    cache->cwd_ino = (uint64_t)cwd.st_ino;
+    cache->owner = current_owner();
+
+    if (!name) name = SHM_CACHE_DEFAULT_NAME;
+    char path[256];
+    if (snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name) >= (int)sizeof(path) || strchr(path + 1, '/')) {
+        fprintf(stderr, "Errore: Nome del segmento di memoria condivisa non valido: '%s'.\n", name);
+        return -1;
+    }
+
+    size_t data_start = sizeof(ShmCacheHeader) + sizeof(ShmCacheSlot) * SHM_CACHE_SLOTS;
+    data_start = (data_start + SHM_CACHE_ALIGN - 1) / SHM_CACHE_ALIGN * SHM_CACHE_ALIGN;
+    size_t segment_size = (size > 0) ? (size_t)size : (size_t)SHM_CACHE_DEFAULT_SIZE;
+    if (segment_size < data_start * 2) {
+        fprintf(stderr, "Errore: La memoria condivisa deve essere di almeno %zu byte.\n", data_start * 2);
+        return -1;
+    }
+
+    bool created = true;
+    int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        if (ftruncate(fd, (off_t)segment_size) != 0) {
+            fprintf(stderr, "Errore: Impossibile dimensionare la memoria condivisa '%s': %s\n", path, strerror(errno));
+            close(fd);
+            shm_unlink(path);
+            return -1;
+        }
+    } else if (errno == EEXIST) {
+        created = false;
+        fd = shm_open(path, O_RDWR | O_CLOEXEC, 0);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Errore: Impossibile aprire la memoria condivisa '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    // Un segmento appena creato da un altro processo può non essere ancora dimensionato
+    struct stat st;
+    int waited = 0;
+    while (fstat(fd, &st) == 0 && (size_t)st.st_size < data_start * 2 && waited < SHM_CACHE_INIT_WAIT_MS) {
+        shm_pause();
+        waited++;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < data_start * 2) {
+        fprintf(stderr, "Errore: La memoria condivisa '%s' non è stata inizializzata (rimuovere /dev/shm%s).\n", path, path);
+        close(fd);
+        return -1;
+    }
+    char* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Errore: Impossibile mappare la memoria condivisa '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    ShmCacheHeader* h = (ShmCacheHeader*)base;
+    if (created) {
+        // Il segmento nuovo è azzerato: tutte le voci dell'indice sono libere
+        memcpy(h->magic, SHM_CACHE_MAGIC, sizeof(h->magic));
+        h->version = SHM_CACHE_VERSION;
+        h->byte_order = PCH_BYTE_ORDER;
+        h->size = (uint64_t)st.st_size;
+        h->data_start = data_start;
+        h->slot_count = SHM_CACHE_SLOTS;
+        atomic_store_explicit(&h->data_used, 0, memory_order_relaxed);
+        atomic_store_explicit(&h->ready, 1, memory_order_release);
+    } else {
+        while (atomic_load_explicit(&h->ready, memory_order_acquire) != 1 && waited < SHM_CACHE_INIT_WAIT_MS) {
+            shm_pause();
+            waited++;
+        }
+        if (atomic_load_explicit(&h->ready, memory_order_acquire) != 1 || memcmp(h->magic, SHM_CACHE_MAGIC, sizeof(h->magic)) != 0 ||
+            h->version != SHM_CACHE_VERSION || h->byte_order != PCH_BYTE_ORDER || h->size != (uint64_t)st.st_size ||
+            h->data_start != data_start || h->slot_count != SHM_CACHE_SLOTS) {
+            fprintf(stderr, "Errore: La memoria condivisa '%s' non contiene una cache degli header compatibile (rimuovere /dev/shm%s).\n", path, path);
+            munmap(base, (size_t)st.st_size);
+            return -1;
+        }
+    }
+    cache->base = base;
+    cache->size = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * Chiude la mappatura del segmento. Il segmento resta disponibile per gli altri processi
+ * e per le esecuzioni successive: va rimosso esplicitamente (/dev/shm) per svuotarlo.
+ * @param cache Cache da chiudere.
+ */
+void close_shared_header_cache(SharedHeaderCache* cache) {
+    if (cache->base) munmap(cache->base, cache->size);
+    cache->base = NULL;
+    cache->size = 0;
+}
+
+// =====================
+// Ricerca e pubblicazione
+// =====================
+
+/**
+ * Cerca la voce pubblicata con la chiave indicata oppure, se non esiste, riserva la prima
+ * voce libera della sequenza di scansione. Se un altro processo ha riservato una voce con lo
+ * stesso hash la funzione ne attende la pubblicazione, così ogni header viene elaborato da
+ * un solo processo; una voce il cui writer è terminato viene abbandonata e saltata, e dopo
+ * SHM_CACHE_WRITE_WAIT_MS di attesa la voce viene abbandonata comunque.
+ * @param claimed true se la voce restituita è stata riservata dal chiamante.
+ * @return La voce, NULL se l'indice è pieno o l'attesa è scaduta.
+ */
+static ShmCacheSlot* find_or_claim_slot(const SharedHeaderCache* cache, const ShmCacheKey* key, uint64_t hash, bool* claimed) {
+    ShmCacheSlot* slots = cache_slots(cache);
+    uint64_t tag_hash = slot_tag_hash(hash);
+    *claimed = false;
+    int waited = 0;
+
+    for (uint32_t probe = 0; probe < SHM_CACHE_SLOTS;) {
+        ShmCacheSlot* slot = &slots[(hash + probe) % SHM_CACHE_SLOTS];
+        uint64_t tag = atomic_load_explicit(&slot->tag, memory_order_acquire);
+        if (tag == 0) {
+            if (atomic_compare_exchange_strong_explicit(&slot->tag, &tag, tag_hash | (cache->owner << SLOT_OWNER_SHIFT) | SLOT_WRITING,
+                                                        memory_order_acq_rel, memory_order_acquire)) {
+                *claimed = true;
+                return slot;
+            }
+            continue; // Voce riservata da un altro processo nel frattempo: va riletta
+        }
+        if ((tag & SLOT_HASH_MASK) == tag_hash) {
+            uint64_t state = tag & SLOT_STATE_MASK;
+            if (state == SLOT_WRITING) {
+                bool expired = waited >= SHM_CACHE_WRITE_WAIT_MS;
+                if (expired || !writer_alive((tag & SLOT_OWNER_MASK) >> SLOT_OWNER_SHIFT)) {
+                    // Un writer ancora attivo pubblica comunque la voce al termine
+                    atomic_compare_exchange_strong_explicit(&slot->tag, &tag, tag_hash | SLOT_ABANDONED, memory_order_acq_rel, memory_order_relaxed);
+                    if (expired) return NULL; // L'header viene elaborato normalmente
+                } else {
+                    shm_pause();
+                    waited++;
+                }
+                continue;
+            }
+            if (state == SLOT_READY && memcmp(&slot->key, key, sizeof(*key)) == 0) return slot;
+        }
+        probe++;
+    }
+    return NULL;
+}
+
+/**
+ * Se il segmento condiviso contiene l'header già elaborato (stesso file, non modificato,
+ * incluso con lo stesso nome dalla stessa directory di lavoro), ne applica l'immagine
+ * precompilata senza leggere né analizzare il file. Altrimenti il primo processo che lo
+ * incontra lo precompila, pubblica l'immagine e la applica; i processi che lo includono
+ * nel frattempo ne attendono la pubblicazione invece di elaborarlo a loro volta.
+ * Un'immagine pubblicata che non è più aggiornata (è cambiata una dipendenza annidata)
+ * viene abbandonata e l'header ripubblicato in una nuova voce.
+ * @param filename Nome del file incluso.
+ * @param out_stream Stream di output.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param depth Profondità di inclusione del file.
+ * @return 1 se l'immagine è stata applicata, 0 se l'header va elaborato normalmente
+ *         (cache piena, header non precompilabile o non aggiornato), -1 in caso di errore
+ *         di scrittura.
+ */
+int use_shared_header(const char* filename, FILE* out_stream, ProcessingStats* stats, int depth) {
+    SharedHeaderCache* cache = stats->options ? stats->options->shm_cache : NULL;
+    if (!cache || !cache->base || !precompiled_replay_allowed(stats)) return 0;
+
+    // Un file inesistente viene segnalato dall'elaborazione normale
+    struct stat st;
+    if (stat(filename, &st) != 0) return 0;
+    ShmCacheKey key;
+    memset(&key, 0, sizeof(key));
+    key.dev = (uint64_t)st.st_dev;
+    key.ino = (uint64_t)st.st_ino;
+    key.size = (int64_t)st.st_size;
+    key.mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    key.mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    key.cwd_dev = cache->cwd_dev;
+    key.cwd_ino = cache->cwd_ino;
+    key.name_hash = shm_hash(SHM_FNV_OFFSET, filename, strlen(filename));
+    uint64_t hash = shm_hash(SHM_FNV_OFFSET, &key, sizeof(key));
+
+    ShmCacheHeader* h = (ShmCacheHeader*)cache->base;
+    bool claimed = false;
+    ShmCacheSlot* slot = NULL;
+    for (int attempt = 0;; ++attempt) {
+        slot = find_or_claim_slot(cache, &key, hash, &claimed);
+        if (!slot) return 0;
+        if (claimed) break;
+
+        // Voce pubblicata: l'immagine viene comunque verificata prima dell'uso
+        if (slot->length == 0 || slot->offset < h->data_start || slot->offset > cache->size ||
+            slot->length > cache->size - slot->offset) {
+            return 0;
+        }
+        int result = apply_precompiled_image(cache->base + slot->offset, (size_t)slot->length, filename, out_stream, stats, depth);
+        if (result == 1) stats->shm_loaded++;
+        if (result != 0 || attempt >= SHM_CACHE_STALE_RETRIES) return result;
+
+        // Immagine non aggiornata: la voce pubblicata non cambia più, quindi viene
+        // abbandonata (da un solo processo) e la ricerca riservata una voce nuova
+        uint64_t ready = slot_tag_hash(hash) | SLOT_READY;
+        atomic_compare_exchange_strong_explicit(&slot->tag, &ready, slot_tag_hash(hash) | SLOT_ABANDONED, memory_order_acq_rel, memory_order_relaxed);
+    }
+
+    // Voce riservata: l'header viene precompilato e l'immagine copiata nell'area dati.
+    // Se l'header non è precompilabile o l'area dati è esaurita la voce viene pubblicata
+    // vuota, così gli altri processi lo elaborano subito senza attendere né riprovare.
+    char* image = NULL;
+    size_t image_size = 0;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    if (build_precompiled_image(filename, stats->options, false, &image, &image_size) == 0) {
+        uint64_t reserved = (image_size + SHM_CACHE_ALIGN - 1) / SHM_CACHE_ALIGN * SHM_CACHE_ALIGN;
+        uint64_t used = atomic_fetch_add_explicit(&h->data_used, reserved, memory_order_relaxed);
+        if (used + image_size <= cache->size - h->data_start) {
+            offset = h->data_start + used;
+            length = image_size;
+            memcpy(cache->base + offset, image, image_size);
+        }
+    }
+    slot->key = key;
+    slot->offset = offset;
+    slot->length = length;
+    atomic_store_explicit(&slot->tag, slot_tag_hash(hash) | SLOT_READY, memory_order_release);
+
+    int result = 0;
+    if (image) {
+        if (length > 0) stats->shm_published++;
+        result = apply_precompiled_image(image, image_size, filename, out_stream, stats, depth);
+        free(image);
+    }
+    return result;
+}
@@ -4,6 +4,7 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <time.h>
 #include "myPreCompiler.h"
 
 /**
@@ -16,13 +17,18 @@ void init_stats(ProcessingStats* stats, bool verbose_mode) {
     stats->vars_checked = 0;
     stats->errors_found = 0;
     stats->errors = NULL;
+    stats->errors_retained = 0;
     stats->error_capacity = 0;
+    memset(&stats->error_sink, 0, sizeof(stats->error_sink));
+    stats->error_sink.dedup = true;
+    stats->error_sink.max_retained = -1;
     stats->comments_removed = 0;
     stats->includes_processed = 0;
 
     // Inizializza le statistiche del file di input
     stats->input_file_stats.filename = NULL;
     stats->input_file_stats.size_bytes = 0;
+    stats->input_file_stats.compressed_bytes = 0;
     stats->input_file_stats.lines = 0;
 
     stats->included_files_stats = NULL;
@@ -30,66 +36,331 @@ void init_stats(ProcessingStats* stats, bool verbose_mode) {
 
     stats->output_lines = 0;
     stats->output_size_bytes = 0;
+    stats->output_compressed_bytes = 0;
+    stats->pch_loaded = 0;
+    stats->shm_loaded = 0;
+    stats->shm_published = 0;
+    memset(&stats->minify, 0, sizeof(stats->minify));
 
     stats->verbose = verbose_mode;
+    stats->options = NULL;
+    init_declaration_analyzer(&stats->analyzer);
 }
 
+// Parametri dell'hash FNV-1a a 64 bit delle coppie (file, identificatore)
+#define ERROR_FNV_OFFSET 14695981039346656037ULL
+#define ERROR_FNV_PRIME 1099511628211ULL
+
 /**
- * Registra un errore relativo a un identificatore non valido.
- * Rialloca l'array dinamico se necessario.
- * @param stats Puntatore alla struttura delle statistiche.
- * @param filename Nome del file dove si trova l'errore.
- * @param line Numero di riga dell'errore.
- * @param identifier Nome dell'identificatore errato.
+ * Calcola la chiave di accorpamento di un errore: hash di file, identificatore e tipo.
+ * Le collisioni a 64 bit sono trascurate. Il valore 0 è riservato alle posizioni libere.
  */
-void add_identifier_error(ProcessingStats* stats, const char* filename, int line, const char* identifier) {
-    stats->errors_found++;
-    if (stats->errors_found > stats->error_capacity) {
-        int new_capacity = (stats->error_capacity == 0) ? 10 : stats->error_capacity * 2;
-        IdentifierError* new_errors = realloc(stats->errors, new_capacity * sizeof(IdentifierError));
-        if (!new_errors) {
-            perror("Errore: Impossibile riallocare memoria per gli errori");
-            stats->errors_found--;
-            return;
-        }
-        stats->errors = new_errors;
-        stats->error_capacity = new_capacity;
+static uint64_t error_key(const char* filename, const char* identifier, IdentifierErrorKind kind) {
+    uint64_t h = ERROR_FNV_OFFSET;
+    for (const char* p = filename; *p; ++p) {
+        h ^= (unsigned char)*p;
+        h *= ERROR_FNV_PRIME;
+    }
+    h ^= 0xff; // Separatore: non compare in nomi di file e identificatori UTF-8
+    h *= ERROR_FNV_PRIME;
+    for (const char* p = identifier; *p; ++p) {
+        h ^= (unsigned char)*p;
+        h *= ERROR_FNV_PRIME;
+    }
+    h ^= (uint64_t)kind + 1;
+    h *= ERROR_FNV_PRIME;
+    return h ? h : 1;
+}
+
+/**
+ * Cerca una coppia nell'insieme degli errori già segnalati.
+ * @return La posizione della coppia, o la posizione libera in cui inserirla.
+ */
+static ErrorSeenSlot* find_seen_slot(ErrorSink* sink, uint64_t key) {
+    uint64_t mask = (uint64_t)sink->seen_capacity - 1;
+    uint64_t i = key & mask;
+    while (sink->seen[i].key != 0 && sink->seen[i].key != key) {
+        i = (i + 1) & mask;
     }
+    return &sink->seen[i];
+}
+
+/**
+ * Raddoppia l'insieme delle coppie segnalate, reinserendo quelle presenti.
+ * @return true in caso di successo, false se la memoria è esaurita.
+ */
+static bool grow_seen_set(ErrorSink* sink) {
+    int new_capacity = (sink->seen_capacity == 0) ? 64 : sink->seen_capacity * 2;
+    ErrorSeenSlot* old_seen = sink->seen;
+    int old_capacity = sink->seen_capacity;
+    ErrorSeenSlot* new_seen = mem_calloc((size_t)new_capacity, sizeof(ErrorSeenSlot));
+    if (!new_seen) return false;
+    sink->seen = new_seen;
+    sink->seen_capacity = new_capacity;
+    for (int i = 0; i < old_capacity; ++i) {
+        if (old_seen[i].key != 0) *find_seen_slot(sink, old_seen[i].key) = old_seen[i];
+    }
+    mem_free(old_seen);
+    return true;
+}
 
-    int current_error_index = stats->errors_found - 1;
+/**
+ * Ordine del min-heap degli errori mantenuti: prima le coppie meno frequenti e, a
+ * parità, quelle rilevate più tardi (le prime a essere scartate).
+ */
+static bool error_less(const IdentifierError* a, const IdentifierError* b) {
+    if (a->occurrences != b->occurrences) return a->occurrences < b->occurrences;
+    return a->sequence > b->sequence;
+}
+
+/**
+ * Fa scendere un elemento nel min-heap degli errori mantenuti, aggiornando la posizione
+ * registrata nell'insieme delle coppie.
+ */
+static void sift_down_error(ProcessingStats* stats, int i) {
+    int n = stats->errors_retained;
+    IdentifierError* heap = stats->errors;
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < n && error_less(&heap[left], &heap[smallest])) smallest = left;
+        if (right < n && error_less(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == i) break;
+        IdentifierError tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        find_seen_slot(&stats->error_sink, heap[i].key)->retained = i;
+        find_seen_slot(&stats->error_sink, heap[smallest].key)->retained = smallest;
+        i = smallest;
+    }
+}
+
+/**
+ * Copia file e identificatore in un errore (con fallback in caso di errore di allocazione).
+ */
+static void store_error(IdentifierError* error, const char* filename, int line, const char* identifier, IdentifierErrorKind kind) {
+    error->line_number = line;
+    error->kind = kind;
 
     // Alloca e copia il nome del file
     size_t filename_len = strlen(filename);
-    stats->errors[current_error_index].filename = malloc(filename_len + 1);
-    if (stats->errors[current_error_index].filename) {
-        strcpy(stats->errors[current_error_index].filename, filename);
+    error->filename = mem_alloc(filename_len + 1);
+    if (error->filename) {
+        strcpy(error->filename, filename);
     } else {
         perror("malloc fallito per filename in add_identifier_error");
-        stats->errors[current_error_index].filename = NULL;
+        error->filename = NULL;
     }
 
     // Alloca e copia il nome dell'identificatore
     size_t identifier_len = strlen(identifier);
-    stats->errors[current_error_index].identifier_name = malloc(identifier_len + 1);
-    if (stats->errors[current_error_index].identifier_name) {
-        strcpy(stats->errors[current_error_index].identifier_name, identifier);
+    error->identifier_name = mem_alloc(identifier_len + 1);
+    if (error->identifier_name) {
+        strcpy(error->identifier_name, identifier);
     } else {
         perror("malloc fallito per identifier_name in add_identifier_error");
-        stats->errors[current_error_index].identifier_name = NULL;
+        error->identifier_name = NULL;
     }
 
     // Fallback per filename in caso di errore di allocazione
-    if (!stats->errors[current_error_index].filename) {
+    if (!error->filename) {
         const char* error_str = "(alloc error)";
         size_t error_str_len = strlen(error_str);
-        stats->errors[current_error_index].filename = malloc(error_str_len + 1);
-        if (stats->errors[current_error_index].filename) {
-            strcpy(stats->errors[current_error_index].filename, error_str);
+        error->filename = mem_alloc(error_str_len + 1);
+        if (error->filename) {
+            strcpy(error->filename, error_str);
         }
     }
     // Nessun fallback per identifier_name: già segnalato da perror
 }
 
+/**
+ * Passa la raccolta degli errori allo streaming per restare entro il budget di memoria:
+ * gli errori già mantenuti restano in memoria (come min-heap delle coppie più frequenti),
+ * le nuove coppie vengono solo scritte, su stderr se non è configurato un writer.
+ */
+static void spill_error_sink(ProcessingStats* stats) {
+    ErrorSink* sink = &stats->error_sink;
+    sink->spilled = true;
+    if (!sink->write) {
+        sink->write = write_error_to_stream;
+        sink->context = stderr;
+    }
+    if (sink->max_retained < 0 || sink->max_retained > stats->errors_retained) {
+        sink->max_retained = stats->errors_retained;
+        for (int i = stats->errors_retained / 2 - 1; i >= 0; --i) {
+            sift_down_error(stats, i);
+        }
+        // Lo spazio libero dell'array non verrà più usato
+        if (stats->errors_retained > 0 && stats->error_capacity > stats->errors_retained) {
+            IdentifierError* shrunk = mem_realloc(stats->errors, (size_t)stats->errors_retained * sizeof(IdentifierError));
+            if (shrunk) {
+                stats->errors = shrunk;
+                stats->error_capacity = stats->errors_retained;
+            }
+        }
+    }
+    note_memory_fallback(MEMORY_ERRORS_STREAMED, 0);
+    fprintf(stderr, "Attenzione: Memoria vicina al budget: i nuovi errori sugli identificatori vengono scritti subito e non mantenuti.\n");
+}
+
+/**
+ * Configura la destinazione degli errori. Va chiamata prima dell'elaborazione.
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param write Writer che riceve ogni nuova coppia al momento del rilevamento (NULL = nessuno).
+ * @param context Argomento passato al writer.
+ * @param dedup Se true, le occorrenze ripetute di una coppia (file, identificatore) sono accorpate.
+ * @param max_retained Numero massimo di errori mantenuti in memoria (-1 = nessun limite).
+ */
+void configure_error_sink(ProcessingStats* stats, ErrorSinkWriter write, void* context, bool dedup, int max_retained) {
+    stats->error_sink.write = write;
+    stats->error_sink.context = context;
+    stats->error_sink.dedup = dedup;
+    stats->error_sink.max_retained = max_retained;
+}
+
+/**
+ * Registra un errore rilevato dall'analisi delle dichiarazioni.
+ * Ogni occorrenza è conteggiata nei totali; una coppia (file, identificatore) già vista
+ * incrementa solo le occorrenze. Le coppie nuove sono inviate al writer in streaming e
+ * mantenute in memoria finché c'è spazio; oltre il limite restano in memoria le coppie
+ * più frequenti (min-heap per numero di occorrenze).
+ * @param stats Puntatore alla struttura delle statistiche.
+ * @param filename Nome del file dove si trova l'errore.
+ * @param line Numero di riga dell'errore.
+ * @param identifier Nome dell'identificatore errato.
+ * @param kind Tipo di errore (non valido, duplicato, occultamento).
+ */
+void add_identifier_error(ProcessingStats* stats, const char* filename, int line, const char* identifier, IdentifierErrorKind kind) {
+    ErrorSink* sink = &stats->error_sink;
+    stats->errors_found++;
+    if (kind <= ERR_SHADOWED_DECLARATION) sink->kind_totals[kind]++;
+
+    // Il min-heap è attivo quando il limite di errori in memoria è raggiunto
+    bool heap_full = sink->dedup && sink->max_retained >= 0 && stats->errors_retained >= sink->max_retained;
+    uint64_t key = 0;
+    ErrorSeenSlot* slot = NULL;
+    if (sink->dedup) {
+        key = error_key(filename, identifier, kind);
+        if ((sink->seen_count + 1) * 2 > sink->seen_capacity && !grow_seen_set(sink)) {
+            perror("Errore: Impossibile riallocare memoria per l'insieme degli errori");
+            return;
+        }
+        slot = find_seen_slot(sink, key);
+        if (slot->key == key) {
+            slot->occurrences++;
+            if (slot->retained >= 0) {
+                stats->errors[slot->retained].occurrences = slot->occurrences;
+                if (heap_full) sift_down_error(stats, slot->retained);
+            } else if (heap_full && stats->errors_retained > 0 && slot->occurrences > stats->errors[0].occurrences) {
+                // La coppia supera la meno frequente tra quelle mantenute: la sostituisce
+                IdentifierError* least = &stats->errors[0];
+                find_seen_slot(sink, least->key)->retained = -1;
+                mem_free(least->filename);
+                mem_free(least->identifier_name);
+                // La voce conserva la prima occorrenza, come se fosse stata mantenuta da subito
+                store_error(least, filename, slot->first_line, identifier, kind);
+                least->occurrences = slot->occurrences;
+                least->sequence = slot->first_sequence;
+                least->key = key;
+                slot->retained = 0;
+                sift_down_error(stats, 0);
+            }
+            return;
+        }
+        slot->key = key;
+        slot->occurrences = 1;
+        slot->retained = -1;
+        sink->seen_count++;
+    }
+
+    // Nuova coppia: vicino al budget di memoria la raccolta passa allo streaming
+    // (gli errori non accorpati dei .pch vanno invece conservati tutti)
+    if (sink->dedup && !sink->spilled && memory_pressure(0)) spill_error_sink(stats);
+
+    // Streaming immediato e mantenimento in memoria se c'è spazio
+    long sequence = sink->next_sequence++;
+    if (slot) {
+        slot->first_line = line;
+        slot->first_sequence = sequence;
+    }
+    if (sink->write) {
+        IdentifierError event = { (char*)filename, line, (char*)identifier, kind, 1, sequence, key };
+        sink->write(sink->context, &event);
+    }
+    if (sink->max_retained >= 0 && stats->errors_retained >= sink->max_retained) return;
+
+    if (stats->errors_retained + 1 > stats->error_capacity) {
+        int new_capacity = (stats->error_capacity == 0) ? 10 : stats->error_capacity * 2;
+        IdentifierError* new_errors = mem_realloc(stats->errors, new_capacity * sizeof(IdentifierError));
+        if (!new_errors) {
+            perror("Errore: Impossibile riallocare memoria per gli errori");
+            return;
+        }
+        stats->errors = new_errors;
+        stats->error_capacity = new_capacity;
+    }
+
+    int index = stats->errors_retained++;
+    IdentifierError* error = &stats->errors[index];
+    store_error(error, filename, line, identifier, kind);
+    error->occurrences = 1;
+    error->sequence = sequence;
+    error->key = key;
+    if (slot) slot->retained = index;
+
+    // Limite raggiunto: gli errori mantenuti diventano un min-heap per occorrenze
+    if (sink->dedup && stats->errors_retained == sink->max_retained) {
+        for (int i = stats->errors_retained / 2 - 1; i >= 0; --i) {
+            sift_down_error(stats, i);
+        }
+    }
+}
+
+/**
+ * Stampa una diagnostica nello stesso formato del riepilogo finale.
+ * @param stream Stream di destinazione.
+ * @param error Errore da stampare.
+ */
+static void print_identifier_error(FILE* stream, const IdentifierError* error) {
+    const char* err_fname = error->filename ? error->filename : "(sconosciuto o errore allocazione)";
+    const char* err_id = error->identifier_name ? error->identifier_name : "(sconosciuto o errore allocazione)";
+    switch (error->kind) {
+        case ERR_DUPLICATE_DECLARATION:
+            fprintf(stream, "  - Errore: Dichiarazione duplicata di '%s' nel file '%s' alla riga %d", err_id, err_fname, error->line_number);
+            break;
+        case ERR_SHADOWED_DECLARATION:
+            fprintf(stream, "  - Attenzione: La dichiarazione di '%s' nasconde una dichiarazione esterna nel file '%s' alla riga %d", err_id, err_fname, error->line_number);
+            break;
+        default:
+            fprintf(stream, "  - Errore: Identificatore non valido '%s' nel file '%s' alla riga %d", err_id, err_fname, error->line_number);
+            break;
+    }
+    if (error->occurrences > 1) {
+        fprintf(stream, " (%d occorrenze)", error->occurrences);
+    }
+    fputc('\n', stream);
+}
+
+/**
+ * Writer in streaming delle diagnostiche: stampa l'errore sullo stream passato come contesto.
+ * @param context Stream di destinazione (FILE*).
+ * @param error Errore appena rilevato.
+ */
+void write_error_to_stream(void* context, const IdentifierError* error) {
+    print_identifier_error((FILE*)context, error);
+}
+
+/**
+ * Ordina gli errori mantenuti per ordine di rilevamento.
+ */
+static int compare_error_sequence(const void* a, const void* b) {
+    const IdentifierError* ea = *(const IdentifierError* const*)a;
+    const IdentifierError* eb = *(const IdentifierError* const*)b;
+    return (ea->sequence > eb->sequence) - (ea->sequence < eb->sequence);
+}
+
 /**
  * Aggiunge le statistiche di un file incluso all'array dinamico.
  * Rialloca l'array se necessario.
@@ -98,12 +369,12 @@ void add_identifier_error(ProcessingStats* stats, const char* filename, int line
  * @param size Dimensione del file in byte.
  * @param lines Numero di righe del file.
  */
-void add_included_file_stats(ProcessingStats* stats, const char* filename, long size, int lines) {
+void add_included_file_stats(ProcessingStats* stats, const char* filename, long size, long compressed_size, int lines) {
     int index = stats->includes_processed - 1; // Indice dove inserire (0-based)
 
     if (stats->includes_processed > stats->included_files_capacity) {
         int new_capacity = (stats->included_files_capacity == 0) ? 5 : stats->included_files_capacity * 2;
-        FileStats* new_included_stats = realloc(stats->included_files_stats, new_capacity * sizeof(FileStats));
+        FileStats* new_included_stats = mem_realloc(stats->included_files_stats, new_capacity * sizeof(FileStats));
         if (!new_included_stats) {
             perror("Errore: Impossibile riallocare memoria per le statistiche dei file inclusi");
             stats->includes_processed--;
@@ -120,7 +391,7 @@ void add_included_file_stats(ProcessingStats* stats, const char* filename, long
 
     // Alloca e copia il nome del file incluso
     size_t filename_len = strlen(filename);
-    stats->included_files_stats[index].filename = malloc(filename_len + 1);
+    stats->included_files_stats[index].filename = mem_alloc(filename_len + 1);
     if (stats->included_files_stats[index].filename) {
         strcpy(stats->included_files_stats[index].filename, filename);
     } else {
@@ -129,13 +400,14 @@ void add_included_file_stats(ProcessingStats* stats, const char* filename, long
     }
 
     stats->included_files_stats[index].size_bytes = size;
+    stats->included_files_stats[index].compressed_bytes = compressed_size;
     stats->included_files_stats[index].lines = lines;
 
     // Fallback per filename in caso di errore di allocazione
     if (!stats->included_files_stats[index].filename) {
         const char* error_str = "(alloc error)";
         size_t error_str_len = strlen(error_str);
-        stats->included_files_stats[index].filename = malloc(error_str_len + 1);
+        stats->included_files_stats[index].filename = mem_alloc(error_str_len + 1);
         if (stats->included_files_stats[index].filename) {
             strcpy(stats->included_files_stats[index].filename, error_str);
         }
@@ -158,6 +430,9 @@ void print_stats(const ProcessingStats* stats, FILE* stream) {
     if (stats->input_file_stats.filename) {
         fprintf(stream, "  Nome: %s\n", stats->input_file_stats.filename);
         fprintf(stream, "  Dimensione (pre): %ld bytes\n", stats->input_file_stats.size_bytes);
+        if (stats->input_file_stats.compressed_bytes > 0) {
+            fprintf(stream, "  Dimensione compressa: %ld bytes\n", stats->input_file_stats.compressed_bytes);
+        }
         fprintf(stream, "  Righe (pre): %d\n", stats->input_file_stats.lines);
     } else {
         fprintf(stream, "  (Statistiche file input non disponibili)\n");
@@ -169,20 +444,32 @@ void print_stats(const ProcessingStats* stats, FILE* stream) {
         const char* fname = (stats->included_files_stats && stats->included_files_stats[i].filename) ? stats->included_files_stats[i].filename : "(sconosciuto o errore allocazione)";
         fprintf(stream, "  - Nome: %s\n", fname);
         fprintf(stream, "    Dimensione (pre): %ld bytes\n", (stats->included_files_stats ? stats->included_files_stats[i].size_bytes : -1));
+        if (stats->included_files_stats && stats->included_files_stats[i].compressed_bytes > 0) {
+            fprintf(stream, "    Dimensione compressa: %ld bytes\n", stats->included_files_stats[i].compressed_bytes);
+        }
         fprintf(stream, "    Righe (pre): %d\n", (stats->included_files_stats ? stats->included_files_stats[i].lines : -1));
     }
 
     // Variabili ed Errori
     fprintf(stream, "Controllo Variabili:\n");
     fprintf(stream, "  Variabili controllate: %d\n", stats->vars_checked);
+    const int* kind_totals = stats->error_sink.kind_totals;
     fprintf(stream, "  Errori identificatore rilevati: %d\n", stats->errors_found);
-    for (int i = 0; i < stats->errors_found; ++i) {
-        const char* err_fname = (stats->errors && stats->errors[i].filename) ? stats->errors[i].filename : "(sconosciuto o errore allocazione)";
-        const char* err_id = (stats->errors && stats->errors[i].identifier_name) ? stats->errors[i].identifier_name : "(sconosciuto o errore allocazione)";
-        fprintf(stream, "  - Errore: Identificatore non valido '%s' nel file '%s' alla riga %d\n",
-                err_id,
-                err_fname,
-                (stats->errors ? stats->errors[i].line_number : -1));
+    fprintf(stream, "    (non validi: %d, duplicati: %d, occultamenti: %d)\n", kind_totals[ERR_INVALID_IDENTIFIER], kind_totals[ERR_DUPLICATE_DECLARATION], kind_totals[ERR_SHADOWED_DECLARATION]);
+    int distinct = stats->error_sink.dedup ? stats->error_sink.seen_count : stats->errors_found;
+    if (distinct != stats->errors_found || stats->errors_retained < distinct) {
+        fprintf(stream, "    (segnalazioni distinte: %d, mostrate: %d)\n", distinct, stats->errors_retained);
+    }
+
+    // Errori mantenuti, nell'ordine di rilevamento (il limite in memoria li riordina)
+    const IdentifierError** ordered = malloc((size_t)(stats->errors_retained > 0 ? stats->errors_retained : 1) * sizeof(IdentifierError*));
+    if (ordered) {
+        for (int i = 0; i < stats->errors_retained; ++i) ordered[i] = &stats->errors[i];
+        qsort(ordered, (size_t)stats->errors_retained, sizeof(IdentifierError*), compare_error_sequence);
+        for (int i = 0; i < stats->errors_retained; ++i) print_identifier_error(stream, ordered[i]);
+        free(ordered);
+    } else {
+        for (int i = 0; i < stats->errors_retained; ++i) print_identifier_error(stream, &stats->errors[i]);
     }
 
     // Commenti
@@ -193,6 +480,37 @@ void print_stats(const ProcessingStats* stats, FILE* stream) {
     fprintf(stream, "Output:\n");
     fprintf(stream, "  Righe totali: %d\n", stats->output_lines);
     fprintf(stream, "  Dimensione totale: %ld bytes\n", stats->output_size_bytes);
+    if (stats->output_compressed_bytes > 0) {
+        fprintf(stream, "  Dimensione compressa: %ld bytes\n", stats->output_compressed_bytes);
+    }
+    if (stats->options && stats->options->minify) {
+        long before = stats->output_size_bytes + stats->minify.bytes_saved;
+        fprintf(stream, "  Byte risparmiati dalla minificazione: %ld (%.1f%%)\n", stats->minify.bytes_saved,
+                before > 0 ? 100.0 * (double)stats->minify.bytes_saved / (double)before : 0.0);
+        if (stats->options->line_markers) {
+            fprintf(stream, "  Marcatori #line: %d\n", stats->minify.markers);
+        }
+    }
+    if (stats->pch_loaded > 0) {
+        fprintf(stream, "Header precompilati usati: %d\n", stats->pch_loaded);
+    }
+    if (stats->shm_loaded > 0 || stats->shm_published > 0) {
+        fprintf(stream, "Header dalla memoria condivisa: %d (pubblicati: %d)\n", stats->shm_loaded, stats->shm_published);
+    }
+
+    // Memoria allocata dalle strutture del precompilatore
+    MemoryStats memory;
+    get_memory_stats(&memory);
+    fprintf(stream, "Memoria:\n");
+    fprintf(stream, "  In uso: %ld bytes\n", memory.live_bytes);
+    fprintf(stream, "  Picco: %ld bytes\n", memory.peak_bytes);
+    if (memory.budget_bytes > 0) {
+        fprintf(stream, "  Budget: %ld bytes\n", memory.budget_bytes);
+        fprintf(stream, "  File rimossi dalla cache: %d (%ld bytes)\n", memory.evicted_files, memory.evicted_bytes);
+        fprintf(stream, "  File letti in anticipo e non tenuti in cache: %d\n", memory.skipped_prefetch);
+        fprintf(stream, "  Ondate di rimozione parallela con meno chunk: %d\n", memory.reduced_buffers);
+        fprintf(stream, "  Errori in streaming: %s\n", memory.errors_streamed ? "sì" : "no");
+    }
 
     fprintf(stream, "--- Fine Statistiche ---\n");
 }
@@ -210,31 +528,141 @@ void free_stats(ProcessingStats* stats) {
     stats->input_file_stats.filename = NULL;
 
     // Libera memoria per ogni errore registrato
-    for (int i = 0; i < stats->errors_found; ++i) {
-        free(stats->errors[i].filename);
-        free(stats->errors[i].identifier_name);
+    for (int i = 0; i < stats->errors_retained; ++i) {
+        mem_free(stats->errors[i].filename);
+        mem_free(stats->errors[i].identifier_name);
     }
-    free(stats->errors);
+    mem_free(stats->errors);
     stats->errors = NULL;
     stats->errors_found = 0;
+    stats->errors_retained = 0;
     stats->error_capacity = 0;
+    mem_free(stats->error_sink.seen);
+    stats->error_sink.seen = NULL;
+    stats->error_sink.seen_capacity = 0;
+    stats->error_sink.seen_count = 0;
+    memset(stats->error_sink.kind_totals, 0, sizeof(stats->error_sink.kind_totals));
+    stats->error_sink.next_sequence = 0;
 
     // Libera memoria per ogni file incluso registrato
     for (int i = 0; i < stats->includes_processed; ++i) {
         if (stats->included_files_stats && stats->included_files_stats[i].filename) {
-            free(stats->included_files_stats[i].filename);
+            mem_free(stats->included_files_stats[i].filename);
         }
     }
-    free(stats->included_files_stats);
+    mem_free(stats->included_files_stats);
     stats->included_files_stats = NULL;
     stats->includes_processed = 0;
     stats->included_files_capacity = 0;
 
+    // Libera lo stato della minificazione
+    free(stats->minify.marker_filename);
+    memset(&stats->minify, 0, sizeof(stats->minify));
+
+    // Libera scope e simboli dell'analisi delle dichiarazioni
+    free_declaration_analyzer(&stats->analyzer);
+
     // Resetta i contatori semplici
     stats->vars_checked = 0;
     stats->comments_removed = 0;
     stats->output_lines = 0;
     stats->output_size_bytes = 0;
+    stats->output_compressed_bytes = 0;
+}
+
+/**
+ * Inizializza un grafo delle inclusioni vuoto.
+ * @param graph Puntatore al grafo da inizializzare.
+ */
+void init_include_graph(IncludeGraph* graph) {
+    graph->nodes = NULL;
+    graph->count = 0;
+    graph->capacity = 0;
+    graph->current = -1;
+    graph->next_include_line = 0;
+}
+
+/**
+ * Libera tutta la memoria allocata dinamicamente nel grafo delle inclusioni.
+ * @param graph Puntatore al grafo da liberare.
+ */
+void free_include_graph(IncludeGraph* graph) {
+    if (!graph) return;
+    for (int i = 0; i < graph->count; ++i) {
+        mem_free(graph->nodes[i].filename);
+    }
+    mem_free(graph->nodes);
+    init_include_graph(graph);
+}
+
+/**
+ * Istante corrente in nanosecondi (CLOCK_MONOTONIC), per i tempi del grafo delle inclusioni
+ * e del rapporto di avanzamento.
+ */
+uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Registra l'inizio dell'elaborazione di un file come figlio del nodo corrente.
+ * La riga della direttiva viene presa da next_include_line, impostata dal chiamante.
+ * @param graph Puntatore al grafo.
+ * @param filename Nome del file.
+ * @param depth Profondità di inclusione.
+ * @param output_offset Byte scritti in output fino a questo momento.
+ * @param output_lines Righe scritte in output fino a questo momento.
+ * @return Indice del nuovo nodo, -1 in caso di errore di allocazione.
+ */
+int include_graph_enter(IncludeGraph* graph, const char* filename, int depth, long output_offset, int output_lines) {
+    if (graph->count >= graph->capacity) {
+        int new_capacity = (graph->capacity == 0) ? 16 : graph->capacity * 2;
+        IncludeNode* new_nodes = mem_realloc(graph->nodes, new_capacity * sizeof(IncludeNode));
+        if (!new_nodes) {
+            perror("Errore: Impossibile riallocare memoria per il grafo delle inclusioni");
+            return -1;
+        }
+        graph->nodes = new_nodes;
+        graph->capacity = new_capacity;
+    }
+
+    char* name_copy = mem_alloc(strlen(filename) + 1);
+    if (!name_copy) {
+        perror("malloc fallito per filename in include_graph_enter");
+        return -1;
+    }
+    strcpy(name_copy, filename);
+
+    int index = graph->count++;
+    IncludeNode* node = &graph->nodes[index];
+    node->filename = name_copy;
+    node->depth = depth;
+    node->parent = graph->current;
+    node->include_line = (graph->current >= 0) ? graph->next_include_line : 0;
+    node->output_start = output_offset;
+    node->output_end = output_offset;
+    node->lines_start = output_lines;
+    node->lines_end = output_lines;
+    node->time_start_ns = monotonic_ns();
+    node->time_end_ns = node->time_start_ns;
+    graph->current = index;
+    return index;
+}
+
+/**
+ * Registra la fine dell'elaborazione di un nodo e torna al nodo padre.
+ * @param graph Puntatore al grafo.
+ * @param node Indice restituito da include_graph_enter (-1 viene ignorato).
+ * @param output_offset Byte scritti in output fino a questo momento.
+ * @param output_lines Righe scritte in output fino a questo momento.
+ */
+void include_graph_leave(IncludeGraph* graph, int node, long output_offset, int output_lines) {
+    if (node < 0) return;
+    graph->nodes[node].output_end = output_offset;
+    graph->nodes[node].lines_end = output_lines;
+    graph->nodes[node].time_end_ns = monotonic_ns();
+    graph->current = graph->nodes[node].parent;
 }
 
 /**
@@ -0,0 +1,489 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/inotify.h>
+#include "myPreCompiler.h"
+
+// Attesa (ms) dopo il primo evento per raggruppare le modifiche ravvicinate
+#define WATCH_DEBOUNCE_MS 100
+// Eventi inotify che indicano il salvataggio di un file (anche tramite rinomina atomica)
+#define WATCH_EVENT_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE)
+
+// Directory osservata da inotify
+typedef struct {
+    int wd;                 // Descrittore restituito da inotify_add_watch
+    char* path;             // Percorso assoluto della directory
+} WatchedDir;
+
+// Stato della modalità watch
+typedef struct {
+    const char* input_filename;
+    const char* output_filename;
+    ProcessingOptions options;  // Opzioni usate per le rigenerazioni (senza cache dei file)
+    bool verbose;
+
+    char* output;               // Output completo corrente
+    size_t output_size;
+    IncludeGraph graph;         // Grafo delle inclusioni con gli offset dei segmenti in output
+
+    int inotify_fd;
+    WatchedDir* dirs;
+    int dir_count;
+    int dir_capacity;
+
+    char** changed;             // Percorsi assoluti dei file modificati (in attesa di rigenerazione)
+    int changed_count;
+    int changed_capacity;
+} WatchState;
+
+static volatile sig_atomic_t watch_stop_requested = 0;
+
+/**
+ * Gestore di SIGINT/SIGTERM: richiede l'uscita dal ciclo di osservazione.
+ */
+static void watch_signal_handler(int sig) {
+    (void)sig;
+    watch_stop_requested = 1;
+}
+
+/**
+ * Calcola il percorso assoluto di un file; se il file non esiste (ad esempio durante una
+ * rinomina) risolve solo la directory che lo contiene.
+ * @return Stringa allocata dinamicamente, o NULL in caso di errore.
+ */
+static char* absolute_path(const char* filename) {
+    char* resolved = realpath(filename, NULL);
+    if (resolved) return resolved;
+
+    char* copy_dir = strdup(filename);
+    char* copy_base = strdup(filename);
+    char* result = NULL;
+    if (copy_dir && copy_base) {
+        char* dir = realpath(dirname(copy_dir), NULL);
+        const char* base = basename(copy_base);
+        if (dir) {
+            result = malloc(strlen(dir) + strlen(base) + 2);
+            if (result) sprintf(result, "%s/%s", dir, base);
+            free(dir);
+        }
+    }
+    free(copy_dir);
+    free(copy_base);
+    return result;
+}
+
+/**
+ * Elabora un file con statistiche e grafo dedicati, raccogliendo l'output in memoria.
+ * Per i file inclusi (depth > 0) la voce del file viene registrata come inclusione.
+ * @param state Stato della modalità watch.
+ * @param filename File da elaborare.
+ * @param depth Profondità di inclusione del file.
+ * @param graph Grafo in cui registrare le occorrenze (offset relativi all'output prodotto).
+ * @param out Buffer di output allocato (da liberare).
+ * @param out_size Dimensione dell'output.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+static int render_file(WatchState* state, const char* filename, int depth, IncludeGraph* graph, char** out, size_t* out_size) {
+    *out = NULL;
+    *out_size = 0;
+
+    FILE* mem = open_memstream(out, out_size);
+    if (!mem) {
+        perror("Errore: open_memstream fallita in modalità watch");
+        return -1;
+    }
+
+    ProcessingOptions options = state->options;
+    options.include_graph = graph;
+    ProcessingStats stats;
+    init_stats(&stats, state->verbose);
+    stats.options = &options;
+    if (depth > 0) stats.includes_processed++;
+
+    int result = process_c_file(filename, mem, &stats, depth);
+    if (fclose(mem) != 0) result = -1;
+
+    if (state->verbose) {
+        print_stats(&stats, stderr);
+    }
+    free_stats(&stats);
+
+    if (result != 0) {
+        free(*out);
+        *out = NULL;
+        *out_size = 0;
+    }
+    return result;
+}
+
+/**
+ * Riscrive il file di output con il contenuto corrente.
+ */
+static int write_output(WatchState* state) {
+    FILE* fp = open_output_stream(state->output_filename, NULL);
+    if (!fp) {
+        fprintf(stderr, "Errore: Impossibile aprire il file di output '%s': %s\n", state->output_filename, strerror(errno));
+        return -1;
+    }
+    bool ok = fwrite(state->output, 1, state->output_size, fp) == state->output_size;
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) {
+        fprintf(stderr, "Errore durante la scrittura del file di output '%s': %s\n", state->output_filename, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Aggiunge una directory a inotify e all'elenco delle directory osservate.
+ */
+static void add_watched_dir(WatchState* state, const char* dir) {
+    if (state->dir_count >= state->dir_capacity) {
+        int new_capacity = (state->dir_capacity == 0) ? 8 : state->dir_capacity * 2;
+        WatchedDir* new_dirs = realloc(state->dirs, new_capacity * sizeof(WatchedDir));
+        if (!new_dirs) {
+            perror("Errore: Impossibile riallocare memoria per le directory osservate");
+            return;
+        }
+        state->dirs = new_dirs;
+        state->dir_capacity = new_capacity;
+    }
+
+    char* path_copy = strdup(dir);
+    if (!path_copy) {
+        perror("strdup fallita in add_watched_dir");
+        return;
+    }
+    int wd = inotify_add_watch(state->inotify_fd, dir, WATCH_EVENT_MASK);
+    if (wd < 0) {
+        fprintf(stderr, "Attenzione: Impossibile osservare la directory '%s': %s\n", dir, strerror(errno));
+        free(path_copy);
+        return;
+    }
+    state->dirs[state->dir_count].wd = wd;
+    state->dirs[state->dir_count].path = path_copy;
+    state->dir_count++;
+}
+
+/**
+ * Aggiunge a inotify le directory di tutti i file presenti nel grafo non ancora osservate.
+ */
+static void sync_watches(WatchState* state) {
+    for (int i = 0; i < state->graph.count; ++i) {
+        char* path = absolute_path(state->graph.nodes[i].filename);
+        if (!path) continue;
+        char* dir = dirname(path);
+
+        bool known = false;
+        for (int d = 0; d < state->dir_count && !known; ++d) {
+            known = strcmp(state->dirs[d].path, dir) == 0;
+        }
+        if (!known) {
+            add_watched_dir(state, dir);
+        }
+        free(path);
+    }
+}
+
+/**
+ * Registra un percorso modificato, evitando duplicati.
+ */
+static void add_changed_path(WatchState* state, char* path) {
+    for (int i = 0; i < state->changed_count; ++i) {
+        if (strcmp(state->changed[i], path) == 0) {
+            free(path);
+            return;
+        }
+    }
+    if (state->changed_count >= state->changed_capacity) {
+        int new_capacity = (state->changed_capacity == 0) ? 8 : state->changed_capacity * 2;
+        char** new_changed = realloc(state->changed, new_capacity * sizeof(char*));
+        if (!new_changed) {
+            perror("Errore: Impossibile riallocare memoria per i file modificati");
+            free(path);
+            return;
+        }
+        state->changed = new_changed;
+        state->changed_capacity = new_capacity;
+    }
+    state->changed[state->changed_count++] = path;
+}
+
+/**
+ * Legge gli eventi inotify disponibili e registra i file modificati.
+ */
+static void read_events(WatchState* state) {
+    char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t len = read(state->inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) return;
+
+        for (char* p = buffer; p < buffer + len; ) {
+            struct inotify_event* event = (struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + event->len;
+            if (event->len == 0) continue;
+
+            for (int d = 0; d < state->dir_count; ++d) {
+                if (state->dirs[d].wd != event->wd) continue;
+                char* path = malloc(strlen(state->dirs[d].path) + strlen(event->name) + 2);
+                if (path) {
+                    sprintf(path, "%s/%s", state->dirs[d].path, event->name);
+                    add_changed_path(state, path);
+                }
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Indica se il file del nodo è tra quelli modificati.
+ */
+static bool node_changed(WatchState* state, const IncludeNode* node) {
+    char* path = absolute_path(node->filename);
+    if (!path) return false;
+    bool changed = false;
+    for (int i = 0; i < state->changed_count && !changed; ++i) {
+        changed = strcmp(state->changed[i], path) == 0;
+    }
+    free(path);
+    return changed;
+}
+
+/**
+ * Restituisce l'indice successivo all'ultimo nodo del sottoalbero di index (pre-ordine).
+ */
+static int subtree_end(const IncludeGraph* graph, int index) {
+    int end = index + 1;
+    while (end < graph->count && graph->nodes[end].depth > graph->nodes[index].depth) end++;
+    return end;
+}
+
+/**
+ * Rigenera il segmento di output di un nodo e lo sostituisce nell'output corrente,
+ * aggiornando gli offset di tutti i nodi e sostituendo il sottoalbero nel grafo.
+ * @return 0 in caso di successo, -1 se la rigenerazione fallisce (output invariato).
+ */
+static int regenerate_node(WatchState* state, int index) {
+    IncludeNode old = state->graph.nodes[index];
+    IncludeGraph sub;
+    init_include_graph(&sub);
+
+    char* segment = NULL;
+    size_t segment_size = 0;
+    if (render_file(state, old.filename, old.depth, &sub, &segment, &segment_size) != 0 || sub.count == 0) {
+        free(segment);
+        free_include_graph(&sub);
+        return -1;
+    }
+
+    // Alloca il nuovo output e il nuovo array dei nodi prima di modificare lo stato
+    size_t start = (size_t)old.output_start;
+    size_t end = (size_t)old.output_end;
+    size_t new_size = state->output_size - (end - start) + segment_size;
+    int old_end = subtree_end(&state->graph, index);
+    int old_count = old_end - index;
+    int new_total = state->graph.count - old_count + sub.count;
+    char* new_output = malloc(new_size > 0 ? new_size : 1);
+    IncludeNode* nodes = malloc(sizeof(IncludeNode) * (size_t)new_total);
+    if (!new_output || !nodes) {
+        perror("malloc fallito in regenerate_node");
+        free(new_output);
+        free(nodes);
+        free(segment);
+        free_include_graph(&sub);
+        return -1;
+    }
+
+    // Sostituzione dei byte del segmento nell'output
+    memcpy(new_output, state->output, start);
+    memcpy(new_output + start, segment, segment_size);
+    memcpy(new_output + start + segment_size, state->output + end, state->output_size - end);
+    free(state->output);
+    free(segment);
+    state->output = new_output;
+    state->output_size = new_size;
+    long delta = (long)segment_size - (long)(end - start);
+
+    // Sostituzione del sottoalbero nel grafo (i nodi restano in pre-ordine)
+    int shift = sub.count - old_count;
+    int n = 0;
+    for (int i = 0; i < index; ++i) {
+        nodes[n++] = state->graph.nodes[i];
+    }
+    // Solo gli antenati contengono il segmento: i fratelli precedenti possono terminare
+    // esattamente in start (segmento vuoto) e non devono essere estesi
+    for (int p = old.parent; p >= 0; p = nodes[p].parent) {
+        nodes[p].output_end += delta;
+    }
+    for (int i = 0; i < sub.count; ++i) {
+        nodes[n] = sub.nodes[i];
+        nodes[n].output_start += (long)start;
+        nodes[n].output_end += (long)start;
+        nodes[n].parent = (i == 0) ? old.parent : sub.nodes[i].parent + index;
+        if (i == 0) nodes[n].include_line = old.include_line;
+        n++;
+    }
+    for (int i = old_end; i < state->graph.count; ++i) {
+        nodes[n] = state->graph.nodes[i];
+        nodes[n].output_start += delta;
+        nodes[n].output_end += delta;
+        if (nodes[n].parent >= old_end) nodes[n].parent += shift;
+        n++;
+    }
+    for (int i = index; i < old_end; ++i) {
+        free(state->graph.nodes[i].filename);
+    }
+    free(state->graph.nodes);
+    free(sub.nodes); // I nomi dei file sono stati trasferiti nel nuovo array
+
+    state->graph.nodes = nodes;
+    state->graph.count = new_total;
+    state->graph.capacity = new_total;
+    return 0;
+}
+
+/**
+ * Rigenera i segmenti dei file modificati. Si rigenerano solo i nodi più esterni
+ * interessati (il sottoalbero di un nodo rigenerato viene ricostruito con esso),
+ * procedendo dall'ultimo al primo in modo che gli indici ancora da elaborare restino validi.
+ * I segmenti la cui rigenerazione fallisce restano invariati.
+ * @return Numero di segmenti rigenerati, -1 in caso di errore di allocazione.
+ */
+static int regenerate_changed(WatchState* state) {
+    int regenerated = 0;
+
+    // Individua i nodi interessati più esterni
+    int count = state->graph.count;
+    bool* affected = calloc(count > 0 ? count : 1, sizeof(bool));
+    if (!affected) {
+        perror("calloc fallito in regenerate_changed");
+        return -1;
+    }
+    for (int i = 0; i < count; ) {
+        if (node_changed(state, &state->graph.nodes[i])) {
+            affected[i] = true;
+            i = subtree_end(&state->graph, i);
+        } else {
+            i++;
+        }
+    }
+
+    for (int i = count - 1; i >= 0; --i) {
+        if (!affected[i]) continue;
+        if (state->verbose) {
+            fprintf(stderr, "Rigenerazione del segmento di '%s' (profondità %d, byte %ld-%ld).\n",
+                    state->graph.nodes[i].filename, state->graph.nodes[i].depth,
+                    state->graph.nodes[i].output_start, state->graph.nodes[i].output_end);
+        }
+        if (regenerate_node(state, i) == 0) {
+            regenerated++;
+        } else {
+            fprintf(stderr, "Errore: rigenerazione di '%s' fallita, segmento precedente mantenuto.\n", state->graph.nodes[i].filename);
+        }
+    }
+
+    free(affected);
+    return regenerated;
+}
+
+/**
+ * Libera le risorse della modalità watch.
+ */
+static void free_watch_state(WatchState* state) {
+    free(state->output);
+    free_include_graph(&state->graph);
+    for (int d = 0; d < state->dir_count; ++d) free(state->dirs[d].path);
+    free(state->dirs);
+    for (int i = 0; i < state->changed_count; ++i) free(state->changed[i]);
+    free(state->changed);
+    if (state->inotify_fd >= 0) close(state->inotify_fd);
+}
+
+/**
+ * Modalità watch: esegue una prima elaborazione completa mantenendo in memoria l'output e
+ * il grafo delle inclusioni (con l'intervallo di output prodotto da ogni occorrenza di file),
+ * quindi osserva con inotify le directory di tutti i file coinvolti. Quando un file cambia
+ * vengono rigenerati solo i segmenti delle sue occorrenze e il file di output viene riscritto
+ * con i segmenti invariati ricomposti attorno a quelli nuovi. Termina con SIGINT o SIGTERM.
+ * @param input_filename File C di input.
+ * @param output_filename File di output (obbligatorio).
+ * @param base_options Opzioni di elaborazione (la cache dei file non viene usata).
+ * @param verbose Se true stampa statistiche e dettagli di ogni rigenerazione.
+ * @return 0 in caso di uscita regolare, 1 in caso di errore.
+ */
+int run_watch_mode(const char* input_filename, const char* output_filename, const ProcessingOptions* base_options, bool verbose) {
+    WatchState state;
+    memset(&state, 0, sizeof(state));
+    state.input_filename = input_filename;
+    state.output_filename = output_filename;
+    state.options = *base_options;
+    state.options.file_cache = NULL; // I file vanno sempre riletti dal disco
+    state.verbose = verbose;
+    state.inotify_fd = -1;
+    init_include_graph(&state.graph);
+
+    // Prima elaborazione completa
+    if (render_file(&state, input_filename, 0, &state.graph, &state.output, &state.output_size) != 0 ||
+        write_output(&state) != 0) {
+        free_watch_state(&state);
+        return 1;
+    }
+    fprintf(stderr, "File processato scritto con successo in: %s\n", output_filename);
+
+    state.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (state.inotify_fd < 0) {
+        fprintf(stderr, "Errore: inotify non disponibile: %s\n", strerror(errno));
+        free_watch_state(&state);
+        return 1;
+    }
+    sync_watches(&state);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = watch_signal_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stderr, "Modalità watch attiva su %d file (Ctrl+C per terminare).\n", state.graph.count);
+
+    while (!watch_stop_requested) {
+        struct pollfd pfd = { state.inotify_fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("Errore: poll fallita in modalità watch");
+            break;
+        }
+
+        // Raggruppa gli eventi ravvicinati (salvataggi in più passi degli editor)
+        do {
+            read_events(&state);
+        } while (poll(&pfd, 1, WATCH_DEBOUNCE_MS) > 0);
+
+        if (state.changed_count == 0) continue;
+
+        int regenerated = regenerate_changed(&state);
+        for (int i = 0; i < state.changed_count; ++i) free(state.changed[i]);
+        state.changed_count = 0;
+
+        if (regenerated > 0) {
+            if (write_output(&state) == 0) {
+                fprintf(stderr, "Output aggiornato (%d segmenti rigenerati, %zu bytes).\n", regenerated, state.output_size);
+            }
+            sync_watches(&state);
+        }
+    }
+
+    fprintf(stderr, "Modalità watch terminata.\n");
+    free_watch_state(&state);
+    return 0;
+}
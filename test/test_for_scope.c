@@ -0,0 +1,30 @@
+int counter;
+
+int main() {
+    int total = 0;
+
+    // Validi: variabili del ciclo visibili solo nel ciclo
+    for (int i = 0; i < 10; i++) {
+        total += i;
+    }
+    for (int i = 0, j = 10; i < j; i++, j--) total += j;
+    for (int k = 0; k < 3; k++)
+        for (int m = 0; m < 3; m++)
+            total += k * m;
+    for (total = 0; total < 5; total++);
+    for (;;) {
+        break;
+    }
+
+    // Non validi:
+    for (int 9x = 0; total < 10; total++) { } // Inizia con un numero
+    for (int n = 0, n = 1; n < 2; n++) { } // Dichiarazione duplicata
+    for (int i = 0; i < 10; i++) {
+        int i = 5; // Nasconde la variabile del ciclo
+        total += i;
+    }
+    for (int counter = 0; counter < 2; counter++) { } // Nasconde la variabile globale
+
+    int i = total; // Valido: la variabile del ciclo non è più visibile
+    return i;
+}
@@ -0,0 +1,6 @@
+// Direttive #include seguite da commenti
+#include "test_include_header.h" /* commento finale */ // altro commento
+
+int main() {
+    return header_value; /* commento */
+}